@@ -1,4 +1,6 @@
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 
 #include "stb_image.h"
 
@@ -6,9 +8,17 @@
 #include "stb_image_write.h"
 #include "stb_image_resize.h"
 
+#include "shared/UtilsIBL.h"
 #include "shared/UtilsMath.h"
+#include "shared/UtilsSphericalHarmonics.h"
 
 #include <glm/glm.hpp>
+#include <taskflow/taskflow.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FILTER_USE_SSE 1
+#include <xmmintrin.h>
+#endif
 
 using glm::vec2;
 using glm::vec3;
@@ -35,7 +45,8 @@ vec2 hammersley2d(uint32_t i, uint32_t N)
     return vec2(float(i)/float(N), radicalInverse_VdC(i));
 }
 
-void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output, int numMonteCarloSamples)
+/* The original single-threaded implementation, convolveDiffuse() must produce bit-identical results (see --validate) */
+void convolveDiffuseReference(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output, int numMonteCarloSamples)
 {
     // only equirectangular maps are supported
     assert(srcW == 2 * srcH);
@@ -55,7 +66,6 @@ void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, v
 
     for (int y = 0; y != dstH; y++)
     {
-        printf("Line %i...\n", y);
         const float theta1 = float(y) / float(dstH) * Math::PI;
         for (int x = 0; x != dstW; x++)
         {
@@ -83,7 +93,149 @@ void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, v
     }
 }
 
-void process_cubemap(const char* filename, const char* outFilename)
+/* Monte Carlo samples of the downscaled source map (structure of arrays): direction and radiance */
+struct DiffuseSamples
+{
+    std::vector<float> x, y, z;
+    std::vector<float> r, g, b;
+};
+
+DiffuseSamples prepareDiffuseSamples(const vec3* scratch, int srcW, int srcH, int numMonteCarloSamples)
+{
+    DiffuseSamples s;
+
+    for (int i = 0; i != numMonteCarloSamples; i++)
+    {
+        // the same expressions as convolveDiffuseReference(), so the directions are bit-identical
+        const vec2 h = hammersley2d(i, numMonteCarloSamples);
+        const int x1 = int(floor(h.x * srcW));
+        const int y1 = int(floor(h.y * srcH));
+        const float theta2 = float(y1) / float(srcH) * Math::PI;
+        const float phi2 = float(x1) / float(srcW) * Math::TWOPI;
+        const vec3 V2 = vec3(sin(theta2) * cos(phi2), sin(theta2) * sin(phi2), cos(theta2));
+        const vec3 c = scratch[y1 * srcW + x1];
+
+        s.x.push_back(V2.x);
+        s.y.push_back(V2.y);
+        s.z.push_back(V2.z);
+        s.r.push_back(c.x);
+        s.g.push_back(c.y);
+        s.b.push_back(c.z);
+    }
+
+    return s;
+}
+
+vec3 getDiffuseDirection(int x, int y, int dstW, int dstH)
+{
+    const float theta1 = float(y) / float(dstH) * Math::PI;
+    const float phi1 = float(x) / float(dstW) * Math::TWOPI;
+    return vec3(sin(theta1) * cos(phi1), sin(theta1) * sin(phi1), cos(theta1));
+}
+
+/* One output row. Every texel accumulates the samples in the same order and with the same operations as the reference */
+void convolveDiffuseRow(const DiffuseSamples& s, int y, int dstW, int dstH, vec3* output)
+{
+    const int numSamples = (int)s.x.size();
+
+    int x = 0;
+
+#if FILTER_USE_SSE
+    // 4 texels of the row at a time, one per lane
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 threshold = _mm_set1_ps(0.01f);
+
+    for (; x + 4 <= dstW; x += 4)
+    {
+        alignas(16) float v1[3][4];
+        for (int k = 0; k != 4; k++)
+        {
+            const vec3 V1 = getDiffuseDirection(x + k, y, dstW, dstH);
+            v1[0][k] = V1.x;
+            v1[1][k] = V1.y;
+            v1[2][k] = V1.z;
+        }
+
+        const __m128 v1x = _mm_load_ps(v1[0]);
+        const __m128 v1y = _mm_load_ps(v1[1]);
+        const __m128 v1z = _mm_load_ps(v1[2]);
+
+        __m128 r = zero;
+        __m128 g = zero;
+        __m128 b = zero;
+        __m128 weight = zero;
+
+        for (int i = 0; i != numSamples; i++)
+        {
+            // glm::dot() sums as (x + y) + z
+            const __m128 dot = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(v1x, _mm_load1_ps(&s.x[i])), _mm_mul_ps(v1y, _mm_load1_ps(&s.y[i]))),
+                    _mm_mul_ps(v1z, _mm_load1_ps(&s.z[i])));
+            const __m128 D = _mm_max_ps(dot, zero);
+
+            // rejected samples add +0.0, which leaves the non-negative sums unchanged
+            const __m128 mask = _mm_cmpgt_ps(D, threshold);
+            r = _mm_add_ps(r, _mm_and_ps(mask, _mm_mul_ps(_mm_load1_ps(&s.r[i]), D)));
+            g = _mm_add_ps(g, _mm_and_ps(mask, _mm_mul_ps(_mm_load1_ps(&s.g[i]), D)));
+            b = _mm_add_ps(b, _mm_and_ps(mask, _mm_mul_ps(_mm_load1_ps(&s.b[i]), D)));
+            weight = _mm_add_ps(weight, _mm_and_ps(mask, D));
+        }
+
+        alignas(16) float color[3][4];
+        _mm_store_ps(color[0], _mm_div_ps(r, weight));
+        _mm_store_ps(color[1], _mm_div_ps(g, weight));
+        _mm_store_ps(color[2], _mm_div_ps(b, weight));
+
+        for (int k = 0; k != 4; k++)
+            output[y * dstW + x + k] = vec3(color[0][k], color[1][k], color[2][k]);
+    }
+#endif
+
+    for (; x != dstW; x++)
+    {
+        const vec3 V1 = getDiffuseDirection(x, y, dstW, dstH);
+        vec3 color = vec3(0.0f);
+        float weight = 0.0f;
+        for (int i = 0; i != numSamples; i++)
+        {
+            const float D = std::max(0.0f, glm::dot(V1, vec3(s.x[i], s.y[i], s.z[i])));
+            if (D > 0.01f)
+            {
+                color += vec3(s.r[i], s.g[i], s.b[i]) * D;
+                weight += D;
+            }
+        }
+        output[y * dstW + x] = color / weight;
+    }
+}
+
+/* Diffuse irradiance of an equirectangular map. The sample directions and their source texels do not depend on the output
+   texel, so they are computed once; the rows are spread across all cores */
+void convolveDiffuse(const vec3* data, int srcW, int srcH, int dstW, int dstH, vec3* output, int numMonteCarloSamples)
+{
+    // only equirectangular maps are supported
+    assert(srcW == 2 * srcH);
+
+    if (srcW != 2 * srcH) return;
+
+    std::vector<vec3> tmp(dstW * dstH);
+
+    stbir_resize_float_generic(
+            reinterpret_cast<const float*>(data), srcW, srcH, 0,
+            reinterpret_cast<float*>(tmp.data()), dstW, dstH, 0, 3,
+            STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_CUBICBSPLINE, STBIR_COLORSPACE_LINEAR, nullptr);
+
+    const DiffuseSamples samples = prepareDiffuseSamples(tmp.data(), dstW, dstH, numMonteCarloSamples);
+
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, dstH, 1, [&](int y) {
+        convolveDiffuseRow(samples, y, dstW, dstH, output);
+    });
+    executor.run(taskflow).wait();
+}
+
+void process_cubemap(const char* filename, const char* outFilename, bool validate)
 {
     int w, h, comp;
     const float* img = stbi_loadf(filename, &w, &h, &comp, 3);
@@ -99,16 +251,141 @@ void process_cubemap(const char* filename, const char* outFilename)
 
     std::vector<vec3> out(dstW * dstH);
 
+    const auto start = std::chrono::steady_clock::now();
     convolveDiffuse((vec3*)img, w, h, dstW, dstH, out.data(), numPoints);
+    printf("Irradiance convolution: %.3f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    if (validate)
+    {
+        std::vector<vec3> reference(dstW * dstH);
+        convolveDiffuseReference((vec3*)img, w, h, dstW, dstH, reference.data(), numPoints);
+
+        if (memcmp(out.data(), reference.data(), out.size() * sizeof(vec3)))
+        {
+            printf("Irradiance differs from the reference implementation\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Irradiance is identical to the reference implementation\n");
+    }
 
     stbi_image_free((void*)img);
     stbi_write_hdr(outFilename, dstW, dstH, 3, (float*)out.data());
 }
 
-int main()
+/* L2 spherical harmonics of the irradiance, projected from the full resolution map. 'outMapFilename' optionally receives
+   the irradiance map reconstructed from the 9 coefficients, in place of the Monte Carlo one */
+void process_sh(const char* filename, const char* outFilename, const char* outMapFilename)
 {
+    int w, h, comp;
+    const float* img = stbi_loadf(filename, &w, &h, &comp, 3);
+
+    if (!img)
+    {
+        printf("Failed to load [%s] texture\n", filename); fflush(stdout);
+        return;
+    }
+
+    tf::Executor executor;
+
+    const auto start = std::chrono::steady_clock::now();
+    const SHIrradiance sh = ProjectEquirectangularMapToSH((const vec3*)img, w, h, executor);
+    printf("SH projection: %.3f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    stbi_image_free((void*)img);
+
+    for (int i = 0; i != 9; i++)
+        printf("  SH[%i] = (%f, %f, %f)\n", i, sh.mCoeffs[i].x, sh.mCoeffs[i].y, sh.mCoeffs[i].z);
+
+    SaveSHIrradiance(outFilename, sh);
+
+    if (outMapFilename)
+    {
+        const int dstW = 256;
+        const int dstH = 128;
+
+        std::vector<vec3> out(dstW * dstH);
+        RenderSHIrradiance(sh, dstW, dstH, out.data(), executor);
+        stbi_write_hdr(outMapFilename, dstW, dstH, 3, (float*)out.data());
+    }
+}
+
+/* Prefiltered specular cube map and BRDF integration LUT of PBR.frag (texEnvMap and texBRDF_LUT) */
+void process_ibl(const char* filename, const char* outSpecularFilename, const char* outBRDFLUTFilename)
+{
+    int w, h, comp;
+    const float* img = stbi_loadf(filename, &w, &h, &comp, 3);
+
+    if (!img)
+    {
+        printf("Failed to load [%s] texture\n", filename); fflush(stdout);
+        return;
+    }
+
+    tf::Executor executor;
+
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<Bitmap> levels = PrefilterSpecularCubemap((const vec3*)img, w, h, SpecularPrefilterSettings(), executor);
+    printf("Specular prefilter: %.3f s, %i mips\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), (int)levels.size());
+
+    stbi_image_free((void*)img);
+
+    if (!SaveCubemapKTX(outSpecularFilename, levels))
+        printf("Cannot write [%s]\n", outSpecularFilename);
+
+    const int lutSize = 256;
+
+    start = std::chrono::steady_clock::now();
+    const std::vector<glm::vec2> lut = GenerateBRDFLUT(lutSize, 1024, executor);
+    printf("BRDF LUT: %.3f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    if (!SaveBRDFLUTKTX(outBRDFLUTFilename, lut, lutSize))
+        printf("Cannot write [%s]\n", outBRDFLUTFilename);
+}
+
+/* FilterEnvmap [--validate] [--sh] [--sh-map] [--ibl]
+   --validate also runs the reference convolution and fails unless the results are bit-identical
+   --sh       writes the L2 spherical harmonics of the irradiance instead of running the Monte Carlo convolution
+   --sh-map   like --sh, and also writes the irradiance map reconstructed from them
+   --ibl      also bakes the GGX prefiltered specular cube map and the BRDF LUT (next to the shipped data/brdfLUT.ktx, not over it) */
+int main(int argc, char** argv)
+{
+    bool validate = false;
+    bool sh = false;
+    bool shMap = false;
+    bool ibl = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--validate"))
+            validate = true;
+        else if (!strcmp(argv[i], "--sh"))
+            sh = true;
+        else if (!strcmp(argv[i], "--sh-map"))
+            sh = shMap = true;
+        else if (!strcmp(argv[i], "--ibl"))
+            ibl = true;
+        else
+        {
+            printf("Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ibl)
+        process_ibl("../../../data/cubemap/spaichingen_hill_2k.hdr",
+                    "../../../data/cubemap/spaichingen_hill_2k_specular.ktx",
+                    "../../../data/brdfLUT_baked.ktx");
+
+    if (sh)
+    {
+        process_sh("../../../data/cubemap/spaichingen_hill_2k.hdr",
+                   "../../../data/cubemap/spaichingen_hill_2k_irradiance.sh",
+                   shMap ? "../../../data/cubemap/spaichingen_hill_2k_irradiance.hdr" : nullptr);
+        return 0;
+    }
+
     process_cubemap("../../../data/cubemap/spaichingen_hill_2k.hdr",
-                    "../../../data/cubemap/spaichingen_hill_2k_irradiance.hdr");
+                    "../../../data/cubemap/spaichingen_hill_2k_irradiance.hdr", validate);
 
     return 0;
-}
\ No newline at end of file
+}
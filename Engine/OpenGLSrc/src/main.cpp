@@ -6,10 +6,17 @@
 #include "shared/glFramework/GLShader.h"
 #include "shared/glFramework/GLTexture.h"
 #include "shared/glFramework/GLSceneData.h"
+#include "shared/glFramework/GLImpostors.h"
+#include "shared/Utils.h"
 #include "shared/UtilsMath.h"
+#include "shared/UtilsSphericalHarmonics.h"
 #include "shared/Camera.h"
 
 #include "shared/scene/VtxData.h"
+#include "shared/scene/LODSelector.h"
+#include "shared/scene/Collision.h"
+
+#include <btBulletCollisionCommon.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -22,6 +29,7 @@
 const GLuint kBufferIndex_PerFrameUniforms = 0;
 const GLuint kBufferIndex_ModelMatrices = 1;
 const GLuint kBufferIndex_Materials = 2;
+const GLuint kBufferIndex_SHIrradiance = 8;
 
 struct PerFrameData {
     mat4 view;
@@ -34,6 +42,9 @@ struct MouseState {
     bool pressedLeft = false;
 }mouseState;
 
+// cast a ray from the camera into the collision world on the next frame
+bool castRay = false;
+
 CameraPositioner_FirstPerson positioner(vec3(-10.f, 3.f, 3.f), vec3(0.f, 0.f, -1.f), vec3(0.f, 1.f, 0.f));
 Camera camera(positioner);
 
@@ -75,6 +86,19 @@ public:
         glVertexArrayAttribFormat(mVao, 2, 3, GL_FLOAT, GL_TRUE, sizeof(vec3) + sizeof(vec2));
         glVertexArrayAttribBinding(mVao, 2, 0);
 
+        UpdateDrawCommands(data);
+
+        std::vector<glm::mat4> matrices(data.mShapes.size());
+        size_t i = 0;
+        for(const auto& c: data.mShapes) {
+            matrices[i++] = data.mDrawTransforms[c.transformIndex];
+        }
+
+        glNamedBufferSubData(mBufferModelMatrices.GetHandle(), 0, matrices.size() * sizeof(glm::mat4), matrices.data());
+    }
+
+    /* Rebuild the indirect commands, called again whenever the LODs of data.mShapes change */
+    void UpdateDrawCommands(const GLSceneData& data) {
         std::vector<uint8_t> drawCommands;
 
         drawCommands.resize(sizeof(DrawElementsIndirectCommand) * data.mShapes.size() + sizeof(GLsizei));
@@ -87,13 +111,13 @@ public:
                 reinterpret_cast<DrawElementsIndirectCommand*>(drawCommands.data() + sizeof(GLsizei))
                 );
 
-        // prepare indirect commands buffer
+        // prepare indirect commands buffer, impostor LODs are drawn by GLImpostors
         for(uint32_t i = 0; i != data.mShapes.size(); i++) {
             const uint32_t meshIdx = data.mShapes[i].meshIndex;
             const uint32_t lod = data.mShapes[i].LOD;
             *cmd++ = {
                     .count = data.mMeshData.mMeshes[meshIdx].GetLODIndicesCount(lod),
-                    .instanceCount = 1,
+                    .instanceCount = IsImpostorLOD(data.mMeshData.mMeshes[meshIdx], lod) ? 0u : 1u,
                     .firstIndex = data.mShapes[i].indexOffset,
                     .baseVertex = data.mShapes[i].vertexOffset,
                     .baseInstance = data.mShapes[i].materialIndex
@@ -101,14 +125,6 @@ public:
         }
 
         glNamedBufferSubData(mBufferIndirect.GetHandle(), 0, drawCommands.size(), drawCommands.data());
-
-        std::vector<glm::mat4> matrices(data.mShapes.size());
-        size_t i = 0;
-        for(const auto& c: data.mShapes) {
-            matrices[i++] = data.mScene.mGlobalTransform[c.transformIndex];
-        }
-
-        glNamedBufferSubData(mBufferModelMatrices.GetHandle(), 0, matrices.size() * sizeof(glm::mat4), matrices.data());
     }
 
     void Draw(const GLSceneData& data) const {
@@ -120,6 +136,8 @@ public:
         glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)sizeof(GLsizei), 0, (GLsizei)data.mShapes.size(), 0);
     }
 
+    GLuint GetVertexArray() const { return mVao; }
+
     ~GLMesh() {
         glDeleteVertexArrays(1, &mVao);
     }
@@ -154,16 +172,63 @@ int main() {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_DEPTH_TEST);
 
+    // diffuse irradiance written by FilterEnvmap --sh, without it mesh.frag keeps its constant ambient term
+    SHIrradiance shIrradiance;
+    const bool useSHIrradiance = LoadSHIrradiance("../../../data/cubemap/spaichingen_hill_2k_irradiance.sh", shIrradiance);
+
+    glm::vec4 shCoeffs[9];
+    for (int i = 0 ; i != 9 ; i++)
+        shCoeffs[i] = glm::vec4(shIrradiance.mCoeffs[i], 0.0f);
+
+    GLBuffer shIrradianceBuffer(sizeof(shCoeffs), shCoeffs, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, kBufferIndex_SHIrradiance, shIrradianceBuffer.GetHandle(), 0, sizeof(shCoeffs));
+
+    std::string meshFragmentSource = ReadShaderFile("../../../data/shaders/mesh.frag");
+    if (useSHIrradiance)
+        meshFragmentSource.insert(meshFragmentSource.find('\n') + 1, "#define USE_SH_IRRADIANCE\n");
+
     GLShader shaderVertex("../../../data/shaders/mesh.vert");
-    GLShader shaderFragment("../../../data/shaders/mesh.frag");
+    GLShader shaderFragment(GL_FRAGMENT_SHADER, meshFragmentSource.c_str(), "../../../data/shaders/mesh.frag");
     GLProgram program(shaderVertex, shaderFragment);
 
+    GLShader shaderImpostorVertex("../../../data/shaders/impostor.vert");
+    GLShader shaderImpostorFragment("../../../data/shaders/impostor.frag");
+    GLProgram programImpostor(shaderImpostorVertex, shaderImpostorFragment);
+
     GLSceneData sceneData1("../../../data/meshes/test.meshes", "../../../data/meshes/test.scene", "../../../data/meshes/test.materials");
     GLSceneData sceneData2("../../../data/meshes/test2.meshes", "../../../data/meshes/test2.scene", "../../../data/meshes/test2.materials");
 
     GLMesh mesh1(sceneData1);
     GLMesh mesh2(sceneData2);
 
+    GLImpostors impostors1(sceneData1, "../../../data/meshes/test.impostors");
+    GLImpostors impostors2(sceneData2, "../../../data/meshes/test2.impostors");
+
+    // static collision of both scenes, the proxies and their BVHs are prebuilt by SceneConverter
+    const double collisionStart = glfwGetTime();
+
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher collisionDispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btCollisionWorld collisionWorld(&collisionDispatcher, &broadphase, &collisionConfiguration);
+
+    CollisionData collisionData1, collisionData2;
+    LoadCollisionData("../../../data/meshes/test.collision", collisionData1);
+    LoadCollisionData("../../../data/meshes/test2.collision", collisionData2);
+
+    CollisionShapes collision1(std::move(collisionData1));
+    CollisionShapes collision2(std::move(collisionData2));
+
+    const uint32_t numCollisionObjects =
+            collision1.AddToWorld(collisionWorld, sceneData1.mShapes, sceneData1.mDrawTransforms) +
+            collision2.AddToWorld(collisionWorld, sceneData2.mShapes, sceneData2.mDrawTransforms);
+
+    printf("Collision: %u objects in %.1f ms (%u BVHs rebuilt)\n", numCollisionObjects, (glfwGetTime() - collisionStart) * 1000.0,
+           collision1.GetNumRebuiltBvhs() + collision2.GetNumRebuiltBvhs());
+
+    const float fovY = 45.f;
+    LODSelector lodSelector;
+
     glfwSetCursorPosCallback(
             app.GetWindow(),
             [](auto* window, double x, double y)
@@ -211,6 +276,8 @@ int main() {
                     positioner.mMovement.mFastSpeed = false;
                 if (key == GLFW_KEY_SPACE)
                     positioner.SetUpVector(vec3(0.0f, 1.0f, 0.0f));
+                if (key == GLFW_KEY_C && action == GLFW_PRESS)
+                    castRay = true;
             }
     );
 
@@ -231,7 +298,7 @@ int main() {
         glViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        const mat4 p = glm::perspective(45.f, ratio, 0.1f, 1000.f);
+        const mat4 p = glm::perspective(fovY, ratio, 0.1f, 1000.f);
         const mat4 view = camera.GetViewMatrix();
 
         const PerFrameData perFrameData = {
@@ -241,11 +308,41 @@ int main() {
         };
         glNamedBufferSubData(perFrameDataBuffer.GetHandle(), 0, kUniformBufferSize, &perFrameData);
 
+        if (castRay) {
+            castRay = false;
+
+            const float kRayLength = 1000.f;
+            const vec3 from = camera.GetPosition();
+            const vec3 to = from - kRayLength * vec3(view[0][2], view[1][2], view[2][2]);
+
+            btCollisionWorld::ClosestRayResultCallback hit(btVector3(from.x, from.y, from.z), btVector3(to.x, to.y, to.z));
+            collisionWorld.rayTest(hit.m_rayFromWorld, hit.m_rayToWorld, hit);
+            if (hit.hasHit())
+                printf("Ray hit draw %d at %.2f\n", hit.m_collisionObject->getUserIndex(), hit.m_closestHitFraction * kRayLength);
+            else
+                printf("Ray hit nothing\n");
+        }
+
+        if (lodSelector.Update(sceneData1.mMeshData, sceneData1.mDrawTransforms, sceneData1.mShapes, camera.GetPosition(), fovY, (float)height))
+        {
+            mesh1.UpdateDrawCommands(sceneData1);
+            impostors1.UpdateDrawCommands(sceneData1);
+        }
+        if (lodSelector.Update(sceneData2.mMeshData, sceneData2.mDrawTransforms, sceneData2.mShapes, camera.GetPosition(), fovY, (float)height))
+        {
+            mesh2.UpdateDrawCommands(sceneData2);
+            impostors2.UpdateDrawCommands(sceneData2);
+        }
+
         glDisable(GL_BLEND);
         program.UseProgram();
         mesh1.Draw(sceneData1);
         mesh2.Draw(sceneData2);
 
+        programImpostor.UseProgram();
+        impostors1.Draw(mesh1.GetVertexArray());
+        impostors2.Draw(mesh2.GetVertexArray());
+
         glEnable(GL_BLEND);
         progGrid.UseProgram();
         glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, 1, 0);
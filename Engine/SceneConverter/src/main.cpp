@@ -1,7 +1,17 @@
 #include <algorithm>
-#include <execution>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 
 #include <assimp/cimport.h>
 #include <assimp/material.h>
@@ -17,6 +27,14 @@
 #include "shared/scene/Material.h"
 #include "shared/scene/Scene.h"
 #include "shared/scene/MergeUtil.h"
+#include "shared/scene/DrawList.h"
+#include "shared/scene/ConversionCache.h"
+#include "shared/scene/Impostor.h"
+#include "shared/scene/Collision.h"
+#include "shared/scene/Skinning.h"
+#include "shared/TextureCompression.h"
+#include "shared/ConversionReport.h"
+#include "shared/EasyProfilerWrapper.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -24,27 +42,192 @@
 #include "stb_image_resize.h"
 
 #include <meshoptimizer.h>
+#include <taskflow/taskflow.hpp>
 
 namespace fs = std::filesystem;
 
-MeshData g_MeshData;
+// converted meshes, rescaled textures and complete scenes from previous runs
+ConversionCache g_Cache("../../../data/cache");
 
-uint32_t g_indexOffset = 0;
-uint32_t g_vertexOffset = 0;
+// per-stage timing, memory and I/O of this run (see main())
+ConversionReport g_Report;
+
+// worker pool shared by all scenes converted at the same time: meshes, texture blocks, impostors, collision proxies
+tf::Executor g_Executor;
+
+// outputs of the Bistro scenes combined by mergeBistro()
+const char* g_BistroInputs[] = {
+        "../../../data/meshes/test.meshes", "../../../data/meshes/test.scene", "../../../data/meshes/test.materials",
+        "../../../data/meshes/test2.meshes", "../../../data/meshes/test2.scene", "../../../data/meshes/test2.materials",
+        "../../../data/meshes/test.impostors", "../../../data/meshes/test2.impostors" };
 
 const uint32_t g_numElementsToStore = 3 + 3 + 2; // pos(vec3) + normal(vec3) + uv(vec2)
 
+/* LOD chain generation. Every LOD is simplified from the previous one. Errors are relative to the mesh extents (as in meshoptimizer) */
+struct LODConfig
+{
+    // explicit index count targets of LOD1, LOD2, ... relative to LOD0; if empty, every LOD keeps 'ratio' of the previous one
+    std::vector<float> ratios;
+    float ratio = 0.5f;
+
+    // maximum error of a single simplification step
+    float targetError = 0.02f;
+
+    // the chain stops once the accumulated error exceeds this value (0 - no limit)
+    float maxError = 0.0f;
+
+    // meshes (and LODs) with fewer indices are not simplified any further
+    uint32_t minIndices = 1024;
+
+    // number of LODs in addition to LOD0
+    uint32_t maxCount = kMaxLODs - 1;
+
+    // meshopt_simplifySloppy() ignores the mesh topology and does not preserve UV seams and hard normals
+    bool allowSloppy = false;
+};
+
 struct SceneConfig
 {
     std::string fileName;
     std::string outputMesh;
     std::string outputScene;
     std::string outputMaterials;
+    std::string outputImpostors;
+    std::string outputCollision;
     float scale;
     bool calculateLODs;
     bool mergeInstances;
+
+    // meshoptimizer stage for every LOD: exact welding, vertex cache, overdraw and vertex fetch optimization
+    bool optimizeMeshes = true;
+
+    LODConfig lods;
+
+    // Static batching: mesh nodes with at most this many triangles (0 disables the stage) or matching one of staticNodes
+    uint32_t staticBatchMaxTriangles = 0;
+    float staticBatchCellSize = 0.0f;
+    std::vector<std::string> staticNodes;
+
+    // Block compression of color textures (KTX with mips), None keeps PNG output. Normal maps always use the two-channel
+    // format of the same family (BC5, EAC RG11), BC1/ETC2 RGB textures with transparency are stored as BC3/ETC2 RGBA
+    eTextureCompression textureCompression = eTextureCompression::None;
+    float textureEffort = kDefaultETCEffort;
+
+    // Texture arrays: KTX textures up to this size (0 disables the stage) with the same format, size and mip count are packed
+    // into 2D arrays of at most textureArrayMaxLayers layers
+    uint32_t textureArrayMaxSize = 0;
+    uint32_t textureArrayMaxLayers = 256;
+
+    // Texture conversion: number of textures in flight and the estimated peak memory they may use together
+    // (scenes are converted at the same time and share the smallest budget of all configs)
+    uint32_t textureWorkers = std::thread::hardware_concurrency();
+    uint64_t textureMemoryBudget = 1024ull << 20;
+
+    // Impostors: meshes with a bounding sphere of at least this radius (0 disables the stage) get an octahedral impostor
+    // of impostorFrames x impostorFrames views, impostorFrameSize texels each, as their last LOD
+    float impostorMinRadius = 0.0f;
+    uint32_t impostorFrames = 8;
+    uint32_t impostorFrameSize = 64;
+
+    // Collision proxies for Bullet with prebuilt BVHs (see shared/scene/Collision.h)
+    bool calculateCollision = false;
+    CollisionSettings collision;
 };
 
+uint64_t hashLODConfig(const LODConfig& lods, uint64_t hash)
+{
+    hash = HashBytes(lods.ratios.data(), lods.ratios.size() * sizeof(float), ConversionCache::HashValue(lods.ratios.size(), hash));
+    hash = ConversionCache::HashValue(lods.ratio, hash);
+    hash = ConversionCache::HashValue(lods.targetError, hash);
+    hash = ConversionCache::HashValue(lods.maxError, hash);
+    hash = ConversionCache::HashValue(lods.minIndices, hash);
+    hash = ConversionCache::HashValue(lods.maxCount, hash);
+    return ConversionCache::HashValue(lods.allowSloppy, hash);
+}
+
+/* Cache key of a single converted mesh: all vertex attributes, faces and bone weights used by convertAIMesh() plus its settings */
+uint64_t hashAIMesh(const aiMesh* m, const SceneConfig& cfg)
+{
+    uint64_t hash = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+
+    hash = ConversionCache::HashValue(m->mNumVertices, hash);
+    hash = HashBytes(m->mVertices, m->mNumVertices * sizeof(aiVector3D), hash);
+    if (m->mNormals)
+        hash = HashBytes(m->mNormals, m->mNumVertices * sizeof(aiVector3D), hash);
+    hash = ConversionCache::HashValue(m->HasTextureCoords(0), hash);
+    if (m->HasTextureCoords(0))
+        hash = HashBytes(m->mTextureCoords[0], m->mNumVertices * sizeof(aiVector3D), hash);
+
+    for (unsigned int i = 0 ; i != m->mNumFaces ; i++)
+        hash = HashBytes(m->mFaces[i].mIndices, m->mFaces[i].mNumIndices * sizeof(unsigned int), ConversionCache::HashValue(m->mFaces[i].mNumIndices, hash));
+
+    for (unsigned int b = 0 ; b != m->mNumBones ; b++)
+        hash = HashBytes(m->mBones[b]->mWeights, m->mBones[b]->mNumWeights * sizeof(aiVertexWeight), ConversionCache::HashValue(m->mBones[b]->mNumWeights, hash));
+
+    hash = ConversionCache::HashValue(cfg.scale, hash);
+    hash = ConversionCache::HashValue(cfg.calculateLODs, hash);
+    hash = ConversionCache::HashValue(cfg.optimizeMeshes, hash);
+    return hashLODConfig(cfg.lods, hash);
+}
+
+/* Cache key of a whole scene: the input file, files next to it with the same name (.mtl, .bin) and all settings.
+   Textures are not part of the key, they are checked separately (see fetchCachedScene()) */
+uint64_t hashSceneInputs(const SceneConfig& cfg)
+{
+    uint64_t hash = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+
+    const fs::path input(cfg.fileName);
+    std::vector<std::string> inputs = { cfg.fileName };
+
+    std::error_code ec;
+    for (const auto& p: fs::directory_iterator(input.parent_path(), ec))
+        if (p.is_regular_file() && p.path().stem() == input.stem() && p.path().filename() != input.filename())
+            inputs.push_back(p.path().string());
+
+    // directory order is not stable
+    std::sort(inputs.begin() + 1, inputs.end());
+
+    for (const auto& f: inputs)
+        hash = ConversionCache::HashFile(f, ConversionCache::HashString(fs::path(f).filename().string(), hash));
+
+    hash = ConversionCache::HashValue(cfg.scale, hash);
+    hash = ConversionCache::HashValue(cfg.calculateLODs, hash);
+    hash = ConversionCache::HashValue(cfg.mergeInstances, hash);
+    hash = ConversionCache::HashValue(cfg.optimizeMeshes, hash);
+    hash = hashLODConfig(cfg.lods, hash);
+    hash = ConversionCache::HashValue(cfg.staticBatchMaxTriangles, hash);
+    hash = ConversionCache::HashValue(cfg.staticBatchCellSize, hash);
+    for (const auto& n: cfg.staticNodes)
+        hash = ConversionCache::HashString(n, hash);
+    hash = ConversionCache::HashValue(cfg.textureCompression, hash);
+    hash = ConversionCache::HashValue(cfg.textureEffort, hash);
+    hash = ConversionCache::HashValue(cfg.textureArrayMaxSize, hash);
+    hash = ConversionCache::HashValue(cfg.textureArrayMaxLayers, hash);
+    hash = ConversionCache::HashValue(cfg.impostorMinRadius, hash);
+    hash = ConversionCache::HashValue(cfg.impostorFrames, hash);
+    hash = ConversionCache::HashValue(cfg.impostorFrameSize, hash);
+    hash = ConversionCache::HashValue(cfg.calculateCollision, hash);
+    hash = ConversionCache::HashValue(cfg.collision.maxError, hash);
+    hash = ConversionCache::HashValue(cfg.collision.boxRadius, hash);
+    hash = ConversionCache::HashValue(cfg.collision.hullRadius, hash);
+
+    return hash;
+}
+
+/* Cheap change detection for many large files: size and modification time */
+uint64_t hashFileStamps(const std::vector<std::string>& files)
+{
+    uint64_t hash = HashBytes(nullptr, 0);
+    for (const auto& f: files)
+    {
+        std::error_code ec;
+        const auto size = fs::file_size(f, ec);
+        const auto time = fs::last_write_time(f, ec).time_since_epoch().count();
+        hash = ConversionCache::HashValue(time, ConversionCache::HashValue(size, ConversionCache::HashString(f, hash)));
+    }
+    return hash;
+}
+
 MaterialDescription convertAIMaterialToDescription(const aiMaterial* M, std::vector<std::string>& files, std::vector<std::string>& opacityMaps)
 {
     MaterialDescription D;
@@ -161,72 +344,271 @@ MaterialDescription convertAIMaterialToDescription(const aiMaterial* M, std::vec
     return D;
 }
 
-void processLods(std::vector<uint32_t>& indices, std::vector<float>& vertices, std::vector<std::vector<uint32_t>>& outLods)
+/* Meshes are converted in parallel, so their console output is collected per mesh and printed in mesh order afterwards */
+template <typename... Args>
+void appendLogLine(std::string& log, const char* format, Args... args)
+{
+    char line[256];
+    snprintf(line, sizeof(line), format, args...);
+    log += line;
+}
+
+/* outErrors receives the absolute simplification error of every LOD in the units of 'vertices' (accumulated over the chain).
+   meshopt_simplify() only collapses vertices with a split position (UV seams, hard normals) along the seam, so those are preserved
+   as long as the sloppy fallback is disabled. One line per LOD is appended to 'log' */
+void processLods(std::vector<uint32_t>& indices, std::vector<float>& vertices, const LODConfig& cfg,
+                 std::vector<std::vector<uint32_t>>& outLods, std::vector<float>& outErrors, std::string& log)
 {
-    size_t verticesCountIn = vertices.size() / 2;
-    size_t targetIndicesCount = indices.size();
+    const size_t verticesCountIn = vertices.size() / 3;
+    const size_t sourceIndicesCount = indices.size();
 
-    uint8_t LOD = 1;
+    // meshoptimizer reports errors relative to the mesh extents
+    const float errorScale = meshopt_simplifyScale(vertices.data(), verticesCountIn, sizeof(float) * 3);
+    float relativeError = 0.0f;
 
-    printf("\n   LOD0: %i indices", int(indices.size()));
+    appendLogLine(log, "\n   LOD0: %i indices", int(indices.size()));
 
     outLods.push_back(indices);
+    outErrors.push_back(0.0f);
+
+    // lodOffset[lodCount] is the end marker, so at most kMaxLODs - 1 LODs fit into a Mesh
+    const uint32_t maxLODs = std::min(cfg.maxCount, kMaxLODs - 1);
 
-    while ( targetIndicesCount > 1024 && LOD < 8 )
+    for (uint32_t LOD = 1 ; LOD <= maxLODs && indices.size() > cfg.minIndices ; LOD++)
     {
-        targetIndicesCount = indices.size() / 2;
+        const float ratio = cfg.ratios.empty() ?
+                std::pow(cfg.ratio, (float)LOD) :
+                cfg.ratios[std::min<size_t>(LOD - 1, cfg.ratios.size() - 1)];
+
+        // targets are rounded down to whole triangles
+        size_t targetIndicesCount = std::max<size_t>((size_t)((float)sourceIndicesCount * ratio) / 3 * 3, 3);
+        if (targetIndicesCount >= indices.size())
+            targetIndicesCount = indices.size() / 2 / 3 * 3;
 
         bool sloppy = false;
+        float error = 0.0f;
 
         size_t numOptIndices = meshopt_simplify(
                 indices.data(),
-                indices.data(), (uint32_t)indices.size(),
+                indices.data(), indices.size(),
                 vertices.data(), verticesCountIn,
                 sizeof( float ) * 3,
-                targetIndicesCount, 0.02f );
+                targetIndicesCount, cfg.targetError, &error );
 
         // cannot simplify further
-        if (static_cast<size_t>(numOptIndices * 1.1f) > indices.size())
+        if (static_cast<size_t>((float)numOptIndices * 1.1f) > indices.size())
         {
-            if (LOD > 1)
+            if (!cfg.allowSloppy || LOD == 1)
             {
-                // try harder
-                numOptIndices = meshopt_simplifySloppy(
-                        indices.data(),
-                        indices.data(), indices.size(),
-                        vertices.data(), verticesCountIn,
-                        sizeof(float) * 3,
-                        targetIndicesCount, 0.02f, nullptr);
-                sloppy = true;
-                if (numOptIndices == indices.size()) break;
+                appendLogLine(log, "\n   LOD%u: cannot simplify %i indices further within error %f", LOD, int(indices.size()), cfg.targetError);
+                break;
             }
-            else
+
+            // try harder, at the cost of UV seams and hard normals
+            numOptIndices = meshopt_simplifySloppy(
+                    indices.data(),
+                    indices.data(), indices.size(),
+                    vertices.data(), verticesCountIn,
+                    sizeof(float) * 3,
+                    targetIndicesCount, cfg.targetError, &error);
+            sloppy = true;
+            if (numOptIndices == 0 || numOptIndices == indices.size())
                 break;
         }
 
+        // every LOD is simplified from the previous one, so the errors add up
+        if (cfg.maxError > 0.0f && relativeError + error > cfg.maxError)
+        {
+            appendLogLine(log, "\n   LOD%u: error %f exceeds the budget %f", LOD, relativeError + error, cfg.maxError);
+            break;
+        }
+        relativeError += error;
+
         indices.resize(numOptIndices);
 
-        meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), verticesCountIn);
+        appendLogLine(log, "\n   LOD%u: %i indices %s, error %f", LOD, int(numOptIndices), sloppy ? "[sloppy]" : "", relativeError * errorScale);
 
-        printf("\n   LOD%i: %i indices %s", int(LOD), int(numOptIndices), sloppy ? "[sloppy]" : "");
+        outLods.push_back(indices);
+        outErrors.push_back(relativeError * errorScale);
+    }
+}
 
-        LOD++;
+/* Append per-vertex bone indices (into m->mBones) and normalized weights. aiProcess_LimitBoneWeights keeps at most 4 influences,
+   but if there are more anyway the smallest ones are dropped */
+void convertAIBoneWeights(const aiMesh* m, std::vector<VertexBoneData>& skinData)
+{
+    const size_t first = skinData.size();
+    skinData.resize(first + m->mNumVertices);
 
-        outLods.push_back(indices);
+    for (unsigned int b = 0 ; b != m->mNumBones ; b++)
+    {
+        const aiBone* bone = m->mBones[b];
+        for (unsigned int w = 0 ; w != bone->mNumWeights ; w++)
+        {
+            const aiVertexWeight& vw = bone->mWeights[w];
+            VertexBoneData& d = skinData[first + vw.mVertexId];
+
+            uint32_t slot = 0;
+            for (uint32_t k = 1 ; k != kMaxBonesPerVertex ; k++)
+                if (d.mWeight[k] < d.mWeight[slot])
+                    slot = k;
+
+            if (d.mWeight[slot] < vw.mWeight)
+            {
+                d.mBoneIndex[slot] = b;
+                d.mWeight[slot] = vw.mWeight;
+            }
+        }
+    }
+
+    for (size_t i = first ; i != skinData.size() ; i++)
+    {
+        VertexBoneData& d = skinData[i];
+        const float sum = d.mWeight[0] + d.mWeight[1] + d.mWeight[2] + d.mWeight[3];
+        if (sum > 0.0f)
+            for (float& w : d.mWeight)
+                w /= sum;
+    }
+}
+
+/* Vertex cache, overdraw and vertex fetch efficiency of LOD0 before and after the meshoptimizer stage.
+   ACMR and overdraw are weighted by triangles, ATVR and overfetch by vertices, so the statistics of meshes can be summed up */
+struct MeshOptimizationStats
+{
+    enum { Before = 0, After = 1 };
+
+    double numTriangles[2] = {};
+    double numVertices[2] = {};
+    double acmr[2] = {};
+    double atvr[2] = {};
+    double overdraw[2] = {};
+    double overfetch[2] = {};
+
+    void add(const MeshOptimizationStats& other)
+    {
+        for (int i = 0; i != 2; i++)
+        {
+            numTriangles[i] += other.numTriangles[i];
+            numVertices[i] += other.numVertices[i];
+            acmr[i] += other.acmr[i];
+            atvr[i] += other.atvr[i];
+            overdraw[i] += other.overdraw[i];
+            overfetch[i] += other.overfetch[i];
+        }
+    }
+
+    void analyze(int stage, const std::vector<uint32_t>& indices, const std::vector<float>& vertices)
+    {
+        const size_t vertexCount = vertices.size() / g_numElementsToStore;
+        if (indices.empty() || vertexCount == 0)
+            return;
+
+        const double triangles = (double)indices.size() / 3.0;
+        const auto cache = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertexCount, 16, 0, 0);
+        const auto overdrawStats = meshopt_analyzeOverdraw(indices.data(), indices.size(), vertices.data(), vertexCount, sizeof(float) * g_numElementsToStore);
+        const auto fetch = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertexCount, sizeof(float) * g_numElementsToStore);
+
+        numTriangles[stage] += triangles;
+        numVertices[stage] += (double)vertexCount;
+        acmr[stage] += cache.acmr * triangles;
+        atvr[stage] += cache.atvr * (double)vertexCount;
+        overdraw[stage] += overdrawStats.overdraw * triangles;
+        overfetch[stage] += fetch.overfetch * (double)vertexCount;
+    }
+
+    void print() const
+    {
+        if (numTriangles[Before] == 0.0 || numTriangles[After] == 0.0)
+            return;
+
+        printf("Mesh optimization: %.0f -> %.0f vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overdraw %.3f -> %.3f, overfetch %.3f -> %.3f\n",
+               numVertices[Before], numVertices[After],
+               acmr[Before] / numTriangles[Before], acmr[After] / numTriangles[After],
+               atvr[Before] / numVertices[Before], atvr[After] / numVertices[After],
+               overdraw[Before] / numTriangles[Before], overdraw[After] / numTriangles[After],
+               overfetch[Before] / numVertices[Before], overfetch[After] / numVertices[After]);
+    }
+};
+
+/* Merge bitwise identical vertices: all attributes and bone weights have to match. srcVertices (unscaled positions for
+   LOD generation) may be empty */
+void weldVertices(std::vector<float>& vertices, std::vector<VertexBoneData>& skinData, std::vector<float>& srcVertices, std::vector<uint32_t>& indices)
+{
+    const size_t vertexCount = vertices.size() / g_numElementsToStore;
+    if (indices.empty() || vertexCount == 0)
+        return;
+
+    std::vector<meshopt_Stream> streams = { { vertices.data(), sizeof(float) * g_numElementsToStore, sizeof(float) * g_numElementsToStore } };
+    if (!skinData.empty())
+        streams.push_back({ skinData.data(), sizeof(VertexBoneData), sizeof(VertexBoneData) });
+
+    std::vector<uint32_t> remap(vertexCount);
+    const size_t uniqueCount = meshopt_generateVertexRemapMulti(remap.data(), indices.data(), indices.size(), vertexCount, streams.data(), streams.size());
+
+    meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+    std::vector<float> newVertices(uniqueCount * g_numElementsToStore);
+    meshopt_remapVertexBuffer(newVertices.data(), vertices.data(), vertexCount, sizeof(float) * g_numElementsToStore, remap.data());
+    vertices = std::move(newVertices);
+
+    if (!skinData.empty())
+    {
+        std::vector<VertexBoneData> newSkinData(uniqueCount);
+        meshopt_remapVertexBuffer(newSkinData.data(), skinData.data(), vertexCount, sizeof(VertexBoneData), remap.data());
+        skinData = std::move(newSkinData);
+    }
+
+    if (!srcVertices.empty())
+    {
+        std::vector<float> newSrcVertices(uniqueCount * 3);
+        meshopt_remapVertexBuffer(newSrcVertices.data(), srcVertices.data(), vertexCount, sizeof(float) * 3, remap.data());
+        srcVertices = std::move(newSrcVertices);
     }
 }
 
-Mesh convertAIMesh(const aiMesh* m, const SceneConfig& cfg)
+/* Reorder vertices by their first use in the LODs (LOD0 first, coarser LODs use a subset of its vertices) and drop unused ones */
+void optimizeVertexFetch(std::vector<float>& vertices, std::vector<VertexBoneData>& skinData, std::vector<std::vector<uint32_t>>& lods)
+{
+    const size_t vertexCount = vertices.size() / g_numElementsToStore;
+
+    std::vector<uint32_t> allIndices;
+    for (const auto& lod: lods)
+        allIndices.insert(allIndices.end(), lod.begin(), lod.end());
+
+    if (allIndices.empty() || vertexCount == 0)
+        return;
+
+    std::vector<uint32_t> remap(vertexCount);
+    const size_t usedCount = meshopt_optimizeVertexFetchRemap(remap.data(), allIndices.data(), allIndices.size(), vertexCount);
+
+    for (auto& lod: lods)
+        meshopt_remapIndexBuffer(lod.data(), lod.data(), lod.size(), remap.data());
+
+    std::vector<float> newVertices(usedCount * g_numElementsToStore);
+    meshopt_remapVertexBuffer(newVertices.data(), vertices.data(), vertexCount, sizeof(float) * g_numElementsToStore, remap.data());
+    vertices = std::move(newVertices);
+
+    if (!skinData.empty())
+    {
+        std::vector<VertexBoneData> newSkinData(usedCount);
+        meshopt_remapVertexBuffer(newSkinData.data(), skinData.data(), vertexCount, sizeof(VertexBoneData), remap.data());
+        skinData = std::move(newSkinData);
+    }
+}
+
+/* Convert a single mesh into its own private buffers (out.mVertexData, out.mIndexData, out.mSkinData).
+   All offsets in the returned Mesh are relative to these buffers, see appendConvertedMesh() */
+Mesh convertAIMesh(const aiMesh* m, const SceneConfig& cfg, MeshData& out, MeshOptimizationStats& stats, std::string& lodLog)
 {
     const bool hasTexCoords = m->HasTextureCoords(0);
     const auto streamElementSize = static_cast<uint32_t>(g_numElementsToStore * sizeof(float));
 
     Mesh result = {
             .streamCount = 1,
-            .indexOffset = g_indexOffset,
-            .vertexOffset = g_vertexOffset,
+            .indexOffset = 0,
+            .vertexOffset = 0,
             .vertexCount = m->mNumVertices,
-            .streamOffset = { g_vertexOffset * streamElementSize },
+            .streamOffset = { 0 },
             .streamElementSize = { streamElementSize }
     };
 
@@ -235,8 +617,10 @@ Mesh convertAIMesh(const aiMesh* m, const SceneConfig& cfg)
     std::vector<uint32_t> srcIndices;
 
     std::vector<std::vector<uint32_t>> outLods;
+    std::vector<float> outErrors;
 
-    auto& vertices = g_MeshData.vertexData_;
+    auto& vertices = out.mVertexData;
+    vertices.reserve(m->mNumVertices * g_numElementsToStore);
 
     for (size_t i = 0; i != m->mNumVertices; i++)
     {
@@ -263,6 +647,15 @@ Mesh convertAIMesh(const aiMesh* m, const SceneConfig& cfg)
         vertices.push_back(n.z);
     }
 
+    if (m->HasBones())
+    {
+        convertAIBoneWeights(m, out.mSkinData);
+
+        result.streamCount = 2;
+        result.streamOffset[1] = 0;
+        result.streamElementSize[1] = sizeof(VertexBoneData);
+    }
+
     for (size_t i = 0; i != m->mNumFaces; i++)
     {
         if (m->mFaces[i].mNumIndices != 3)
@@ -271,33 +664,82 @@ Mesh convertAIMesh(const aiMesh* m, const SceneConfig& cfg)
             srcIndices.push_back(m->mFaces[i].mIndices[j]);
     }
 
+    if (cfg.optimizeMeshes)
+    {
+        stats.analyze(MeshOptimizationStats::Before, srcIndices, vertices);
+        weldVertices(vertices, out.mSkinData, srcVertices, srcIndices);
+    }
+
     if (!cfg.calculateLODs)
+    {
         outLods.push_back(srcIndices);
+    }
     else
-        processLods(srcIndices, srcVertices, outLods);
+    {
+        ConversionReport::Item lodItem(g_Report, "lods", m->mName.C_Str());
+        processLods(srcIndices, srcVertices, cfg.lods, outLods, outErrors, lodLog);
+    }
+
+    const size_t vertexCount = vertices.size() / g_numElementsToStore;
+    for (size_t l = 0 ; l < outLods.size() ; l++)
+    {
+        auto& lod = outLods[l];
+
+        // assimp already improved the cache locality of the source mesh
+        if (cfg.optimizeMeshes || l > 0)
+            meshopt_optimizeVertexCache(lod.data(), lod.data(), lod.size(), vertexCount);
 
-    printf("\nCalculated LOD count: %u\n", (unsigned)outLods.size());
+        // reorder triangle clusters front to back where it barely hurts the vertex cache
+        if (cfg.optimizeMeshes)
+            meshopt_optimizeOverdraw(lod.data(), lod.data(), lod.size(), vertices.data(), vertexCount, sizeof(float) * g_numElementsToStore, 1.05f);
+    }
+
+    if (cfg.optimizeMeshes)
+    {
+        optimizeVertexFetch(vertices, out.mSkinData, outLods);
+        result.vertexCount = (uint32_t)(vertices.size() / g_numElementsToStore);
+        stats.analyze(MeshOptimizationStats::After, outLods[0], vertices);
+    }
 
     uint32_t numIndices = 0;
 
     for (size_t l = 0 ; l < outLods.size() ; l++)
     {
         for (unsigned int i : outLods[l])
-            g_MeshData.indexData_.push_back(i);
+            out.mIndexData.push_back(i);
 
         result.lodOffset[l] = numIndices;
         numIndices += (int)outLods[l].size();
+
+        // LODs are calculated from the unscaled source vertices
+        if (l < outErrors.size())
+            result.lodError[l] = outErrors[l] * cfg.scale;
     }
 
     result.lodOffset[outLods.size()] = numIndices;
     result.lodCount = (uint32_t)outLods.size();
 
-    g_indexOffset  += numIndices;
-    g_vertexOffset += m->mNumVertices;
-
     return result;
 }
 
+/* Append a privately converted mesh to the combined mesh data. Called in mesh order, this is the prefix sum of all the offsets,
+   so the result does not depend on the order in which the meshes were converted */
+void appendConvertedMesh(MeshData& meshData, const MeshData& converted, Mesh mesh)
+{
+    const auto vertexOffset = (uint32_t)(meshData.mVertexData.size() / g_numElementsToStore);
+
+    mesh.indexOffset = (uint32_t)meshData.mIndexData.size();
+    mesh.vertexOffset = vertexOffset;
+    mesh.streamOffset[0] = vertexOffset * mesh.streamElementSize[0];
+    if (IsSkinnedMesh(mesh))
+        mesh.streamOffset[1] = (uint32_t)(meshData.mSkinData.size() * sizeof(VertexBoneData));
+
+    mergeVectors(meshData.mVertexData, converted.mVertexData);
+    mergeVectors(meshData.mIndexData, converted.mIndexData);
+    mergeVectors(meshData.mSkinData, converted.mSkinData);
+    meshData.mMeshes.push_back(mesh);
+}
+
 void makePrefix(int ofs) { for(int i = 0 ; i < ofs ; i++) printf("\t"); }
 
 void printMat4(const aiMatrix4x4& m)
@@ -367,6 +809,52 @@ void traverse(const aiScene* sourceScene, Scene& scene, aiNode* N, int parent, i
         traverse(sourceScene, scene, N->mChildren[n], newNode, ofs + 1);
 }
 
+/* Create a Skin for every node which references a mesh with bones. Joints are looked up by name, so this runs after traverse().
+   Vertices were scaled by cfg.scale, hence the scale is undone before the (unscaled) inverse bind matrix and reapplied at the end */
+void convertAISkins(const aiScene* sourceScene, Scene& scene, float scale)
+{
+    std::unordered_map<std::string, uint32_t> nodeForName;
+    for (uint32_t node = 0 ; node != (uint32_t)scene.mHierarchy.size() ; node++)
+    {
+        const auto it = scene.mNameForNode.find(node);
+        if (it != scene.mNameForNode.end())
+            nodeForName.emplace(scene.mNames[it->second], node);
+    }
+
+    const glm::mat4 unscale = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / scale));
+
+    // the same mesh may be instanced several times, every instance gets its own skin
+    for (uint32_t node = 0 ; node != (uint32_t)scene.mHierarchy.size() ; node++)
+    {
+        const auto meshIt = scene.mMeshes.find(node);
+        if (meshIt == scene.mMeshes.end())
+            continue;
+
+        const aiMesh* m = sourceScene->mMeshes[meshIt->second];
+        if (!m->HasBones())
+            continue;
+
+        Skin skin;
+        skin.mBindShapeMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+
+        for (unsigned int b = 0 ; b != m->mNumBones ; b++)
+        {
+            const auto jointIt = nodeForName.find(m->mBones[b]->mName.C_Str());
+            if (jointIt == nodeForName.end())
+                printf("Joint node '%s' not found\n", m->mBones[b]->mName.C_Str());
+
+            skin.mJoints.push_back(jointIt != nodeForName.end() ? jointIt->second : 0);
+            skin.mInverseBindMatrices.push_back(toMat4(m->mBones[b]->mOffsetMatrix) * unscale);
+        }
+
+        scene.mSkinForNode[node] = (uint32_t)scene.mSkins.size();
+        scene.mSkins.push_back(std::move(skin));
+    }
+
+    if (!scene.mSkins.empty())
+        printf("Skinned mesh nodes: %u\n", (uint32_t)scene.mSkins.size());
+}
+
 void dumpMaterial(const std::vector<std::string>& files, const MaterialDescription& d)
 {
     printf("files: %d\n", (int)files.size());
@@ -421,40 +909,146 @@ std::string fixTextureFile(const std::string& file)
     return fs::exists(file) ? file : findSubstitute(file);
 }
 
-std::string convertTexture(const std::string& file, const std::string& basePath, std::unordered_map<std::string, uint32_t>& opacityMapIndices, const std::vector<std::string>& opacityMaps)
+/* Textures converted (or being converted) by all scenes of this run. The first task to claim an output file or the content of
+   its decoded pixels with the conversion settings converts it, later tasks wait for it and reuse the result */
+struct ConvertedTextures
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<std::string>> outputs;
+    std::unordered_map<uint64_t, std::shared_future<std::string>> contents;
+
+    // impostor atlases claimed for baking (see bakeImpostors())
+    std::unordered_set<uint64_t> impostors;
+
+    // texture arrays of different scenes may have the same name
+    std::mutex arrayMutex;
+};
+
+ConvertedTextures g_ConvertedTextures;
+
+/* Memory shared by all textures in flight. A texture reserves its estimated peak before decoding and waits until it fits,
+   requests larger than the whole budget wait for everything else to finish */
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(uint64_t bytes): total(std::max(bytes, (uint64_t)1)), available(total) {}
+
+    /* Only while nothing is reserved */
+    void reset(uint64_t bytes)
+    {
+        std::lock_guard lock(mutex);
+        total = available = std::max(bytes, (uint64_t)1);
+    }
+
+    uint64_t acquire(uint64_t bytes)
+    {
+        bytes = std::min(bytes, total);
+        std::unique_lock lock(mutex);
+        released.wait(lock, [&] { return available >= bytes; });
+        available -= bytes;
+        return bytes;
+    }
+
+    void release(uint64_t bytes)
+    {
+        {
+            std::lock_guard lock(mutex);
+            available += bytes;
+        }
+        released.notify_all();
+    }
+
+private:
+    uint64_t total;
+    uint64_t available;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+/* Peak memory of one texture at the encode stage per output pixel: RGBA8 mip chain, float working copies of two levels
+   and the float image handed to etc2comp */
+constexpr uint64_t kEncodeBytesPerPixel = 64;
+
+// shared by all scenes, see main()
+MemoryBudget g_TextureBudget(1024ull << 20);
+
+std::string convertTexture(const std::string& file, const std::string& basePath, const std::unordered_map<std::string, uint32_t>& opacityMapIndices, const std::vector<std::string>& opacityMaps,
+                           eTextureCompression compression, float effort, const MipChainOptions& mipOptions, ConvertedTextures& converted, MemoryBudget& budget)
 {
     const int maxNewWidth = 512;
     const int maxNewHeight = 512;
 
+    if (mipOptions.mNormalMap)
+        compression = GetNormalMapCompression(compression);
+
+    const char* ext = (compression == eTextureCompression::None) ? ".png" : ".ktx";
+
     const auto srcFile = replaceAll(basePath + file, "\\",  "/");
-    auto newFile = std::string("../../../data/out_textures/") + lowercaseString(replaceAll(replaceAll(srcFile, "..", "__"), "/", "__") + std::string("__rescaled")) + std::string(".png");
+    ConversionReport::Item item(g_Report, "texture", srcFile);
 
-    // load this image
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(fixTextureFile(srcFile).c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    uint8_t* src = pixels;
-    texChannels = STBI_rgb_alpha;
+    auto newFile = std::string("../../../data/out_textures/") + lowercaseString(replaceAll(replaceAll(srcFile, "..", "__"), "/", "__") + std::string("__rescaled")) + std::string(ext);
+
+    // the same output is converted once even if several scenes use it, every return below fulfils 'result'
+    std::promise<std::string> result;
+    const std::shared_future<std::string> resultFuture = result.get_future().share();
+    {
+        std::unique_lock lock(converted.mutex);
+        const auto [it, inserted] = converted.outputs.try_emplace(newFile, resultFuture);
+        if (!inserted)
+        {
+            const auto other = it->second;
+            lock.unlock();
+            return other.get();
+        }
+    }
+    auto finish = [&result](const std::string& f) { result.set_value(f); return f; };
+
+    const auto opacityIt = opacityMapIndices.find(file);
+    const bool hasOpacityMap = opacityIt != opacityMapIndices.end();
+    const auto opacityMapFile = hasOpacityMap ? fixTextureFile(replaceAll(basePath + opacityMaps.at(opacityIt->second), "\\", "/")) : std::string();
 
-    std::vector<uint8_t> tmpImage(maxNewWidth * maxNewHeight * 4);
+    uint64_t settingsKey = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+    settingsKey = ConversionCache::HashValue(maxNewHeight, ConversionCache::HashValue(maxNewWidth, settingsKey));
+    settingsKey = ConversionCache::HashValue(effort, ConversionCache::HashValue(compression, settingsKey));
+    settingsKey = ConversionCache::HashValue(mipOptions.mAlphaCutoff, ConversionCache::HashValue(mipOptions.mNormalMap, ConversionCache::HashValue(mipOptions.mSRGB, settingsKey)));
 
-    if (!src)
+    uint64_t key = ConversionCache::HashFile(fixTextureFile(srcFile), settingsKey);
+    if (hasOpacityMap)
+        key = ConversionCache::HashFile(opacityMapFile, key);
+
+    if (g_Cache.Fetch(key, ext, newFile))
     {
-        printf("Failed to load [%s] texture\n", srcFile.c_str());
-        texWidth = maxNewWidth;
-        texHeight = maxNewHeight;
-        texChannels = STBI_rgb_alpha;
-        src = tmpImage.data();
+        printf("Cached [%s] texture\n", srcFile.c_str());
+        return finish(newFile);
     }
+
+    // Reserve the peak memory of this texture: the decoded image with its opacity mask until the resize stage,
+    // the output image until the end. The header is enough to know the size
+    int texWidth = 0, texHeight = 0, texChannels = 0;
+    if (!stbi_info(fixTextureFile(srcFile).c_str(), &texWidth, &texHeight, &texChannels))
+        texWidth = texHeight = 0;
+
+    const int newW = texWidth ? std::min(texWidth, maxNewWidth) : maxNewWidth;
+    const int newH = texHeight ? std::min(texHeight, maxNewHeight) : maxNewHeight;
+
+    const uint64_t decodeBytes = (uint64_t)texWidth * texHeight * (hasOpacityMap ? 5 : 4);
+    const uint64_t encodeBytes = (uint64_t)newW * newH * kEncodeBytesPerPixel;
+    uint64_t reserved = budget.acquire(decodeBytes + encodeBytes);
+
+    // 1. Decode
+    stbi_uc* pixels = stbi_load(fixTextureFile(srcFile).c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    texChannels = STBI_rgb_alpha;
+
+    if (!pixels)
+        printf("Failed to load [%s] texture\n", srcFile.c_str());
     else
-    {
         printf("Loaded [%s] %dx%d texture with %d channels\n", srcFile.c_str(), texWidth, texHeight, texChannels);
-    }
 
-    if (opacityMapIndices.count(file) > 0)
+    // 2. Merge the opacity mask into the alpha component of this image
+    if (pixels && hasOpacityMap)
     {
-        const auto opacityMapFile = replaceAll(basePath + opacityMaps[opacityMapIndices[file]], "\\", "/");
         int opacityWidth, opacityHeight;
-        stbi_uc* opacityPixels = stbi_load(fixTextureFile(opacityMapFile).c_str(), &opacityWidth, &opacityHeight, nullptr, 1);
+        stbi_uc* opacityPixels = stbi_load(opacityMapFile.c_str(), &opacityWidth, &opacityHeight, nullptr, 1);
 
         if (!opacityPixels)
         {
@@ -465,48 +1059,639 @@ std::string convertTexture(const std::string& file, const std::string& basePath,
         assert(texWidth == opacityWidth);
         assert(texHeight == opacityHeight);
 
-        // store the opacity mask in the alpha component of this image
-        if (opacityPixels)
+        if (opacityPixels && texWidth == opacityWidth && texHeight == opacityHeight)
             for (int y = 0; y != opacityHeight; y++)
                 for (int x = 0; x != opacityWidth; x++)
-                    src[(y * opacityWidth + x) * texChannels + 3] = opacityPixels[y * opacityWidth + x];
+                    pixels[(y * opacityWidth + x) * texChannels + 3] = opacityPixels[y * opacityWidth + x];
 
         stbi_image_free(opacityPixels);
     }
 
-    const uint32_t imgSize = texWidth * texHeight * texChannels;
-    std::vector<uint8_t> mipData(imgSize);
-    uint8_t* dst = mipData.data();
-
-    const int newW = std::min(texWidth, maxNewWidth);
-    const int newH = std::min(texHeight, maxNewHeight);
+    // the same image under another name (or in another folder) is converted only once
+    if (pixels)
+    {
+        const uint64_t contentKey = HashBytes(pixels, (size_t)texWidth * texHeight * texChannels,
+                                              ConversionCache::HashValue(texHeight, ConversionCache::HashValue(texWidth, settingsKey)));
 
-    stbir_resize_uint8(src, texWidth, texHeight, 0, dst, newW, newH, 0, texChannels);
+        std::unique_lock lock(converted.mutex);
+        const auto [it, inserted] = converted.contents.try_emplace(contentKey, resultFuture);
+        if (!inserted)
+        {
+            const auto other = it->second;
+            lock.unlock();
+            stbi_image_free(pixels);
+            budget.release(reserved);
+            const std::string original = other.get();
+            printf("[%s] is a duplicate of [%s]\n", srcFile.c_str(), original.c_str());
+            return finish(original);
+        }
+    }
 
-    stbi_write_png(newFile.c_str(), newW, newH, texChannels, dst, 0);
+    // 3. Resize into a scratch buffer of the output size which is reused by all textures converted on this thread.
+    // Textures which failed to load become black
+    static thread_local std::vector<uint8_t> resized;
+    resized.assign((size_t)newW * newH * texChannels, 0);
+    uint8_t* dst = resized.data();
 
     if (pixels)
+    {
+        // color textures are resized in linear light, just like their mip levels
+        if (mipOptions.mSRGB && !mipOptions.mNormalMap)
+            stbir_resize_uint8_srgb(pixels, texWidth, texHeight, 0, dst, newW, newH, 0, texChannels, 3, 0);
+        else
+            stbir_resize_uint8(pixels, texWidth, texHeight, 0, dst, newW, newH, 0, texChannels);
+
+        // the full-resolution image is not needed anymore
         stbi_image_free(pixels);
+        const uint64_t decodeReserved = std::min(reserved, decodeBytes);
+        budget.release(decodeReserved);
+        reserved -= decodeReserved;
+    }
+
+    // 4. Encode and 5. write
+    if (compression == eTextureCompression::None)
+    {
+        stbi_write_png(newFile.c_str(), newW, newH, texChannels, dst, 0);
+    }
+    else
+    {
+        // stb_dxt and ETC2 RGB only produce opaque blocks
+        bool hasAlpha = false;
+        for (int i = 0 ; i != newW * newH && !hasAlpha ; i++)
+            hasAlpha = dst[i * 4 + 3] != 255;
+        if (hasAlpha)
+            compression = GetAlphaCompression(compression);
+
+        if (!SaveCompressedKTX(newFile.c_str(), compression, dst, newW, newH, &g_Executor, effort, mipOptions))
+            printf("Failed to save [%s]\n", newFile.c_str());
+    }
+
+    budget.release(reserved);
 
-    return newFile;
+    if (pixels)
+        g_Cache.Store(key, ext, newFile);
+
+    return finish(newFile);
 }
 
+/* Staged texture conversion (decode, merge opacity, resize, encode, write). cfg.textureWorkers textures of this scene move
+   through the stages at the same time as long as the estimated peak memory of all scenes fits into g_TextureBudget */
 void convertAndDownscaleAllTextures(
-        const std::vector<MaterialDescription>& materials, const std::string& basePath, std::vector<std::string>& files, std::vector<std::string>& opacityMaps
+        std::vector<MaterialDescription>& materials, const std::string& basePath, std::vector<std::string>& files, std::vector<std::string>& opacityMaps,
+        const SceneConfig& cfg
 )
 {
     std::unordered_map<std::string, uint32_t> opacityMapIndices(files.size());
+    // how the mip chain of every texture is filtered, textures without a known role are treated as sRGB colors
+    std::unordered_map<std::string, MipChainOptions> mipOptions;
 
     for (const auto& m : materials)
+    {
         if (m.mOpacityMap != 0xFFFFFFFF && m.mAlbedoMap != 0xFFFFFFFF)
             opacityMapIndices[files[m.mAlbedoMap]] = (uint32_t)m.mOpacityMap;
+        if (m.mNormalMap != 0xFFFFFFFF)
+        {
+            mipOptions[files[m.mNormalMap]].mNormalMap = true;
+            mipOptions[files[m.mNormalMap]].mSRGB = false;
+        }
+        if (m.mMetallicRoughnessMap != 0xFFFFFFFF)
+            mipOptions[files[m.mMetallicRoughnessMap]].mSRGB = false;
+        if (m.mAmbientOcclusionMap != 0xFFFFFFFF)
+            mipOptions[files[m.mAmbientOcclusionMap]].mSRGB = false;
+        if (m.mAlbedoMap != 0xFFFFFFFF && m.mAlphaTest > 0.0f)
+            mipOptions[files[m.mAlbedoMap]].mAlphaCutoff = m.mAlphaTest;
+    }
+
+    // blocks of every texture are compressed by the shared pool, the textures themselves are handled by a separate set of workers
+    // (they block on the memory budget and on textures converted by other scenes)
+    tf::Executor textureExecutor(std::max(cfg.textureWorkers, 1u));
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index((size_t)0, files.size(), (size_t)1, [&](size_t i)
+    {
+        const auto it = mipOptions.find(files[i]);
+        files[i] = convertTexture(files[i], basePath, opacityMapIndices, opacityMaps, cfg.textureCompression, cfg.textureEffort,
+                                  it != mipOptions.end() ? it->second : MipChainOptions(), g_ConvertedTextures, g_TextureBudget);
+    });
+    textureExecutor.run(taskflow).wait();
+
+    // Duplicates decoded in this run (by any scene) share an output file already, textures taken from the cache are compared by their
+    // (deterministic) output contents. Every unique output is kept once and the material maps are remapped to it
+    std::unordered_map<std::string, uint64_t> indexForFile;
+    std::unordered_map<uint64_t, uint64_t> indexForContent;
+    std::vector<uint64_t> remap(files.size());
+    std::vector<std::string> uniqueFiles;
+
+    for (size_t i = 0; i != files.size(); i++)
+    {
+        auto [fileIt, newFile] = indexForFile.try_emplace(files[i], uniqueFiles.size());
+        if (newFile && fs::exists(files[i]))
+        {
+            const auto [contentIt, newContent] = indexForContent.try_emplace(ConversionCache::HashFile(files[i], HashBytes(nullptr, 0)), uniqueFiles.size());
+            fileIt->second = contentIt->second;
+            newFile = newContent;
+        }
+        if (newFile)
+            uniqueFiles.push_back(files[i]);
+        remap[i] = fileIt->second;
+    }
+
+    if (uniqueFiles.size() == files.size())
+        return;
+
+    printf("Texture deduplication: %u -> %u textures\n", (uint32_t)files.size(), (uint32_t)uniqueFiles.size());
+
+    auto remapMap = [&remap](uint64_t* map)
+    {
+        if (*map < INVALID_TEXTURE)
+            *map = remap[*map];
+    };
+
+    for (auto& m: materials)
+    {
+        remapMap(&m.mAmbientOcclusionMap);
+        remapMap(&m.mEmissiveMap);
+        remapMap(&m.mAlbedoMap);
+        remapMap(&m.mMetallicRoughnessMap);
+        remapMap(&m.mNormalMap);
+    }
+
+    files = std::move(uniqueFiles);
+}
+
+/* Pack small converted textures into 2D texture arrays, grouped by format, size and mip count. Material maps are remapped to
+   the array file and the layer inside it, which leaves far fewer textures (and bindless handles) to create at runtime.
+   Layers do not bleed into each other, so neither gutters nor UV transforms are needed and repeating UVs keep working */
+void packSmallTextures(const SceneConfig& cfg, std::vector<MaterialDescription>& materials, std::vector<std::string>& files)
+{
+    if (cfg.textureArrayMaxSize == 0)
+        return;
+
+    std::map<std::tuple<uint32_t, int, int, int>, std::vector<uint32_t>> groups;
+    for (uint32_t i = 0; i != (uint32_t)files.size(); i++)
+    {
+        KTXImageInfo info;
+        if (!GetKTXImageInfo(files[i].c_str(), info))
+            continue;
+        if (info.mWidth <= (int)cfg.textureArrayMaxSize && info.mHeight <= (int)cfg.textureArrayMaxSize)
+            groups[{ info.mFormat, info.mWidth, info.mHeight, info.mLevels }].push_back(i);
+    }
+
+    // new file index and layer of every texture
+    std::vector<std::pair<uint64_t, uint16_t>> remap(files.size(), { INVALID_TEXTURE, 0 });
+    std::vector<bool> packed(files.size(), false);
+    std::vector<std::string> newFiles;
+
+    std::vector<std::pair<std::string, std::vector<uint32_t>>> arrays;
+    for (const auto& [k, indices]: groups)
+        for (size_t first = 0; first < indices.size(); first += cfg.textureArrayMaxLayers)
+        {
+            const size_t count = std::min<size_t>(cfg.textureArrayMaxLayers, indices.size() - first);
+
+            // a single texture does not need an array
+            if (count < 2)
+                continue;
+
+            std::vector<std::string> layers;
+            uint64_t key = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+            for (size_t j = first; j != first + count; j++)
+            {
+                layers.push_back(files[indices[j]]);
+                key = ConversionCache::HashFile(files[indices[j]], ConversionCache::HashString(files[indices[j]], key));
+            }
 
-    auto converter = [&](const std::string& s) -> std::string
+            char name[64];
+            snprintf(name, sizeof(name), "array__%016llx.ktx", (unsigned long long)key);
+            const std::string arrayFile = std::string("../../../data/out_textures/") + name;
+
+            {
+                std::lock_guard lock(g_ConvertedTextures.arrayMutex);
+                if (!fs::exists(arrayFile) && !SaveKTXArray(arrayFile.c_str(), layers))
+                {
+                    printf("Failed to save texture array [%s]\n", arrayFile.c_str());
+                    continue;
+                }
+            }
+
+            printf("Packed %u textures %dx%d into [%s]\n", (uint32_t)count, std::get<1>(k), std::get<2>(k), arrayFile.c_str());
+            arrays.emplace_back(arrayFile, std::vector<uint32_t>(indices.begin() + first, indices.begin() + first + count));
+            for (size_t j = 0; j != count; j++)
+            {
+                remap[indices[first + j]].second = (uint16_t)j;
+                packed[indices[first + j]] = true;
+            }
+        }
+
+    if (arrays.empty())
+        return;
+
+    // standalone textures keep their relative order, arrays go last
+    for (uint32_t i = 0; i != (uint32_t)files.size(); i++)
+        if (!packed[i])
+        {
+            remap[i].first = newFiles.size();
+            newFiles.push_back(files[i]);
+        }
+
+    for (const auto& [arrayFile, indices]: arrays)
+    {
+        for (uint32_t idx: indices)
+            remap[idx].first = newFiles.size();
+        newFiles.push_back(arrayFile);
+    }
+
+    auto remapMap = [&remap](uint64_t* map, uint16_t* layer)
+    {
+        if (*map < INVALID_TEXTURE)
+        {
+            *layer = remap[*map].second;
+            *map = remap[*map].first;
+        }
+    };
+
+    // opacity maps index the separate opacity list and are already merged into the albedo alpha
+    for (auto& m: materials)
+    {
+        remapMap(&m.mAmbientOcclusionMap, &m.mAmbientOcclusionLayer);
+        remapMap(&m.mEmissiveMap, &m.mEmissiveLayer);
+        remapMap(&m.mAlbedoMap, &m.mAlbedoLayer);
+        remapMap(&m.mMetallicRoughnessMap, &m.mMetallicRoughnessLayer);
+        remapMap(&m.mNormalMap, &m.mNormalLayer);
+    }
+
+    printf("Texture arrays: %u textures -> %u files\n", (uint32_t)files.size(), (uint32_t)newFiles.size());
+
+    files = std::move(newFiles);
+}
+
+/* Structural equality of two subtrees: the same meshes and materials, the same child count and local transforms of the children
+   (the local transforms of 'a' and 'b' themselves belong to the instances) */
+bool isSameSubtree(const Scene& scene, int a, int b)
+{
+    auto componentOf = [](const std::unordered_map<uint32_t, uint32_t>& map, int node)
+    {
+        const auto i = map.find(node);
+        return (i != map.end()) ? i->second : ~0u;
+    };
+
+    if (componentOf(scene.mMeshes, a) != componentOf(scene.mMeshes, b) ||
+        componentOf(scene.mMaterialForNode, a) != componentOf(scene.mMaterialForNode, b))
+        return false;
+
+    int ca = scene.mHierarchy[a].mFirstChild;
+    int cb = scene.mHierarchy[b].mFirstChild;
+    for (; ca != -1 && cb != -1; ca = scene.mHierarchy[ca].mNextSibling, cb = scene.mHierarchy[cb].mNextSibling)
+        if (memcmp(&scene.mLocalTransform[ca], &scene.mLocalTransform[cb], sizeof(glm::mat4)) || !isSameSubtree(scene, ca, cb))
+            return false;
+
+    return ca == -1 && cb == -1;
+}
+
+/* Replace repeated subtrees (the same mesh and material structure, e.g. props placed many times) with instances of a shared
+   prototype. The content of a prototype is stored once and instance nodes have no children, so the scene graph and the
+   work of RecalculateGlobalTransforms() shrink. Skinned meshes and skeletons are never instanced */
+void mergeInstances(const SceneConfig& cfg, Scene& scene)
+{
+    if (!cfg.mergeInstances)
+        return;
+
+    const auto numNodes = (uint32_t)scene.mHierarchy.size();
+
+    std::vector<bool> isJoint(numNodes, false);
+    for (const auto& skin: scene.mSkins)
+        for (uint32_t j: skin.mJoints)
+            isJoint[j] = true;
+
+    // structural hashes of all subtrees, children always come after their parents
+    std::vector<uint64_t> hash(numNodes, 0);
+    std::vector<bool> canInstance(numNodes, false);
+    std::vector<bool> hasMesh(numNodes, false);
+
+    for (uint32_t n = numNodes; n-- != 0;)
+    {
+        const auto mesh = scene.mMeshes.find(n);
+        const auto material = scene.mMaterialForNode.find(n);
+
+        uint64_t h = ConversionCache::HashValue(mesh != scene.mMeshes.end() ? mesh->second : ~0u, 0);
+        h = ConversionCache::HashValue(material != scene.mMaterialForNode.end() ? material->second : ~0u, h);
+
+        bool ok = !isJoint[n] && !scene.mSkinForNode.contains(n) && !scene.mPrototypeForNode.contains(n);
+        bool meshes = mesh != scene.mMeshes.end();
+
+        for (int c = scene.mHierarchy[n].mFirstChild; c != -1; c = scene.mHierarchy[c].mNextSibling)
+        {
+            h = ConversionCache::HashValue(scene.mLocalTransform[c], ConversionCache::HashValue(hash[c], h));
+            ok = ok && canInstance[c];
+            meshes = meshes || hasMesh[c];
+        }
+
+        hash[n] = h;
+        canInstance[n] = ok;
+        hasMesh[n] = meshes;
+    }
+
+    // candidates are subtrees with children and meshes, grouped by structure (the first node of a group is its representative)
+    std::unordered_map<uint64_t, std::vector<uint32_t>> representatives;
+    std::vector<uint32_t> groupOf(numNodes, ~0u);
+    std::vector<uint32_t> groupSize(numNodes, 0);
+
+    for (uint32_t n = 1; n != numNodes; n++)
+    {
+        if (!canInstance[n] || !hasMesh[n] || scene.mHierarchy[n].mFirstChild == -1)
+            continue;
+
+        auto& list = representatives[hash[n]];
+        const auto r = std::find_if(list.begin(), list.end(), [&](uint32_t other) { return isSameSubtree(scene, (int)other, (int)n); });
+        groupOf[n] = (r != list.end()) ? *r : n;
+        groupSize[groupOf[n]]++;
+
+        if (groupOf[n] == n)
+            list.push_back(n);
+    }
+
+    // the outermost repeated subtrees win, their descendants are part of the prototype. Repeated subtrees inside a selected one
+    // may leave their group with a single selected member, such groups are disabled and the selection is repeated, so that
+    // the nodes below a dropped subtree are considered again
+    std::vector<bool> disabled(numNodes, false);
+    std::vector<uint32_t> selected;
+    for (bool changed = true; changed;)
+    {
+        std::vector<bool> covered(numNodes, false);
+        selected.clear();
+
+        for (uint32_t n = 1; n != numNodes; n++)
+        {
+            const int parent = scene.mHierarchy[n].mParent;
+            if (parent > -1 && covered[parent])
+            {
+                covered[n] = true;
+                continue;
+            }
+            if (groupOf[n] != ~0u && groupSize[groupOf[n]] > 1 && !disabled[groupOf[n]])
+            {
+                covered[n] = true;
+                selected.push_back(n);
+            }
+        }
+
+        std::map<uint32_t, uint32_t> selectedInGroup;
+        for (uint32_t n: selected)
+            selectedInGroup[groupOf[n]]++;
+
+        changed = false;
+        for (const auto& [group, count]: selectedInGroup)
+            if (count < 2)
+            {
+                disabled[group] = true;
+                changed = true;
+            }
+    }
+
+    if (selected.empty())
+    {
+        printf("Instancing: no repeated subtrees\n");
+        return;
+    }
+
+    std::map<uint32_t, uint32_t> prototypeForGroup;
+    for (uint32_t n: selected)
+        if (!prototypeForGroup.contains(groupOf[n]))
+            prototypeForGroup[groupOf[n]] = CreatePrototype(scene, (int)n);
+
+    // deleting the subtree of a node only moves the nodes after it, so the replacement goes backwards
+    for (auto n = selected.rbegin(); n != selected.rend(); n++)
+        ReplaceWithInstance(scene, (int)*n, prototypeForGroup[groupOf[*n]]);
+
+    printf("Instancing: %u subtrees -> %u prototypes, %u -> %u nodes\n",
+           (uint32_t)selected.size(), (uint32_t)prototypeForGroup.size(), numNodes, (uint32_t)scene.mHierarchy.size());
+}
+
+/* Bake small (or explicitly static) mesh nodes into merged meshes with pre-transformed vertices, grouped by material and spatial cell */
+void staticBatching(const SceneConfig& cfg, Scene& scene, MeshData& meshData)
+{
+    if (cfg.staticBatchMaxTriangles == 0 && cfg.staticNodes.empty())
+        return;
+
+    std::vector<DrawData> drawData;
+    BuildDrawList(scene, meshData, drawData);
+    const size_t drawsBefore = drawData.size();
+
+    auto isStatic = [&](uint32_t node)
     {
-        return convertTexture(s, basePath, opacityMapIndices, opacityMaps);
+        const Mesh& mesh = meshData.mMeshes[scene.mMeshes.at(node)];
+        if (mesh.GetLODIndicesCount(0) / 3 <= cfg.staticBatchMaxTriangles)
+            return true;
+
+        const std::string name = GetNodeName(scene, (int)node);
+        return std::any_of(cfg.staticNodes.begin(), cfg.staticNodes.end(), [&name](const std::string& s) { return name.find(s) != std::string::npos; });
     };
 
-    std::transform(std::execution::par, std::begin(files), std::end(files), std::begin(files), converter);
+    const uint32_t numBatches = MergeSceneNodes(scene, meshData, isStatic, cfg.staticBatchCellSize);
+
+    recalculateBoundingBoxes(meshData);
+
+    BuildDrawList(scene, meshData, drawData);
+    const size_t drawsAfter = drawData.size();
+
+    printf("Static batching: %u draws -> %u draws (%u merged batches, %.1fx fewer draws)\n",
+           (uint32_t)drawsBefore, (uint32_t)drawsAfter, numBatches, drawsAfter ? (double)drawsBefore / (double)drawsAfter : 0.0);
+}
+
+/* Source albedo of a material for the impostor baker */
+struct ImpostorSource
+{
+    glm::vec4 albedoColor = glm::vec4(1.0f);
+    std::string albedoMap;
+    std::string opacityMap;
+    float alphaTest = 0.0f;
+};
+
+/* Source textures are downscaled to at most this size for baking, the impostor frames are much smaller anyway */
+constexpr int kImpostorTextureSize = 256;
+
+struct ImpostorTexture
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+ImpostorTexture loadImpostorTexture(const std::string& albedoFile, const std::string& opacityFile)
+{
+    ImpostorTexture result;
+
+    int w = 0, h = 0;
+    stbi_uc* pixels = stbi_load(albedoFile.c_str(), &w, &h, nullptr, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        printf("Failed to load [%s] texture for impostors\n", albedoFile.c_str());
+        return result;
+    }
+
+    if (!opacityFile.empty())
+    {
+        int opacityWidth = 0, opacityHeight = 0;
+        stbi_uc* opacityPixels = stbi_load(opacityFile.c_str(), &opacityWidth, &opacityHeight, nullptr, 1);
+        if (opacityPixels && opacityWidth == w && opacityHeight == h)
+            for (int i = 0; i != w * h; i++)
+                pixels[i * 4 + 3] = opacityPixels[i];
+        stbi_image_free(opacityPixels);
+    }
+
+    result.width = std::min(w, kImpostorTextureSize);
+    result.height = std::min(h, kImpostorTextureSize);
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    stbir_resize_uint8_srgb(pixels, w, h, 0, result.pixels.data(), result.width, result.height, 0, 4, 3, 0);
+
+    stbi_image_free(pixels);
+    return result;
+}
+
+/* Bake an octahedral impostor for every large static mesh and append it as the last LOD of the mesh. The atlases are named
+   after their contents (mesh, material, source textures and settings), so unchanged impostors are not baked again */
+void bakeImpostors(const SceneConfig& cfg, const Scene& scene, MeshData& meshData, const std::vector<ImpostorSource>& sources)
+{
+    std::vector<ImpostorDescription> impostors;
+    std::vector<std::string> files;
+    std::vector<uint32_t> impostorForMesh(meshData.mMeshes.size(), kNoImpostor);
+
+    if (cfg.impostorMinRadius > 0.0f)
+    {
+        // every mesh is baked with the material of its first draw
+        std::vector<uint32_t> materialForMesh(meshData.mMeshes.size(), ~0u);
+        std::vector<DrawData> drawData;
+        BuildDrawList(scene, meshData, drawData);
+        for (const auto& d: drawData)
+            if (materialForMesh[d.meshIndex] == ~0u)
+                materialForMesh[d.meshIndex] = d.materialIndex;
+
+        std::vector<uint32_t> meshes;
+        for (uint32_t i = 0; i != (uint32_t)meshData.mMeshes.size(); i++)
+        {
+            const Mesh& mesh = meshData.mMeshes[i];
+            if (materialForMesh[i] >= sources.size() || IsSkinnedMesh(mesh) || mesh.streamElementSize[0] < g_numElementsToStore * sizeof(float))
+                continue;
+            if (i < meshData.mBoxes.size() && 0.5f * glm::length(meshData.mBoxes[i].getSize()) >= cfg.impostorMinRadius)
+                meshes.push_back(i);
+        }
+
+        // downscaled source textures, each loaded once
+        std::map<std::pair<std::string, std::string>, ImpostorTexture> textures;
+        for (uint32_t m: meshes)
+        {
+            const ImpostorSource& src = sources[materialForMesh[m]];
+            if (!src.albedoMap.empty())
+                textures[{ src.albedoMap, src.opacityMap }];
+        }
+
+        std::vector<decltype(textures)::value_type*> textureList;
+        for (auto& t: textures)
+            textureList.push_back(&t);
+
+        impostors.resize(meshes.size());
+        files.resize(meshes.size() * 3);
+        std::atomic<uint32_t> numBaked = 0;
+
+        tf::Taskflow taskflow;
+        tf::Task loadTextures = taskflow.for_each_index((size_t)0, textureList.size(), (size_t)1, [&](size_t i)
+        {
+            textureList[i]->second = loadImpostorTexture(textureList[i]->first.first, textureList[i]->first.second);
+        });
+        tf::Task bake = taskflow.for_each_index((size_t)0, meshes.size(), (size_t)1, [&](size_t i)
+        {
+            const uint32_t m = meshes[i];
+            const Mesh& mesh = meshData.mMeshes[m];
+            const ImpostorSource& src = sources[materialForMesh[m]];
+            ConversionReport::Item item(g_Report, "impostor", std::to_string(m));
+
+            ImpostorMaterial material;
+            material.mAlbedoColor = src.albedoColor;
+            material.mAlphaTest = src.alphaTest;
+
+            uint64_t key = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+            key = ConversionCache::HashValue(cfg.impostorFrameSize, ConversionCache::HashValue(cfg.impostorFrames, key));
+            key = ConversionCache::HashValue(src.alphaTest, ConversionCache::HashValue(src.albedoColor, key));
+            key = HashBytes(&meshData.mVertexData[mesh.streamOffset[0] / sizeof(float)], (size_t)mesh.vertexCount * mesh.streamElementSize[0], key);
+            key = HashBytes(&meshData.mIndexData[mesh.indexOffset + mesh.lodOffset[0]], mesh.GetLODIndicesCount(0) * sizeof(uint32_t), key);
+
+            if (!src.albedoMap.empty())
+            {
+                const ImpostorTexture& texture = textures.at({ src.albedoMap, src.opacityMap });
+                material.mAlbedo = texture.pixels.empty() ? nullptr : texture.pixels.data();
+                material.mWidth = texture.width;
+                material.mHeight = texture.height;
+                key = HashBytes(texture.pixels.data(), texture.pixels.size(), ConversionCache::HashValue(texture.width, key));
+            }
+
+            char prefix[64];
+            snprintf(prefix, sizeof(prefix), "impostor__%016llx__", (unsigned long long)key);
+            const std::string base = std::string("../../../data/out_textures/") + prefix;
+            files[i * 3 + 0] = base + "albedo.png";
+            files[i * 3 + 1] = base + "normal.png";
+            files[i * 3 + 2] = base + "depth.png";
+
+            ImpostorDescription& impostor = impostors[i];
+            impostor = DescribeImpostor(meshData, m, cfg.impostorFrames, cfg.impostorFrameSize);
+            impostor.mAlbedoMap = (uint32_t)i * 3 + 0;
+            impostor.mNormalMap = (uint32_t)i * 3 + 1;
+            impostor.mDepthMap = (uint32_t)i * 3 + 2;
+
+            if (fs::exists(files[i * 3 + 0]) && fs::exists(files[i * 3 + 1]) && fs::exists(files[i * 3 + 2]))
+                return;
+
+            // the same mesh may be used by several scenes converted at the same time
+            {
+                std::lock_guard lock(g_ConvertedTextures.mutex);
+                if (!g_ConvertedTextures.impostors.insert(key).second)
+                    return;
+            }
+
+            ImpostorAtlas atlas;
+            BakeImpostor(meshData, m, material, impostor, atlas);
+            stbi_write_png(files[i * 3 + 0].c_str(), atlas.mSize, atlas.mSize, 4, atlas.mAlbedo.data(), 0);
+            stbi_write_png(files[i * 3 + 1].c_str(), atlas.mSize, atlas.mSize, 4, atlas.mNormal.data(), 0);
+            stbi_write_png(files[i * 3 + 2].c_str(), atlas.mSize, atlas.mSize, 1, atlas.mDepth.data(), 0);
+            numBaked++;
+        });
+        loadTextures.precede(bake);
+        g_Executor.run(taskflow).wait();
+
+        for (uint32_t i = 0; i != (uint32_t)meshes.size(); i++)
+            impostorForMesh[meshes[i]] = i;
+
+        AddImpostorLODs(meshData, impostorForMesh, impostors);
+
+        uint32_t numTriangles = 0;
+        for (uint32_t m: meshes)
+            numTriangles += meshData.mMeshes[m].GetLODIndicesCount(meshData.mMeshes[m].lodCount - 2) / 3;
+
+        printf("Impostors: %u meshes (%u baked), far field %u triangles -> %u quads\n",
+               (uint32_t)meshes.size(), numBaked.load(), numTriangles, (uint32_t)meshes.size());
+    }
+
+    SaveImpostors(cfg.outputImpostors.c_str(), impostors, files);
+}
+
+/* Collision proxies of the final meshes with their Bullet BVHs built here, so the applications only copy them.
+   The file is written even if the stage is disabled */
+void buildCollision(const SceneConfig& cfg, const MeshData& meshData)
+{
+    CollisionData collision;
+
+    if (cfg.calculateCollision)
+    {
+        BuildCollisionProxies(meshData, cfg.collision, collision, g_Executor);
+
+        uint32_t numShapes[4] = { 0, 0, 0, 0 };
+        for (const CollisionProxy& p: collision.mProxies)
+            numShapes[(uint32_t)p.mType]++;
+
+        printf("Collision: %u boxes, %u convex hulls, %u triangle meshes (%u triangles, %u KB of BVHs)\n",
+               numShapes[(uint32_t)eCollisionShape::Box], numShapes[(uint32_t)eCollisionShape::ConvexHull], numShapes[(uint32_t)eCollisionShape::TriangleMesh],
+               (uint32_t)(collision.mIndexData.size() / 3), (uint32_t)(collision.mBvhData.size() >> 10));
+    }
+
+    SaveCollisionData(cfg.outputCollision.c_str(), collision);
 }
 
 std::vector<SceneConfig> readConfigFile(const char* cfgFileName)
@@ -529,7 +1714,7 @@ std::vector<SceneConfig> readConfigFile(const char* cfgFileName)
     std::string s = "../../../";
     for (rapidjson::SizeType i = 0; i < document.Size(); i++)
     {
-        configList.emplace_back(SceneConfig {
+        SceneConfig& cfg = configList.emplace_back(SceneConfig {
                 .fileName = s + document[i]["input_scene"].GetString(),
                 .outputMesh = s + document[i]["output_mesh"].GetString(),
                 .outputScene = s + document[i]["output_scene"].GetString(),
@@ -538,21 +1723,156 @@ std::vector<SceneConfig> readConfigFile(const char* cfgFileName)
                 .calculateLODs = document[i]["calculate_LODs"].GetBool(),
                 .mergeInstances = document[i]["merge_instances"].GetBool()
         });
+
+        // the impostor list goes next to the meshes unless given explicitly
+        cfg.outputImpostors = document[i].HasMember("output_impostors") ?
+                s + document[i]["output_impostors"].GetString() : fs::path(cfg.outputMesh).replace_extension(".impostors").string();
+        cfg.outputCollision = document[i].HasMember("output_collision") ?
+                s + document[i]["output_collision"].GetString() : fs::path(cfg.outputMesh).replace_extension(".collision").string();
+
+        if (document[i].HasMember("optimize_meshes"))
+            cfg.optimizeMeshes = document[i]["optimize_meshes"].GetBool();
+
+        // optional static batching parameters
+        if (document[i].HasMember("static_batch_max_triangles"))
+            cfg.staticBatchMaxTriangles = document[i]["static_batch_max_triangles"].GetUint();
+        if (document[i].HasMember("static_batch_cell_size"))
+            cfg.staticBatchCellSize = (float)document[i]["static_batch_cell_size"].GetDouble();
+        if (document[i].HasMember("static_nodes"))
+            for (const auto& n: document[i]["static_nodes"].GetArray())
+                cfg.staticNodes.emplace_back(n.GetString());
+
+        // optional LOD chain parameters
+        if (document[i].HasMember("lod_ratios"))
+            for (const auto& r: document[i]["lod_ratios"].GetArray())
+                cfg.lods.ratios.push_back((float)r.GetDouble());
+        if (document[i].HasMember("lod_ratio"))
+            cfg.lods.ratio = (float)document[i]["lod_ratio"].GetDouble();
+        if (document[i].HasMember("lod_target_error"))
+            cfg.lods.targetError = (float)document[i]["lod_target_error"].GetDouble();
+        if (document[i].HasMember("lod_max_error"))
+            cfg.lods.maxError = (float)document[i]["lod_max_error"].GetDouble();
+        if (document[i].HasMember("lod_min_indices"))
+            cfg.lods.minIndices = document[i]["lod_min_indices"].GetUint();
+        if (document[i].HasMember("lod_max_count"))
+            cfg.lods.maxCount = document[i]["lod_max_count"].GetUint();
+        if (document[i].HasMember("lod_allow_sloppy"))
+            cfg.lods.allowSloppy = document[i]["lod_allow_sloppy"].GetBool();
+
+        // optional texture compression: "png" (default), "bc1", "bc3", "bc5", "bc7", "etc2", "etc2a" or "eac_rg"
+        if (document[i].HasMember("texture_format"))
+            cfg.textureCompression = TextureCompressionFromString(document[i]["texture_format"].GetString());
+        // etc2comp effort 0..100
+        if (document[i].HasMember("texture_effort"))
+            cfg.textureEffort = (float)document[i]["texture_effort"].GetDouble();
+
+        // optional packing of small textures into texture arrays
+        if (document[i].HasMember("texture_array_max_size"))
+            cfg.textureArrayMaxSize = document[i]["texture_array_max_size"].GetUint();
+        if (document[i].HasMember("texture_array_max_layers"))
+            cfg.textureArrayMaxLayers = std::clamp(document[i]["texture_array_max_layers"].GetUint(), 2u, 65535u);
+
+        // optional texture pipeline limits
+        if (document[i].HasMember("texture_workers"))
+            cfg.textureWorkers = std::max(document[i]["texture_workers"].GetUint(), 1u);
+        if (document[i].HasMember("texture_memory_budget_mb"))
+            cfg.textureMemoryBudget = (uint64_t)document[i]["texture_memory_budget_mb"].GetUint() << 20;
+
+        // optional impostors of large meshes
+        if (document[i].HasMember("impostor_min_radius"))
+            cfg.impostorMinRadius = (float)document[i]["impostor_min_radius"].GetDouble();
+        if (document[i].HasMember("impostor_frames"))
+            cfg.impostorFrames = std::clamp(document[i]["impostor_frames"].GetUint(), 2u, 32u);
+        if (document[i].HasMember("impostor_frame_size"))
+            cfg.impostorFrameSize = std::clamp(document[i]["impostor_frame_size"].GetUint(), 8u, 512u);
+
+        // optional collision proxies
+        if (document[i].HasMember("calculate_collision"))
+            cfg.calculateCollision = document[i]["calculate_collision"].GetBool();
+        if (document[i].HasMember("collision_max_error"))
+            cfg.collision.maxError = (float)document[i]["collision_max_error"].GetDouble();
+        if (document[i].HasMember("collision_box_radius"))
+            cfg.collision.boxRadius = (float)document[i]["collision_box_radius"].GetDouble();
+        if (document[i].HasMember("collision_hull_radius"))
+            cfg.collision.hullRadius = (float)document[i]["collision_hull_radius"].GetDouble();
     }
 
     return configList;
 }
 
+/* Scene cache entries consist of the output files and a ".deps" file, written last, with the stamp of all source textures
+   followed by their names. A hit restores the outputs without importing the scene */
+bool fetchCachedScene(const SceneConfig& cfg, uint64_t key)
+{
+    std::ifstream deps(g_Cache.GetPath(key, ".deps"));
+    if (!deps.is_open())
+        return false;
+
+    uint64_t stamp = 0;
+    deps >> std::hex >> stamp;
+    std::string line;
+    std::getline(deps, line);
+
+    std::vector<std::string> textures;
+    while (std::getline(deps, line))
+        if (!line.empty())
+            textures.push_back(line);
+
+    if (hashFileStamps(textures) != stamp)
+        return false;
+
+    if (!g_Cache.Fetch(key, ".meshes", cfg.outputMesh) ||
+        !g_Cache.Fetch(key, ".scene", cfg.outputScene) ||
+        !g_Cache.Fetch(key, ".materials", cfg.outputMaterials) ||
+        !g_Cache.Fetch(key, ".impostors", cfg.outputImpostors) ||
+        !g_Cache.Fetch(key, ".collision", cfg.outputCollision))
+        return false;
+
+    // rescaled textures and impostor atlases are shared between scenes and may have been deleted
+    std::vector<MaterialDescription> materials;
+    std::vector<std::string> files;
+    LoadMaterials(cfg.outputMaterials.c_str(), materials, files);
+
+    std::vector<ImpostorDescription> impostors;
+    std::vector<std::string> impostorFiles;
+    LoadImpostors(cfg.outputImpostors.c_str(), impostors, impostorFiles);
+    files.insert(files.end(), impostorFiles.begin(), impostorFiles.end());
+
+    return std::all_of(files.begin(), files.end(), [](const std::string& f) { return fs::exists(f); });
+}
+
+void storeCachedScene(const SceneConfig& cfg, uint64_t key, const std::vector<std::string>& textures)
+{
+    g_Cache.Store(key, ".meshes", cfg.outputMesh);
+    g_Cache.Store(key, ".scene", cfg.outputScene);
+    g_Cache.Store(key, ".materials", cfg.outputMaterials);
+    g_Cache.Store(key, ".impostors", cfg.outputImpostors);
+    g_Cache.Store(key, ".collision", cfg.outputCollision);
+
+    std::ofstream deps(g_Cache.GetPath(key, ".deps"));
+    deps << std::hex << hashFileStamps(textures) << "\n";
+    for (const auto& t: textures)
+        deps << t << "\n";
+}
+
 void processScene(const SceneConfig& cfg)
 {
-    // clear mesh data from previous scene
-    g_MeshData.meshes_.clear();
-    g_MeshData.boxes_.clear();
-    g_MeshData.indexData_.clear();
-    g_MeshData.vertexData_.clear();
+    const std::string sceneName = fs::path(cfg.fileName).filename().string();
+    ConversionReport::Stage sceneStage(g_Report, sceneName, "total");
+
+    // the current stage, emplacing the next one ends it
+    std::optional<ConversionReport::Stage> stage;
+    stage.emplace(g_Report, sceneName, "cache lookup");
 
-    g_indexOffset = 0;
-    g_vertexOffset = 0;
+    const uint64_t sceneKey = hashSceneInputs(cfg);
+    if (fetchCachedScene(cfg, sceneKey))
+    {
+        printf("Scene '%s' is up to date\n", cfg.fileName.c_str());
+        return;
+    }
+
+    // every scene has its own mesh data, several scenes are converted at the same time
+    MeshData meshData;
 
     // extract base model path
     const std::size_t pathSeparator = cfg.fileName.find_last_of("/\\");
@@ -564,7 +1884,7 @@ void processScene(const SceneConfig& cfg)
                                aiProcess_GenSmoothNormals |
                                aiProcess_LimitBoneWeights |
                                aiProcess_SplitLargeMeshes |
-                               aiProcess_ImproveCacheLocality |
+                               (cfg.optimizeMeshes ? 0 : aiProcess_ImproveCacheLocality) |
                                aiProcess_RemoveRedundantMaterials |
                                aiProcess_FindDegenerates |
                                aiProcess_FindInvalidData |
@@ -572,6 +1892,7 @@ void processScene(const SceneConfig& cfg)
 
     printf("Loading scene from '%s'...\n", cfg.fileName.c_str());
 
+    stage.emplace(g_Report, sceneName, "import");
     const aiScene* scene = aiImportFile(cfg.fileName.c_str(), flags);
 
     if (!scene || !scene->HasMeshes())
@@ -581,23 +1902,56 @@ void processScene(const SceneConfig& cfg)
     }
 
     // 1. Mesh conversion as in Chapter 5
-    g_MeshData.meshes_.reserve(scene->mNumMeshes);
-    g_MeshData.boxes_.reserve(scene->mNumMeshes);
+    stage.emplace(g_Report, sceneName, "meshes");
+    meshData.mMeshes.reserve(scene->mNumMeshes);
+    meshData.mBoxes.reserve(scene->mNumMeshes);
+
+    // every mesh is converted (and simplified) independently into its own buffers, unchanged meshes come from the cache
+    std::vector<MeshData> convertedMeshes(scene->mNumMeshes);
+    std::vector<Mesh> meshes(scene->mNumMeshes);
+    std::atomic<uint32_t> numCachedMeshes = 0;
+    std::vector<MeshOptimizationStats> meshStats(scene->mNumMeshes);
+    std::vector<std::string> lodLogs(scene->mNumMeshes);
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0u, scene->mNumMeshes, 1u, [&](unsigned int i) {
+        ConversionReport::Item item(g_Report, "mesh", std::to_string(i) + " " + scene->mMeshes[i]->mName.C_Str());
+        const uint64_t key = hashAIMesh(scene->mMeshes[i], cfg);
+        if (g_Cache.LoadMesh(key, meshes[i], convertedMeshes[i]))
+        {
+            numCachedMeshes++;
+            return;
+        }
+        convertedMeshes[i] = MeshData();
+        meshes[i] = convertAIMesh(scene->mMeshes[i], cfg, convertedMeshes[i], meshStats[i], lodLogs[i]);
+        g_Cache.SaveMesh(key, meshes[i], convertedMeshes[i]);
+    });
+    g_Executor.run(taskflow).wait();
+
+    printf("\n%u of %u meshes were taken from the cache\n", numCachedMeshes.load(), scene->mNumMeshes);
 
+    // statistics of the converted (not cached) meshes
+    MeshOptimizationStats totalStats;
+    for (const auto& st: meshStats)
+        totalStats.add(st);
+    totalStats.print();
+
+    // deterministic concatenation in mesh order (byte-identical to a serial conversion)
     for (unsigned int i = 0; i != scene->mNumMeshes; i++)
     {
-        printf("\nConverting meshes %u/%u...", i + 1, scene->mNumMeshes);
-        Mesh mesh = convertAIMesh(scene->mMeshes[i], cfg);
-        g_MeshData.meshes_.push_back(mesh);
+        printf("\nMesh %u/%u: LOD count %u%s", i + 1, scene->mNumMeshes, meshes[i].lodCount, lodLogs[i].c_str());
+        appendConvertedMesh(meshData, convertedMeshes[i], meshes[i]);
+        convertedMeshes[i] = MeshData();
     }
+    printf("\n");
 
-    recalculateBoundingBoxes(g_MeshData);
-
-    saveMeshData(cfg.outputMesh.c_str(), g_MeshData);
+    stage.emplace(g_Report, sceneName, "bounds");
+    recalculateBoundingBoxes(meshData);
 
     Scene ourScene;
 
     // 2. Material conversion
+    stage.emplace(g_Report, sceneName, "materials");
     std::vector<MaterialDescription> materials;
     std::vector<std::string>& materialNames = ourScene.mMaterialNames;
 
@@ -616,19 +1970,90 @@ void processScene(const SceneConfig& cfg)
         //dumpMaterial(files, D);
     }
 
+    // source textures the cached scene depends on
+    std::vector<std::string> sourceTextures;
+    for (const auto& f: files)
+        sourceTextures.push_back(fixTextureFile(replaceAll(basePath + f, "\\", "/")));
+    for (const auto& f: opacityMaps)
+        sourceTextures.push_back(fixTextureFile(replaceAll(basePath + f, "\\", "/")));
+
+    // the impostor baker samples the source textures, the converted ones may be block compressed
+    std::vector<ImpostorSource> impostorSources(materials.size());
+    for (size_t i = 0; i != materials.size(); i++)
+    {
+        const MaterialDescription& m = materials[i];
+        impostorSources[i].albedoColor = glm::vec4(m.mAlbedoColor.x, m.mAlbedoColor.y, m.mAlbedoColor.z, m.mAlbedoColor.w);
+        impostorSources[i].alphaTest = m.mAlphaTest;
+        if (m.mAlbedoMap != 0xFFFFFFFF)
+            impostorSources[i].albedoMap = fixTextureFile(replaceAll(basePath + files[m.mAlbedoMap], "\\", "/"));
+        if (m.mAlbedoMap != 0xFFFFFFFF && m.mOpacityMap != 0xFFFFFFFF)
+            impostorSources[i].opacityMap = fixTextureFile(replaceAll(basePath + opacityMaps[m.mOpacityMap], "\\", "/"));
+    }
+
     // 3. Texture processing, rescaling and packing
-    convertAndDownscaleAllTextures(materials, basePath, files, opacityMaps);
+    stage.emplace(g_Report, sceneName, "textures");
+    convertAndDownscaleAllTextures(materials, basePath, files, opacityMaps, cfg);
+    packSmallTextures(cfg, materials, files);
 
+    stage.emplace(g_Report, sceneName, "save materials");
     SaveMaterials(cfg.outputMaterials.c_str(), materials, files);
 
     // 4. Scene hierarchy conversion
+    stage.emplace(g_Report, sceneName, "hierarchy");
     traverse(scene, ourScene, scene->mRootNode, -1, 0);
 
+    // 5. Skins of animated meshes
+    convertAISkins(scene, ourScene, cfg.scale);
+
+    // 6. Repeated subtrees become instances of shared prototypes
+    stage.emplace(g_Report, sceneName, "instancing");
+    mergeInstances(cfg, ourScene);
+
+    // 7. Static batching of small draws (modifies both the scene and the mesh data)
+    stage.emplace(g_Report, sceneName, "static batching");
+    staticBatching(cfg, ourScene, meshData);
+
+    // 8. Impostors of large meshes (appended to their LOD chains)
+    stage.emplace(g_Report, sceneName, "impostors");
+    bakeImpostors(cfg, ourScene, meshData, impostorSources);
+
+    // 9. Collision proxies (the impostor LODs are skipped)
+    stage.emplace(g_Report, sceneName, "collision");
+    buildCollision(cfg, meshData);
+
+    stage.emplace(g_Report, sceneName, "save");
+    saveMeshData(cfg.outputMesh.c_str(), meshData);
+
     SaveScene(cfg.outputScene.c_str(), ourScene);
+
+    storeCachedScene(cfg, sceneKey, sourceTextures);
 }
 
-void mergeBistro()
+/* Combine the converted Bistro scenes. If 'validate' is set, the cache is bypassed and the drawn geometry is compared before and after
+   merging the foliage. Returns false on a mismatch */
+bool mergeBistro(bool validate)
 {
+    ConversionReport::Stage mergeStage(g_Report, "bistro_all", "total");
+
+    std::optional<ConversionReport::Stage> stage;
+    stage.emplace(g_Report, "bistro_all", "cache lookup");
+
+    uint64_t key = ConversionCache::HashValue(ConversionCache::kConverterVersion, HashBytes(nullptr, 0));
+    for (const char* f: g_BistroInputs)
+        key = ConversionCache::HashFile(f, key);
+
+    if (!validate &&
+        g_Cache.Fetch(key, ".meshes", "../../../data/meshes/bistro_all.meshes") &&
+        g_Cache.Fetch(key, ".scene", "../../../data/meshes/bistro_all.scene") &&
+        g_Cache.Fetch(key, ".materials", "../../../data/meshes/bistro_all.materials") &&
+        g_Cache.Fetch(key, ".impostors", "../../../data/meshes/bistro_all.impostors"))
+    {
+        printf("Merged Bistro scene is up to date\n");
+        return true;
+    }
+
+    stage.emplace(g_Report, "bistro_all", "merge");
+
     Scene scene1, scene2;
     std::vector<Scene*> scenes = { &scene1, &scene2 };
 
@@ -649,6 +2074,17 @@ void mergeBistro()
 
     MeshFileHeader header = mergeMeshData(meshData, meshDatas);
 
+    // impostors of both scenes, the meshes of the second one point past the impostors of the first one
+    std::vector<ImpostorDescription> impostors, impostors2;
+    std::vector<std::string> impostorFiles, impostorFiles2;
+    LoadImpostors("../../../data/meshes/test.impostors", impostors, impostorFiles);
+    LoadImpostors("../../../data/meshes/test2.impostors", impostors2, impostorFiles2);
+    const uint32_t firstImpostor2 = MergeImpostorLists(impostors, impostorFiles, impostors2, impostorFiles2);
+
+    for (uint32_t i = header1.meshCount; i != (uint32_t)meshData.mMeshes.size(); i++)
+        if (meshData.mMeshes[i].impostorIndex != kNoImpostor)
+            meshData.mMeshes[i].impostorIndex += firstImpostor2;
+
     // now the material lists:
     std::vector<MaterialDescription> materials1, materials2;
     std::vector<std::string> textureFiles1, textureFiles2;
@@ -658,37 +2094,192 @@ void mergeBistro()
     std::vector<MaterialDescription> allMaterials;
     std::vector<std::string> allTextures;
 
-    MergeMaterialLists(
+    const std::vector<uint32_t> materialRemap = MergeMaterialLists(
             { &materials1, &materials2 },
             { &textureFiles1, &textureFiles2 },
             allMaterials, allTextures);
 
-    SaveMaterials("../../../data/meshes/bistro_all.materials", allMaterials, allTextures);
+    printf("[Merged materials] %u -> %u materials\n", (uint32_t)materialRemap.size(), (uint32_t)allMaterials.size());
+
+    SceneGeometrySummary unmerged;
+    if (validate)
+    {
+        MarkAsChanged(scene, 0);
+        RecalculateGlobalTransforms(scene);
+        unmerged = SummarizeSceneGeometry(scene, meshData);
+    }
 
     printf("[Unmerged] scene items: %d\n", (int)scene.mHierarchy.size());
-    MergeScene(scene, meshData, "Foliage_Linde_Tree_Large_Orange_Leaves");
-    printf("[Merged orange leaves] scene items: %d\n", (int)scene.mHierarchy.size());
-    MergeScene(scene, meshData, "Foliage_Linde_Tree_Large_Green_Leaves");
-    printf("[Merged green leaves]  scene items: %d\n", (int)scene.mHierarchy.size());
-    MergeScene(scene, meshData, "Foliage_Linde_Tree_Large_Trunk");
-    printf("[Merged trunk]  scene items: %d\n", (int)scene.mHierarchy.size());
+    MergeSceneMaterials(scene, meshData, {
+            "Foliage_Linde_Tree_Large_Orange_Leaves",
+            "Foliage_Linde_Tree_Large_Green_Leaves",
+            "Foliage_Linde_Tree_Large_Trunk" });
+    printf("[Merged leaves and trunks] scene items: %d\n", (int)scene.mHierarchy.size());
+
+    bool geometryMatches = true;
+    if (validate)
+    {
+        MarkAsChanged(scene, 0);
+        RecalculateGlobalTransforms(scene);
+        geometryMatches = CompareSceneGeometry(unmerged, SummarizeSceneGeometry(scene, meshData));
+        printf("Merge validation of bistro_all: %s\n", geometryMatches ? "OK" : "FAILED");
+    }
+
+    // material merging is done by name above, so the deduplicated material indices are applied afterwards
+    RemapMaterials(scene, materialRemap);
 
     recalculateBoundingBoxes(meshData);
 
+    stage.emplace(g_Report, "bistro_all", "save");
+    SaveMaterials("../../../data/meshes/bistro_all.materials", allMaterials, allTextures);
     saveMeshData("../../../data/meshes/bistro_all.meshes", meshData);
     SaveScene("../../../data/meshes/bistro_all.scene", scene);
+    SaveImpostors("../../../data/meshes/bistro_all.impostors", impostors, impostorFiles);
+
+    g_Cache.Store(key, ".materials", "../../../data/meshes/bistro_all.materials");
+    g_Cache.Store(key, ".impostors", "../../../data/meshes/bistro_all.impostors");
+    g_Cache.Store(key, ".scene", "../../../data/meshes/bistro_all.scene");
+    g_Cache.Store(key, ".meshes", "../../../data/meshes/bistro_all.meshes");
+
+    return geometryMatches;
 }
 
-int main() {
+/* Pose every joint of a converted scene (as written to disk, so cached scenes are checked too), skin it with CPUSkinner
+   and compare the result with the scalar SkinVerticesReference(). Returns false on a mismatch */
+bool validateSkinning(const SceneConfig& cfg)
+{
+    MeshData meshData;
+    loadMeshData(cfg.outputMesh.c_str(), meshData);
+
+    Scene scene;
+    LoadScene(cfg.outputScene.c_str(), scene);
+
+    if (scene.mSkins.empty())
+        return true;
+
+    // a different rotation for every joint, so that the vertices really blend several matrices
+    for (const Skin& skin: scene.mSkins)
+        for (uint32_t joint: skin.mJoints)
+        {
+            const float angle = 0.1f + 0.37f * (float)(joint % 7);
+            const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, (float)(joint % 3), (float)(joint % 5)));
+            scene.mLocalTransform[joint] = scene.mLocalTransform[joint] * glm::rotate(glm::mat4(1.0f), angle, axis);
+        }
+
+    // the converter writes a single root node
+    MarkAsChanged(scene, 0);
+    RecalculateGlobalTransforms(scene);
+
+    std::vector<SkinningJob> jobs;
+    std::vector<glm::mat4> jointMatrices;
+    BuildSkinningJobs(scene, meshData, jobs, jointMatrices);
+
+    uint32_t vertexCount = 0;
+    for (const SkinningJob& job: jobs)
+        vertexCount += job.vertexCount;
+
+    // small batches, so that larger meshes are split across several tasks and end with a partial batch
+    CPUSkinner skinner;
+    skinner.mBatchSize = 1000;
+
+    std::vector<float> skinned;
+    skinner.Skin(meshData, jobs, jointMatrices, skinned);
+
+    const float maxDiff = CompareWithSkinningReference(meshData, jobs, jointMatrices, skinned);
+    const float kEpsilon = 1e-4f;
+
+    printf("Skinning validation of %s: %u jobs, %u vertices, max. difference %g\n",
+           cfg.outputMesh.c_str(), (uint32_t)jobs.size(), vertexCount, maxDiff);
+
+    if (maxDiff > kEpsilon)
+    {
+        printf("CPUSkinner does not match the reference skinning (epsilon %g)\n", kEpsilon);
+        return false;
+    }
+
+    return true;
+}
+
+/* SceneConverter [--report <file.json>] [--trace <file.json>] [--profile <file.prof>] [--validate-skinning] [--validate-merge]
+   The report is always written, the Chrome trace and the EasyProfiler capture (EasyProfiler builds only) on request.
+   --validate-skinning checks CPUSkinner against the reference skinning on every converted scene with skins and fails on a mismatch
+   --validate-merge    fails if merging the Bistro scenes changes the drawn geometry */
+int main(int argc, char** argv) {
+    std::string reportFile = "../../../data/sceneconverter_report.json";
+    std::string traceFile;
+    std::string profileFile;
+    bool validate = false;
+    bool validateMerge = false;
+
+    for (int i = 1 ; i < argc ; i++)
+    {
+        if (!strcmp(argv[i], "--validate-skinning"))
+            validate = true;
+        else if (!strcmp(argv[i], "--validate-merge"))
+            validateMerge = true;
+        else if (i + 1 < argc && !strcmp(argv[i], "--report"))
+            reportFile = argv[++i];
+        else if (i + 1 < argc && !strcmp(argv[i], "--trace"))
+            traceFile = argv[++i];
+        else if (i + 1 < argc && !strcmp(argv[i], "--profile"))
+            profileFile = argv[++i];
+        else
+            printf("Unknown argument '%s'\n", argv[i]);
+    }
+
+    EASY_PROFILER_ENABLE;
+    EASY_MAIN_THREAD;
+
     fs::create_directory("../../../data/out_textures");
 
     const auto configs = readConfigFile("../../../data/sceneconverter.json");
 
+    // all scenes share one texture memory budget, the most restrictive one asked for
+    uint64_t textureMemoryBudget = UINT64_MAX;
+    for (const auto& cfg: configs)
+        textureMemoryBudget = std::min(textureMemoryBudget, cfg.textureMemoryBudget);
+    if (!configs.empty())
+        g_TextureBudget.reset(textureMemoryBudget);
+
+    // Scenes are independent and converted at the same time. The scene tasks mostly wait for the shared pools
+    // (g_Executor, texture workers), so they get threads of their own
+    tf::Executor sceneExecutor(std::max((uint32_t)configs.size(), 1u));
+    tf::Taskflow taskflow;
+
+    // Final step: optimize bistro scene, as soon as the scenes it is made of are converted
+    bool mergeMatches = true;
+    tf::Task merge = taskflow.emplace([&] { mergeMatches = mergeBistro(validateMerge); }).name("bistro_all");
+
+    auto isBistroInput = [](const std::string& file)
+    {
+        for (const char* f: g_BistroInputs)
+            if (fs::path(file).lexically_normal() == fs::path(f).lexically_normal())
+                return true;
+        return false;
+    };
+
     for (const auto& cfg: configs)
-        processScene(cfg);
+    {
+        tf::Task task = taskflow.emplace([&cfg] { processScene(cfg); }).name(cfg.fileName);
+        if (isBistroInput(cfg.outputMesh) || isBistroInput(cfg.outputScene) || isBistroInput(cfg.outputMaterials))
+            task.precede(merge);
+    }
+
+    sceneExecutor.run(taskflow).wait();
 
-    // Final step: optimize bistro scene
-    mergeBistro();
+    bool skinningMatches = true;
+    if (validate)
+        for (const auto& cfg: configs)
+            skinningMatches = validateSkinning(cfg) && skinningMatches;
+
+    if (!g_Report.SaveJSON(reportFile.c_str()))
+        printf("Cannot write the report '%s'\n", reportFile.c_str());
+    if (!traceFile.empty() && !g_Report.SaveChromeTrace(traceFile.c_str()))
+        printf("Cannot write the trace '%s'\n", traceFile.c_str());
+    if (!profileFile.empty())
+    {
+        PROFILER_DUMP(profileFile.c_str())
+    }
 
-    return 0;
+    return (skinningMatches && mergeMatches) ? 0 : EXIT_FAILURE;
 }
\ No newline at end of file
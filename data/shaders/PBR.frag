@@ -23,6 +23,11 @@ layout (binding = 5) uniform samplerCube texEnvMap;
 layout (binding = 6) uniform samplerCube texEnvMapIrradiance;
 layout (binding = 7) uniform sampler2D texBRDF_LUT;
 
+// define USE_SH_IRRADIANCE to evaluate the diffuse irradiance from spherical harmonics instead of texEnvMapIrradiance
+#ifdef USE_SH_IRRADIANCE
+#include <../../../data/shaders/SHIrradiance.h>
+#endif
+
 // Based on: https://github.com/KhronosGroup/glTF-WebGL-PBR/blob/master/shaders/pbr-frag.glsl
 
 // Encapsulate the various inputs used by the various functions in the shading equation
@@ -71,7 +76,11 @@ vec3 getIBLContribution(PBRInfo pbrInputs, vec3 n, vec3 reflection)
 	vec3 cm = vec3(1.0, 1.0, 1.0);
 #endif
 	// HDR envmaps are already linear
+#ifdef USE_SH_IRRADIANCE
+	vec3 diffuseLight = irradianceSH(n.xyz * cm);
+#else
 	vec3 diffuseLight = texture(texEnvMapIrradiance, n.xyz * cm).rgb;
+#endif
 	vec3 specularLight = textureLod(texEnvMap, reflection.xyz * cm, lod).rgb;
 
 	vec3 diffuse = diffuseLight * pbrInputs.diffuseColor;
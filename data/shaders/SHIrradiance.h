@@ -0,0 +1,23 @@
+// L2 spherical harmonics irradiance written by FilterEnvmap --sh, see shared/UtilsSphericalHarmonics.h.
+// rgb of every vec4 is a coefficient, in the same units as the irradiance cube map
+layout(std140, binding = 8) uniform SHIrradianceData
+{
+	vec4 shIrradiance[9];
+};
+
+// 'n' is the vector used to sample the irradiance cube map
+vec3 irradianceSH(vec3 n)
+{
+	vec3 E =
+		shIrradiance[0].rgb * 0.282095 +
+		shIrradiance[1].rgb * 0.488603 * n.y +
+		shIrradiance[2].rgb * 0.488603 * n.z +
+		shIrradiance[3].rgb * 0.488603 * n.x +
+		shIrradiance[4].rgb * 1.092548 * n.x * n.y +
+		shIrradiance[5].rgb * 1.092548 * n.y * n.z +
+		shIrradiance[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+		shIrradiance[7].rgb * 1.092548 * n.x * n.z +
+		shIrradiance[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+
+	return max(E, vec3(0.0));
+}
@@ -0,0 +1,79 @@
+#version 460 core
+
+#extension GL_ARB_bindless_texture : require
+#extension GL_ARB_gpu_shader_int64 : enable
+
+struct ImpostorData
+{
+	vec4 centerRadius;
+
+	uint framesPerSide;
+	uint frameSize;
+	uint padding0_;
+	uint padding1_;
+
+	uint64_t albedoMap_;
+	uint64_t normalMap_;
+	uint64_t depthMap_;
+	uint64_t padding2_;
+};
+
+struct CardData
+{
+	mat4 model;
+	uint impostor;
+	uint padding_[3];
+};
+
+layout(std140, binding = 0) uniform PerFrameData
+{
+	mat4 view;
+	mat4 proj;
+	vec4 cameraPos;
+};
+
+layout(std430, binding = 3) restrict readonly buffer Impostors
+{
+	ImpostorData in_Impostors[];
+};
+
+layout(std430, binding = 4) restrict readonly buffer Cards
+{
+	CardData in_Cards[];
+};
+
+layout (location=0) in vec2 v_tc;
+layout (location=1) in vec3 v_localPos;
+layout (location=2) in flat vec3 v_frameDir;
+layout (location=3) in flat uint cardIdx;
+
+layout (location=0) out vec4 out_FragColor;
+
+void main()
+{
+	CardData card = in_Cards[cardIdx];
+	ImpostorData imp = in_Impostors[card.impostor];
+
+	vec4 albedo = texture(sampler2D(unpackUint2x32(imp.albedoMap_)), v_tc);
+
+	// coverage of the baked texel
+	if (albedo.a < 0.5)
+		discard;
+
+	vec3 localNormal = texture(sampler2D(unpackUint2x32(imp.normalMap_)), v_tc).xyz * 2.0 - 1.0;
+	float depth = texture(sampler2D(unpackUint2x32(imp.depthMap_)), v_tc).r * 2.0 - 1.0;
+
+	// move the fragment from the card plane to the baked surface, so impostors intersect the scene correctly
+	vec3 surfacePos = v_localPos + v_frameDir * depth * imp.centerRadius.w;
+	vec4 clipPos = proj * view * card.model * vec4(surfacePos, 1.0);
+	gl_FragDepth = clipPos.z / clipPos.w * 0.5 + 0.5;
+
+	// the same lighting as mesh.frag
+	vec3 n = normalize(transpose(inverse(mat3(card.model))) * localNormal);
+
+	vec3 lightDir = normalize(vec3(-1.0, 1.0, 0.1));
+
+	float NdotL = clamp( dot( n, lightDir ), 0.3, 1.0 );
+
+	out_FragColor = vec4( albedo.rgb * NdotL, 1.0 );
+}
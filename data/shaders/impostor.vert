@@ -0,0 +1,104 @@
+#version 460 core
+
+#extension GL_ARB_gpu_shader_int64 : enable
+
+struct ImpostorData
+{
+	vec4 centerRadius;
+
+	uint framesPerSide;
+	uint frameSize;
+	uint padding0_;
+	uint padding1_;
+
+	uint64_t albedoMap_;
+	uint64_t normalMap_;
+	uint64_t depthMap_;
+	uint64_t padding2_;
+};
+
+struct CardData
+{
+	mat4 model;
+	uint impostor;
+	uint padding_[3];
+};
+
+layout(std140, binding = 0) uniform PerFrameData
+{
+	mat4 view;
+	mat4 proj;
+	vec4 cameraPos;
+};
+
+layout(std430, binding = 3) restrict readonly buffer Impostors
+{
+	ImpostorData in_Impostors[];
+};
+
+layout(std430, binding = 4) restrict readonly buffer Cards
+{
+	CardData in_Cards[];
+};
+
+// impostor LOD quad: x, y in [-1, 1] on the card, uv = xy * 0.5 + 0.5
+layout (location=0) in vec3 in_Vertex;
+layout (location=1) in vec2 in_TexCoord;
+
+layout (location=0) out vec2 v_tc;
+layout (location=1) out vec3 v_localPos;
+layout (location=2) out flat vec3 v_frameDir;
+layout (location=3) out flat uint cardIdx;
+
+// same mapping as OctahedralEncode()/OctahedralDecode() in shared/scene/Impostor.cpp: +Y at the center, -Y at the corners
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octEncode(vec3 dir)
+{
+	vec3 d = dir / (abs(dir.x) + abs(dir.y) + abs(dir.z));
+	vec2 p = d.xz;
+	if (d.y < 0.0)
+		p = (1.0 - abs(p.yx)) * signNotZero(p);
+	return p * 0.5 + 0.5;
+}
+
+vec3 octDecode(vec2 uv)
+{
+	vec2 p = uv * 2.0 - 1.0;
+	vec3 d = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+	if (d.y < 0.0)
+		d.xz = (1.0 - abs(d.zx)) * signNotZero(d.xz);
+	return normalize(d);
+}
+
+void main()
+{
+	CardData card = in_Cards[gl_BaseInstance];
+	ImpostorData imp = in_Impostors[card.impostor];
+
+	vec3 center = imp.centerRadius.xyz;
+	float radius = imp.centerRadius.w;
+	float n = float(imp.framesPerSide);
+
+	// snap the view direction (in mesh space) to the nearest baked frame
+	vec3 localCamera = (inverse(card.model) * vec4(cameraPos.xyz, 1.0)).xyz;
+	vec2 frame = clamp(round(octEncode(normalize(localCamera - center)) * (n - 1.0)), vec2(0.0), vec2(n - 1.0));
+	vec3 dir = octDecode(frame / (n - 1.0));
+
+	// GetImpostorFrameBasis()
+	vec3 ref = abs(dir.y) > 0.999 ? vec3(0.0, 0.0, -1.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(ref, dir));
+	vec3 up = cross(dir, right);
+
+	vec3 pos = center + (right * in_Vertex.x + up * in_Vertex.y) * radius;
+
+	gl_Position = proj * view * card.model * vec4(pos, 1.0);
+
+	v_tc = (frame + in_TexCoord) / n;
+	v_localPos = pos;
+	v_frameDir = dir;
+	cardIdx = gl_BaseInstance;
+}
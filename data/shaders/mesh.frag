@@ -21,6 +21,12 @@ struct MaterialData
 	uint64_t metallicRoughnessMap_;
 	uint64_t normalMap_;
 	uint64_t opacityMap_;
+
+	// 16-bit texture array layers: ambientOcclusion | emissive, albedo | metallicRoughness, normal | opacity
+	uint ambientOcclusionEmissiveLayers_;
+	uint albedoMetallicRoughnessLayers_;
+	uint normalOpacityLayers_;
+	uint padding_;
 };
 
 layout(std140, binding = 0) uniform PerFrameData
@@ -46,6 +52,11 @@ layout (binding = 5) uniform samplerCube texEnvMap;
 layout (binding = 6) uniform samplerCube texEnvMapIrradiance;
 layout (binding = 7) uniform sampler2D texBRDF_LUT;
 
+// define USE_SH_IRRADIANCE to evaluate the diffuse irradiance from spherical harmonics instead of texEnvMapIrradiance
+#ifdef USE_SH_IRRADIANCE
+#include <../../../data/shaders/SHIrradiance.h>
+#endif
+
 void runAlphaTest(float alpha, float alphaThreshold)
 {
 	if (alphaThreshold > 0.0)
@@ -108,7 +119,11 @@ vec3 getIBLContribution(PBRInfo pbrInputs, vec3 n, vec3 reflection)
 	vec3 cm = vec3(1.0, 1.0, 1.0);
 #endif
 	// HDR envmaps are already linear
+#ifdef USE_SH_IRRADIANCE
+	vec3 diffuseLight = irradianceSH(n.xyz * cm);
+#else
 	vec3 diffuseLight = texture(texEnvMapIrradiance, n.xyz * cm).rgb;
+#endif
 	vec3 specularLight = textureLod(texEnvMap, reflection.xyz * cm, lod).rgb;
 
 	vec3 diffuse = diffuseLight * pbrInputs.diffuseColor;
@@ -275,7 +290,9 @@ mat3 cotangentFrame( vec3 N, vec3 p, vec2 uv )
 
 vec3 perturbNormal(vec3 n, vec3 v, vec3 normalSample, vec2 uv)
 {
-	vec3 map = normalize( 2.0 * normalSample - vec3(1.0) );
+	// z is reconstructed, two-channel (BC5) normal maps do not store it
+	vec3 map = vec3( 2.0 * normalSample.xy - vec2(1.0), 0.0 );
+	map.z = sqrt( clamp( 1.0 - dot(map.xy, map.xy), 0.0, 1.0 ) );
 	mat3 TBN = cotangentFrame(n, v, uv);
 	return normalize(TBN * map);
 }
@@ -287,11 +304,11 @@ void main()
 	vec4 albedo = mtl.albedoColor_;
 	vec3 normalSample = vec3(0.0, 0.0, 0.0);
 
-	// fetch albedo
+	// fetch albedo, all material textures are arrays (standalone textures have a single layer)
 	if (mtl.albedoMap_ > 0)
-		albedo = texture( sampler2D(unpackUint2x32(mtl.albedoMap_)), v_tc);
+		albedo = texture( sampler2DArray(unpackUint2x32(mtl.albedoMap_)), vec3(v_tc, float(mtl.albedoMetallicRoughnessLayers_ & 0xFFFFu)));
 	if (mtl.normalMap_ > 0)
-		normalSample = texture( sampler2D(unpackUint2x32(mtl.normalMap_)), v_tc).xyz;
+		normalSample = texture( sampler2DArray(unpackUint2x32(mtl.normalMap_)), vec3(v_tc, float(mtl.normalOpacityLayers_ & 0xFFFFu))).xyz;
 
 	runAlphaTest(albedo.a, mtl.alphaTest_);
 
@@ -304,7 +321,14 @@ void main()
 
 	vec3 lightDir = normalize(vec3(-1.0, 1.0, 0.1));
 
+#ifdef USE_SH_IRRADIANCE
+	// the diffuse irradiance of the environment replaces the constant ambient term
+	float NdotL = clamp( dot( n, lightDir ), 0.0, 1.0 );
+
+	out_FragColor = vec4( albedo.rgb * (NdotL + irradianceSH(n)), 1.0 );
+#else
 	float NdotL = clamp( dot( n, lightDir ), 0.3, 1.0 );
 
 	out_FragColor = vec4( albedo.rgb * NdotL, 1.0 );
+#endif
 };
\ No newline at end of file
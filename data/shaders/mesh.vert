@@ -20,6 +20,12 @@ struct MaterialData
 	uint64_t metallicRoughnessMap_;
 	uint64_t normalMap_;
 	uint64_t opacityMap_;
+
+	// 16-bit texture array layers: ambientOcclusion | emissive, albedo | metallicRoughness, normal | opacity
+	uint ambientOcclusionEmissiveLayers_;
+	uint albedoMetallicRoughnessLayers_;
+	uint normalOpacityLayers_;
+	uint padding_;
 };
 
 layout(std140, binding = 0) uniform PerFrameData
@@ -0,0 +1,254 @@
+#include "ConversionReport.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#if defined(_WIN32)
+#	define NOMINMAX
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+#include "EasyProfilerWrapper.h"
+
+namespace {
+    std::string EscapeJSON(const std::string& s) {
+        std::string result;
+        result.reserve(s.size());
+        for (const char c: s) {
+            switch (c) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        char code[8];
+                        snprintf(code, sizeof(code), "\\u%04x", (unsigned)c);
+                        result += code;
+                    } else {
+                        result += c;
+                    }
+            }
+        }
+        return result;
+    }
+}
+
+ConversionReport::ConversionReport()
+    : mStartTime(std::chrono::steady_clock::now()) {
+}
+
+ConversionReport::Stage::Stage(ConversionReport& report, std::string scope, std::string name)
+    : mReport(report)
+    , mScope(std::move(scope))
+    , mName(std::move(name))
+    , mStart(report.GetTime())
+    , mCPUStart(GetProcessCPUTime()) {
+    GetIOCounters(mBytesReadStart, mBytesWrittenStart);
+#if BUILD_WITH_EASY_PROFILER
+    EASY_NONSCOPED_BLOCK(mName.c_str(), profiler::colors::Magenta);
+#endif
+}
+
+ConversionReport::Stage::~Stage() {
+#if BUILD_WITH_EASY_PROFILER
+    EASY_END_BLOCK;
+#endif
+    uint64_t bytesRead, bytesWritten;
+    GetIOCounters(bytesRead, bytesWritten);
+
+    Event event;
+    event.mCategory = "stage";
+    event.mScope = std::move(mScope);
+    event.mName = std::move(mName);
+    event.mStart = mStart;
+    event.mDuration = mReport.GetTime() - mStart;
+    event.mCPUTime = GetProcessCPUTime() - mCPUStart;
+    event.mBytesRead = bytesRead - mBytesReadStart;
+    event.mBytesWritten = bytesWritten - mBytesWrittenStart;
+    event.mPeakRSS = GetPeakRSS();
+    mReport.AddEvent(std::move(event));
+}
+
+ConversionReport::Item::Item(ConversionReport& report, std::string category, std::string name)
+    : mReport(report)
+    , mCategory(std::move(category))
+    , mName(std::move(name))
+    , mStart(report.GetTime()) {
+#if BUILD_WITH_EASY_PROFILER
+    EASY_NONSCOPED_BLOCK(mName.c_str(), profiler::colors::Green);
+#endif
+}
+
+ConversionReport::Item::~Item() {
+#if BUILD_WITH_EASY_PROFILER
+    EASY_END_BLOCK;
+#endif
+    Event event;
+    event.mCategory = std::move(mCategory);
+    event.mName = std::move(mName);
+    event.mStart = mStart;
+    event.mDuration = mReport.GetTime() - mStart;
+    mReport.AddEvent(std::move(event));
+}
+
+double ConversionReport::GetTime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+}
+
+void ConversionReport::AddEvent(Event event) {
+    std::lock_guard lock(mMutex);
+    const auto [it, inserted] = mThreadIndices.try_emplace(std::this_thread::get_id(), (uint32_t)mThreadIndices.size());
+    event.mThread = it->second;
+    mEvents.push_back(std::move(event));
+}
+
+double ConversionReport::GetProcessCPUTime() {
+#if defined(_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0.0;
+    auto toSeconds = [](const FILETIME& t) { return (double)(((uint64_t)t.dwHighDateTime << 32) | t.dwLowDateTime) * 1e-7; };
+    return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+uint64_t ConversionReport::GetPeakRSS() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#	if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss;
+#	else
+    // kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+#	endif
+#endif
+}
+
+void ConversionReport::GetIOCounters(uint64_t& bytesRead, uint64_t& bytesWritten) {
+    bytesRead = 0;
+    bytesWritten = 0;
+#if defined(_WIN32)
+    IO_COUNTERS counters = {};
+    if (GetProcessIoCounters(GetCurrentProcess(), &counters)) {
+        bytesRead = counters.ReadTransferCount;
+        bytesWritten = counters.WriteTransferCount;
+    }
+#elif defined(__linux__)
+    FILE* f = fopen("/proc/self/io", "r");
+    if (!f)
+        return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long value = 0;
+        if (sscanf(line, "rchar: %llu", &value) == 1)
+            bytesRead = value;
+        else if (sscanf(line, "wchar: %llu", &value) == 1)
+            bytesWritten = value;
+    }
+    fclose(f);
+#endif
+}
+
+bool ConversionReport::SaveJSON(const char* fileName, uint32_t numHotSpots) const {
+    FILE* f = fopen(fileName, "w");
+    if (!f)
+        return false;
+
+    std::lock_guard lock(mMutex);
+
+    std::vector<const Event*> stages;
+    std::map<std::string, std::vector<const Event*>> items;
+    for (const Event& e: mEvents) {
+        if (e.mCategory == "stage")
+            stages.push_back(&e);
+        else
+            items[e.mCategory].push_back(&e);
+    }
+
+    // events are added when they end, so nested stages come before their parents
+    std::stable_sort(stages.begin(), stages.end(), [](const Event* a, const Event* b) { return a->mStart < b->mStart; });
+
+    uint64_t bytesRead, bytesWritten;
+    GetIOCounters(bytesRead, bytesWritten);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"wallSeconds\": %.6f,\n", GetTime());
+    fprintf(f, "  \"cpuSeconds\": %.6f,\n", GetProcessCPUTime());
+    fprintf(f, "  \"peakRSSBytes\": %llu,\n", (unsigned long long)GetPeakRSS());
+    fprintf(f, "  \"bytesRead\": %llu,\n", (unsigned long long)bytesRead);
+    fprintf(f, "  \"bytesWritten\": %llu,\n", (unsigned long long)bytesWritten);
+
+    fprintf(f, "  \"stages\": [\n");
+    for (size_t i = 0 ; i != stages.size() ; i++) {
+        const Event& e = *stages[i];
+        fprintf(f, "    { \"scope\": \"%s\", \"name\": \"%s\", \"startSeconds\": %.6f, \"wallSeconds\": %.6f, \"cpuSeconds\": %.6f, "
+                   "\"bytesRead\": %llu, \"bytesWritten\": %llu, \"peakRSSBytes\": %llu }%s\n",
+                EscapeJSON(e.mScope).c_str(), EscapeJSON(e.mName).c_str(), e.mStart, e.mDuration, e.mCPUTime,
+                (unsigned long long)e.mBytesRead, (unsigned long long)e.mBytesWritten, (unsigned long long)e.mPeakRSS,
+                i + 1 != stages.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"items\": {\n");
+    size_t categoryIndex = 0;
+    for (auto& [category, events]: items) {
+        double total = 0.0;
+        for (const Event* e: events)
+            total += e->mDuration;
+
+        std::sort(events.begin(), events.end(), [](const Event* a, const Event* b) { return a->mDuration > b->mDuration; });
+        const size_t numShown = std::min<size_t>(events.size(), numHotSpots);
+
+        fprintf(f, "    \"%s\": {\n", EscapeJSON(category).c_str());
+        fprintf(f, "      \"count\": %zu,\n", events.size());
+        fprintf(f, "      \"totalSeconds\": %.6f,\n", total);
+        fprintf(f, "      \"hotSpots\": [\n");
+        for (size_t i = 0 ; i != numShown ; i++)
+            fprintf(f, "        { \"name\": \"%s\", \"seconds\": %.6f }%s\n", EscapeJSON(events[i]->mName).c_str(), events[i]->mDuration, i + 1 != numShown ? "," : "");
+        fprintf(f, "      ]\n");
+        fprintf(f, "    }%s\n", ++categoryIndex != items.size() ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    return true;
+}
+
+bool ConversionReport::SaveChromeTrace(const char* fileName) const {
+    FILE* f = fopen(fileName, "w");
+    if (!f)
+        return false;
+
+    std::lock_guard lock(mMutex);
+
+    fprintf(f, "{ \"traceEvents\": [\n");
+    for (size_t i = 0 ; i != mEvents.size() ; i++) {
+        const Event& e = mEvents[i];
+        const std::string name = e.mScope.empty() ? e.mName : e.mScope + ": " + e.mName;
+        fprintf(f, "  { \"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u }%s\n",
+                EscapeJSON(name).c_str(), EscapeJSON(e.mCategory).c_str(), e.mStart * 1e6, e.mDuration * 1e6, e.mThread,
+                i + 1 != mEvents.size() ? "," : "");
+    }
+    fprintf(f, "] }\n");
+
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* Instrumentation of offline conversion tools: wall and CPU time, bytes read and written and peak RSS of every stage,
+   plus the time of single items (meshes, textures) to find hot spots. Saved as a JSON report and optionally as a
+   Chrome trace (chrome://tracing, Perfetto). All methods may be called from several threads */
+class ConversionReport final {
+public:
+    /* One stage of the conversion, measured for the whole process (worker threads included) */
+    class Stage final {
+    public:
+        Stage(ConversionReport& report, std::string scope, std::string name);
+        ~Stage();
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+    private:
+        ConversionReport& mReport;
+        std::string mScope;
+        std::string mName;
+        double mStart;
+        double mCPUStart;
+        uint64_t mBytesReadStart;
+        uint64_t mBytesWrittenStart;
+    };
+
+    /* One item (a mesh, a texture) processed by a worker thread: wall time only */
+    class Item final {
+    public:
+        Item(ConversionReport& report, std::string category, std::string name);
+        ~Item();
+        Item(const Item&) = delete;
+        Item& operator=(const Item&) = delete;
+
+    private:
+        ConversionReport& mReport;
+        std::string mCategory;
+        std::string mName;
+        double mStart;
+    };
+
+    ConversionReport();
+
+    /* Stages in the order they were started, the slowest items of every category */
+    bool SaveJSON(const char* fileName, uint32_t numHotSpots = 20) const;
+
+    /* Stages and items as complete events of the Chrome trace event format */
+    bool SaveChromeTrace(const char* fileName) const;
+
+    /* Process counters: CPU time of all threads, bytes read and written through the OS (0 where unsupported) */
+    static double GetProcessCPUTime();
+    static uint64_t GetPeakRSS();
+    static void GetIOCounters(uint64_t& bytesRead, uint64_t& bytesWritten);
+
+private:
+    struct Event {
+        std::string mCategory;   // "stage" or the item category
+        std::string mScope;      // scene of a stage
+        std::string mName;
+        double mStart = 0.0;     // seconds since the report was created
+        double mDuration = 0.0;
+        double mCPUTime = -1.0;  // stages only
+        uint64_t mBytesRead = 0;
+        uint64_t mBytesWritten = 0;
+        uint64_t mPeakRSS = 0;
+        uint32_t mThread = 0;
+    };
+
+    double GetTime() const;
+    void AddEvent(Event event);
+
+    const std::chrono::steady_clock::time_point mStartTime;
+
+    mutable std::mutex mMutex;
+    std::vector<Event> mEvents;
+    std::unordered_map<std::thread::id, uint32_t> mThreadIndices;
+};
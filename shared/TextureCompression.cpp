@@ -0,0 +1,581 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+#include <Etc.h>
+
+#include <gli/texture2d.hpp>
+#include <gli/texture2d_array.hpp>
+#include <gli/load_ktx.hpp>
+#include <gli/save_ktx.hpp>
+
+namespace {
+    const int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct BC7Mode6Block {
+        int endpoints[2][4];    // 7-bit RGBA
+        int pbits[2];
+        uint8_t indices[16];
+    };
+
+    // 8-bit value of a 7-bit endpoint component and its p-bit
+    inline int Unquantize(int v, int pbit) { return (v << 1) | pbit; }
+
+    inline int Interpolate(int e0, int e1, int w) { return ((64 - w) * e0 + w * e1 + 32) >> 6; }
+
+    // every endpoint has its own p-bit shared by all four components, so both values are tried
+    void QuantizeEndpoint(const float* e, int* q, int& pbit) {
+        float bestError = FLT_MAX;
+        for (int p = 0 ; p != 2 ; p++) {
+            int tmp[4];
+            float error = 0.0f;
+            for (int c = 0 ; c != 4 ; c++) {
+                tmp[c] = std::clamp((int)std::lround((e[c] - (float)p) * 0.5f), 0, 127);
+                const float d = (float)Unquantize(tmp[c], p) - e[c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                std::copy(tmp, tmp + 4, q);
+                pbit = p;
+            }
+        }
+    }
+
+    // best palette entry for every pixel, returns the total squared error
+    uint32_t SelectIndices(const uint8_t* rgba, BC7Mode6Block& b) {
+        int palette[16][4];
+        for (int i = 0 ; i != 16 ; i++)
+            for (int c = 0 ; c != 4 ; c++)
+                palette[i][c] = Interpolate(Unquantize(b.endpoints[0][c], b.pbits[0]), Unquantize(b.endpoints[1][c], b.pbits[1]), kBC7Weights4[i]);
+
+        uint32_t total = 0;
+        for (int p = 0 ; p != 16 ; p++) {
+            uint32_t best = UINT32_MAX;
+            for (int i = 0 ; i != 16 ; i++) {
+                uint32_t error = 0;
+                for (int c = 0 ; c != 4 ; c++) {
+                    const int d = palette[i][c] - rgba[p * 4 + c];
+                    error += d * d;
+                }
+                if (error < best) {
+                    best = error;
+                    b.indices[p] = (uint8_t)i;
+                }
+            }
+            total += best;
+        }
+        return total;
+    }
+
+    // least squares endpoints for the given indices, false if all pixels use the same weight
+    bool FitEndpoints(const uint8_t* rgba, const uint8_t* indices, float* e0, float* e1) {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float x0[4] = { 0.0f }, x1[4] = { 0.0f };
+
+        for (int p = 0 ; p != 16 ; p++) {
+            const float t = (float)kBC7Weights4[indices[p]] / 64.0f;
+            a += (1.0f - t) * (1.0f - t);
+            b += (1.0f - t) * t;
+            c += t * t;
+            for (int k = 0 ; k != 4 ; k++) {
+                x0[k] += (1.0f - t) * rgba[p * 4 + k];
+                x1[k] += t * rgba[p * 4 + k];
+            }
+        }
+
+        const float det = a * c - b * b;
+        if (std::fabs(det) < 1e-6f)
+            return false;
+
+        for (int k = 0 ; k != 4 ; k++) {
+            e0[k] = std::clamp((c * x0[k] - b * x1[k]) / det, 0.0f, 255.0f);
+            e1[k] = std::clamp((a * x1[k] - b * x0[k]) / det, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // endpoints at the extremes of the principal axis of the block colors
+    void InitialEndpoints(const uint8_t* rgba, float* e0, float* e1) {
+        float mean[4] = { 0.0f };
+        for (int p = 0 ; p != 16 ; p++)
+            for (int k = 0 ; k != 4 ; k++)
+                mean[k] += rgba[p * 4 + k] / 16.0f;
+
+        float cov[4][4] = { { 0.0f } };
+        for (int p = 0 ; p != 16 ; p++)
+            for (int i = 0 ; i != 4 ; i++)
+                for (int j = 0 ; j != 4 ; j++)
+                    cov[i][j] += (rgba[p * 4 + i] - mean[i]) * (rgba[p * 4 + j] - mean[j]);
+
+        // power iteration
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (int iter = 0 ; iter != 8 ; iter++) {
+            float next[4] = { 0.0f };
+            for (int i = 0 ; i != 4 ; i++)
+                for (int j = 0 ; j != 4 ; j++)
+                    next[i] += cov[i][j] * axis[j];
+            const float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (len < 1e-6f)
+                break;
+            for (int i = 0 ; i != 4 ; i++)
+                axis[i] = next[i] / len;
+        }
+
+        float tMin = FLT_MAX, tMax = -FLT_MAX;
+        for (int p = 0 ; p != 16 ; p++) {
+            float t = 0.0f;
+            for (int k = 0 ; k != 4 ; k++)
+                t += (rgba[p * 4 + k] - mean[k]) * axis[k];
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+
+        for (int k = 0 ; k != 4 ; k++) {
+            e0[k] = std::clamp(mean[k] + tMin * axis[k], 0.0f, 255.0f);
+            e1[k] = std::clamp(mean[k] + tMax * axis[k], 0.0f, 255.0f);
+        }
+    }
+
+    void WriteBits(uint8_t* dest, int& pos, uint32_t value, int count) {
+        for (int i = 0 ; i != count ; i++, pos++)
+            if ((value >> i) & 1)
+                dest[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+    }
+
+    void EncodeMode6(BC7Mode6Block b, uint8_t* dest) {
+        // the most significant index bit of the first pixel is implicit zero
+        if (b.indices[0] & 8) {
+            std::swap(b.endpoints[0], b.endpoints[1]);
+            std::swap(b.pbits[0], b.pbits[1]);
+            for (uint8_t& i : b.indices)
+                i = (uint8_t)(15 - i);
+        }
+
+        memset(dest, 0, 16);
+        int pos = 0;
+        WriteBits(dest, pos, 1 << 6, 7);
+        for (int c = 0 ; c != 4 ; c++)
+            for (const auto& e : b.endpoints)
+                WriteBits(dest, pos, (uint32_t)e[c], 7);
+        WriteBits(dest, pos, (uint32_t)b.pbits[0], 1);
+        WriteBits(dest, pos, (uint32_t)b.pbits[1], 1);
+        for (int p = 0 ; p != 16 ; p++)
+            WriteBits(dest, pos, b.indices[p], p == 0 ? 3 : 4);
+        assert(pos == 128);
+    }
+
+    gli::format GetGLIFormat(eTextureCompression fmt) {
+        switch (fmt) {
+            case eTextureCompression::BC1:
+                return gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+            case eTextureCompression::BC3:
+                return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+            case eTextureCompression::BC5:
+                return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+            case eTextureCompression::BC7:
+                return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+            case eTextureCompression::ETC2_RGB:
+                return gli::FORMAT_RGB_ETC2_UNORM_BLOCK8;
+            case eTextureCompression::ETC2_RGBA:
+                return gli::FORMAT_RGBA_ETC2_UNORM_BLOCK16;
+            case eTextureCompression::EAC_RG11:
+                return gli::FORMAT_RG_EAC_UNORM_BLOCK16;
+            default:
+                return gli::FORMAT_RGBA8_UNORM_PACK8;
+        }
+    }
+
+    constexpr float kPi = 3.14159265358979f;
+
+    // Kaiser window parameters: the kernel spans 3 destination texels on each side
+    constexpr float kFilterRadius = 3.0f;
+    constexpr float kKaiserAlpha = 4.0f;
+
+    float SRGBToLinear(float c) { return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+
+    float LinearToSRGB(float c) { return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+    // zeroth order modified Bessel function of the first kind
+    float BesselI0(float x) {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int k = 1 ; k != 20 ; k++) {
+            const float t = x / (2.0f * (float)k);
+            term *= t * t;
+            sum += term;
+        }
+        return sum;
+    }
+
+    float Sinc(float x) {
+        x *= kPi;
+        return (std::fabs(x) < 1e-5f) ? 1.0f : std::sin(x) / x;
+    }
+
+    float KaiserSinc(float x) {
+        const float t = x / kFilterRadius;
+        if (std::fabs(t) >= 1.0f)
+            return 0.0f;
+        return Sinc(x) * BesselI0(kKaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(kKaiserAlpha);
+    }
+
+    struct FilterTaps {
+        int mFirst;
+        std::vector<float> mWeights;
+    };
+
+    // normalized weights of the source texels contributing to every destination texel
+    std::vector<FilterTaps> BuildFilter(int srcSize, int dstSize) {
+        const float scale = (float)srcSize / (float)dstSize;
+        std::vector<FilterTaps> taps(dstSize);
+
+        for (int d = 0 ; d != dstSize ; d++) {
+            const float center = ((float)d + 0.5f) * scale;
+            const int first = (int)std::floor(center - kFilterRadius * scale);
+            const int last = (int)std::ceil(center + kFilterRadius * scale);
+
+            taps[d].mFirst = first;
+            float sum = 0.0f;
+            for (int i = first ; i <= last ; i++) {
+                const float w = KaiserSinc(((float)i + 0.5f - center) / scale);
+                taps[d].mWeights.push_back(w);
+                sum += w;
+            }
+            for (float& w : taps[d].mWeights)
+                w /= sum;
+        }
+        return taps;
+    }
+
+    inline int Wrap(int i, int size) { return ((i % size) + size) % size; }
+
+    // separable downsampling of a float RGBA image
+    void Downsample(const std::vector<float>& src, int w, int h, std::vector<float>& dst, int newW, int newH) {
+        const std::vector<FilterTaps> tapsX = BuildFilter(w, newW);
+        const std::vector<FilterTaps> tapsY = BuildFilter(h, newH);
+
+        std::vector<float> tmp((size_t)newW * h * 4, 0.0f);
+        for (int y = 0 ; y != h ; y++)
+            for (int x = 0 ; x != newW ; x++) {
+                float* out = &tmp[((size_t)y * newW + x) * 4];
+                for (size_t i = 0 ; i != tapsX[x].mWeights.size() ; i++) {
+                    const float* in = &src[((size_t)y * w + Wrap(tapsX[x].mFirst + (int)i, w)) * 4];
+                    for (int c = 0 ; c != 4 ; c++)
+                        out[c] += in[c] * tapsX[x].mWeights[i];
+                }
+            }
+
+        dst.assign((size_t)newW * newH * 4, 0.0f);
+        for (int y = 0 ; y != newH ; y++)
+            for (int x = 0 ; x != newW ; x++) {
+                float* out = &dst[((size_t)y * newW + x) * 4];
+                for (size_t i = 0 ; i != tapsY[y].mWeights.size() ; i++) {
+                    const float* in = &tmp[((size_t)Wrap(tapsY[y].mFirst + (int)i, h) * newW + x) * 4];
+                    for (int c = 0 ; c != 4 ; c++)
+                        out[c] += in[c] * tapsY[y].mWeights[i];
+                }
+            }
+    }
+
+    inline uint8_t ToUnorm8(float v) { return (uint8_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f); }
+
+    float AlphaCoverage(const std::vector<float>& img, float cutoff, float scale) {
+        size_t count = 0;
+        for (size_t i = 3 ; i < img.size() ; i += 4)
+            if (img[i] * scale > cutoff)
+                count++;
+        return (float)count / (float)(img.size() / 4);
+    }
+
+    // the alpha scale which gives the desired alpha test coverage, coverage grows monotonically with the scale
+    float FindAlphaScale(const std::vector<float>& img, float cutoff, float coverage) {
+        float lo = 0.0f;
+        float hi = 4.0f;
+        for (int i = 0 ; i != 16 ; i++) {
+            const float mid = 0.5f * (lo + hi);
+            if (AlphaCoverage(img, cutoff, mid) < coverage)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return 0.5f * (lo + hi);
+    }
+
+    bool IsETC(eTextureCompression fmt) {
+        return fmt == eTextureCompression::ETC2_RGB || fmt == eTextureCompression::ETC2_RGBA || fmt == eTextureCompression::EAC_RG11;
+    }
+
+    std::vector<uint8_t> CompressImageETC(eTextureCompression fmt, const uint8_t* rgba, int w, int h, uint32_t numJobs, float effort) {
+        std::vector<float> src((size_t)w * h * 4);
+        for (size_t i = 0 ; i != src.size() ; i++)
+            src[i] = rgba[i] / 255.0f;
+
+        const Etc::Image::Format etcFormat =
+                (fmt == eTextureCompression::ETC2_RGB) ? Etc::Image::Format::RGB8 :
+                (fmt == eTextureCompression::ETC2_RGBA) ? Etc::Image::Format::RGBA8 : Etc::Image::Format::RG11;
+        const Etc::ErrorMetric metric =
+                (fmt == eTextureCompression::ETC2_RGB) ? Etc::ErrorMetric::REC709 :
+                (fmt == eTextureCompression::ETC2_RGBA) ? Etc::ErrorMetric::RGBA : Etc::ErrorMetric::NUMERIC;
+
+        unsigned char* bits = nullptr;
+        unsigned int numBytes = 0, extendedWidth = 0, extendedHeight = 0;
+        int encodingTime = 0;
+
+        Etc::Encode(src.data(), (unsigned int)w, (unsigned int)h, etcFormat, metric, effort, numJobs, numJobs,
+                    &bits, &numBytes, &extendedWidth, &extendedHeight, &encodingTime);
+
+        std::vector<uint8_t> result(bits, bits + numBytes);
+        delete[] bits;
+        return result;
+    }
+}
+
+eTextureCompression TextureCompressionFromString(const char* name) {
+    if (!strcmp(name, "rgba8")) return eTextureCompression::RGBA8;
+    if (!strcmp(name, "bc1")) return eTextureCompression::BC1;
+    if (!strcmp(name, "bc3")) return eTextureCompression::BC3;
+    if (!strcmp(name, "bc5")) return eTextureCompression::BC5;
+    if (!strcmp(name, "bc7")) return eTextureCompression::BC7;
+    if (!strcmp(name, "etc2")) return eTextureCompression::ETC2_RGB;
+    if (!strcmp(name, "etc2a")) return eTextureCompression::ETC2_RGBA;
+    if (!strcmp(name, "eac_rg")) return eTextureCompression::EAC_RG11;
+    return eTextureCompression::None;
+}
+
+uint32_t GetBlockSize(eTextureCompression fmt) {
+    switch (fmt) {
+        case eTextureCompression::BC1:
+        case eTextureCompression::ETC2_RGB:
+            return 8;
+        case eTextureCompression::BC3:
+        case eTextureCompression::BC5:
+        case eTextureCompression::BC7:
+        case eTextureCompression::ETC2_RGBA:
+        case eTextureCompression::EAC_RG11:
+            return 16;
+        default:
+            return 4 * 4 * 4;
+    }
+}
+
+eTextureCompression GetNormalMapCompression(eTextureCompression fmt) {
+    if (fmt == eTextureCompression::None || fmt == eTextureCompression::RGBA8)
+        return fmt;
+    return IsETC(fmt) ? eTextureCompression::EAC_RG11 : eTextureCompression::BC5;
+}
+
+eTextureCompression GetAlphaCompression(eTextureCompression fmt) {
+    switch (fmt) {
+        case eTextureCompression::BC1:
+            return eTextureCompression::BC3;
+        case eTextureCompression::ETC2_RGB:
+            return eTextureCompression::ETC2_RGBA;
+        default:
+            return fmt;
+    }
+}
+
+void CompressBlockBC7(const uint8_t* rgba, uint8_t* dest) {
+    float e0[4], e1[4];
+    InitialEndpoints(rgba, e0, e1);
+
+    BC7Mode6Block best;
+    QuantizeEndpoint(e0, best.endpoints[0], best.pbits[0]);
+    QuantizeEndpoint(e1, best.endpoints[1], best.pbits[1]);
+    uint32_t bestError = SelectIndices(rgba, best);
+
+    for (int iter = 0 ; iter != 2 && bestError > 0 ; iter++) {
+        if (!FitEndpoints(rgba, best.indices, e0, e1))
+            break;
+
+        BC7Mode6Block b;
+        QuantizeEndpoint(e0, b.endpoints[0], b.pbits[0]);
+        QuantizeEndpoint(e1, b.endpoints[1], b.pbits[1]);
+        const uint32_t error = SelectIndices(rgba, b);
+        if (error >= bestError)
+            break;
+
+        best = b;
+        bestError = error;
+    }
+
+    EncodeMode6(best, dest);
+}
+
+void CompressBlock(eTextureCompression fmt, const uint8_t* rgba, uint8_t* dest) {
+    switch (fmt) {
+        case eTextureCompression::BC1:
+            stb_compress_dxt_block(dest, rgba, 0, STB_DXT_HIGHQUAL);
+            break;
+        case eTextureCompression::BC3:
+            stb_compress_dxt_block(dest, rgba, 1, STB_DXT_HIGHQUAL);
+            break;
+        case eTextureCompression::BC5: {
+            uint8_t rg[16 * 2];
+            for (int p = 0 ; p != 16 ; p++) {
+                rg[p * 2 + 0] = rgba[p * 4 + 0];
+                rg[p * 2 + 1] = rgba[p * 4 + 1];
+            }
+            stb_compress_bc5_block(dest, rg);
+            break;
+        }
+        case eTextureCompression::BC7:
+            CompressBlockBC7(rgba, dest);
+            break;
+        default:
+            memcpy(dest, rgba, 4 * 4 * 4);
+            break;
+    }
+}
+
+std::vector<uint8_t> CompressImage(eTextureCompression fmt, const uint8_t* rgba, int w, int h, tf::Executor* executor, float etcEffort) {
+    if (fmt == eTextureCompression::None || fmt == eTextureCompression::RGBA8)
+        return std::vector<uint8_t>(rgba, rgba + (size_t)w * h * 4);
+
+    if (IsETC(fmt))
+        return CompressImageETC(fmt, rgba, w, h, executor ? (uint32_t)executor->num_workers() : 1u, etcEffort);
+
+    const int blocksX = (w + 3) / 4;
+    const int blocksY = (h + 3) / 4;
+    const uint32_t blockSize = GetBlockSize(fmt);
+
+    std::vector<uint8_t> result((size_t)blocksX * blocksY * blockSize);
+
+    auto compressRow = [&](int by) {
+        uint8_t block[4 * 4 * 4];
+        for (int bx = 0 ; bx != blocksX ; bx++) {
+            for (int y = 0 ; y != 4 ; y++)
+                for (int x = 0 ; x != 4 ; x++) {
+                    const int sx = std::min(bx * 4 + x, w - 1);
+                    const int sy = std::min(by * 4 + y, h - 1);
+                    memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * w + sx) * 4, 4);
+                }
+            CompressBlock(fmt, block, result.data() + ((size_t)by * blocksX + bx) * blockSize);
+        }
+    };
+
+    if (executor) {
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(0, blocksY, 1, compressRow);
+        executor->run(taskflow).wait();
+    } else {
+        for (int by = 0 ; by != blocksY ; by++)
+            compressRow(by);
+    }
+
+    return result;
+}
+
+bool SaveCompressedKTX(const char* fileName, eTextureCompression fmt, const uint8_t* rgba, int w, int h, tf::Executor* executor,
+                       float etcEffort, const MipChainOptions& mipOptions) {
+    const std::vector<std::vector<uint8_t>> levels = GenerateMipChain(rgba, w, h, mipOptions);
+
+    gli::texture2d texture(GetGLIFormat(fmt), gli::extent2d(w, h), levels.size());
+
+    for (size_t l = 0 ; l != levels.size() ; l++) {
+        const int levelW = std::max(w >> l, 1);
+        const int levelH = std::max(h >> l, 1);
+        const std::vector<uint8_t> blocks = CompressImage(fmt, levels[l].data(), levelW, levelH, executor, etcEffort);
+        assert(blocks.size() == texture.size(l));
+        memcpy(texture.data(0, 0, l), blocks.data(), std::min(blocks.size(), texture.size(l)));
+    }
+
+    return gli::save_ktx(texture, fileName);
+}
+
+std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* rgba, int w, int h, const MipChainOptions& options) {
+    std::vector<std::vector<uint8_t>> levels;
+    levels.emplace_back(rgba, rgba + (size_t)w * h * 4);
+
+    // the whole chain is filtered in linear space: linear light for colors, [-1..1] vectors for normals
+    std::vector<float> level((size_t)w * h * 4);
+    for (size_t i = 0 ; i != level.size() ; i++) {
+        const float v = rgba[i] / 255.0f;
+        if ((i & 3) == 3)
+            level[i] = v;
+        else if (options.mNormalMap)
+            level[i] = v * 2.0f - 1.0f;
+        else
+            level[i] = options.mSRGB ? SRGBToLinear(v) : v;
+    }
+
+    const float coverage = (options.mAlphaCutoff > 0.0f) ? AlphaCoverage(level, options.mAlphaCutoff, 1.0f) : 0.0f;
+
+    std::vector<float> next;
+    while (w > 1 || h > 1) {
+        const int newW = std::max(w / 2, 1);
+        const int newH = std::max(h / 2, 1);
+        Downsample(level, w, h, next, newW, newH);
+        level.swap(next);
+        w = newW;
+        h = newH;
+
+        const float alphaScale = (options.mAlphaCutoff > 0.0f) ? FindAlphaScale(level, options.mAlphaCutoff, coverage) : 1.0f;
+
+        std::vector<uint8_t> bytes(level.size());
+        for (size_t p = 0 ; p != level.size() / 4 ; p++) {
+            const float* v = &level[p * 4];
+            float rgb[3] = { v[0], v[1], v[2] };
+
+            if (options.mNormalMap) {
+                const float len = std::sqrt(rgb[0] * rgb[0] + rgb[1] * rgb[1] + rgb[2] * rgb[2]);
+                for (float& c : rgb)
+                    c = (len > 1e-6f ? c / len : 0.0f) * 0.5f + 0.5f;
+            } else if (options.mSRGB) {
+                for (float& c : rgb)
+                    c = LinearToSRGB(std::max(c, 0.0f));
+            }
+
+            bytes[p * 4 + 0] = ToUnorm8(rgb[0]);
+            bytes[p * 4 + 1] = ToUnorm8(rgb[1]);
+            bytes[p * 4 + 2] = ToUnorm8(rgb[2]);
+            bytes[p * 4 + 3] = ToUnorm8(v[3] * alphaScale);
+        }
+        levels.push_back(std::move(bytes));
+    }
+
+    return levels;
+}
+
+bool GetKTXImageInfo(const char* fileName, KTXImageInfo& info) {
+    const gli::texture texture = gli::load_ktx(fileName);
+    if (texture.empty() || texture.target() != gli::TARGET_2D)
+        return false;
+
+    info.mFormat = (uint32_t)texture.format();
+    info.mWidth = texture.extent(0).x;
+    info.mHeight = texture.extent(0).y;
+    info.mLevels = (int)texture.levels();
+    return true;
+}
+
+bool SaveKTXArray(const char* fileName, const std::vector<std::string>& layerFiles) {
+    if (layerFiles.empty())
+        return false;
+
+    KTXImageInfo info;
+    if (!GetKTXImageInfo(layerFiles[0].c_str(), info))
+        return false;
+
+    gli::texture2d_array array((gli::format)info.mFormat, gli::extent2d(info.mWidth, info.mHeight), layerFiles.size(), info.mLevels);
+
+    for (size_t layer = 0 ; layer != layerFiles.size() ; layer++) {
+        const gli::texture texture = gli::load_ktx(layerFiles[layer].c_str());
+        if (texture.empty() || texture.target() != gli::TARGET_2D || (uint32_t)texture.format() != info.mFormat ||
+            texture.extent(0).x != info.mWidth || texture.extent(0).y != info.mHeight || (int)texture.levels() != info.mLevels)
+            return false;
+
+        for (int level = 0 ; level != info.mLevels ; level++)
+            memcpy(array.data(layer, 0, level), texture.data(0, 0, level), texture.size(level));
+    }
+
+    return gli::save_ktx(array, fileName);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <taskflow/taskflow.hpp>
+
+enum class eTextureCompression {
+    None,
+    BC1,    // RGB, 1-bit alpha (8 bytes per block)
+    BC3,    // RGBA (16 bytes per block)
+    BC5,    // two channels, used for tangent-space normal maps (z is reconstructed in the shader)
+    BC7,    // high quality RGBA (mode 6 only)
+    RGBA8,  // uncompressed KTX, precomputed mips without block compression
+    ETC2_RGB,   // etc2comp, for devices without BC support
+    ETC2_RGBA,
+    EAC_RG11    // two channels, normal maps
+};
+
+/* Default etc2comp effort (0..100), higher is slower and better */
+constexpr float kDefaultETCEffort = 40.0f;
+
+/* "png", "rgba8", "bc1", "bc3", "bc5", "bc7", "etc2", "etc2a", "eac_rg". Unknown names map to eTextureCompression::None */
+eTextureCompression TextureCompressionFromString(const char* name);
+
+/* Bytes per 4x4 block */
+uint32_t GetBlockSize(eTextureCompression fmt);
+
+/* Two-channel format of the same family for normal maps (BC5 or EAC RG11), uncompressed formats are returned as is */
+eTextureCompression GetNormalMapCompression(eTextureCompression fmt);
+
+/* Format of the same family which keeps the alpha channel */
+eTextureCompression GetAlphaCompression(eTextureCompression fmt);
+
+/* Compress 4x4 RGBA8 pixels (64 bytes, row by row) into one block. ETC formats are encoded per image, see CompressImage() */
+void CompressBlock(eTextureCompression fmt, const uint8_t* rgba, uint8_t* dest);
+
+/* BC7 mode 6 encoder: principal axis endpoints refined with least squares */
+void CompressBlockBC7(const uint8_t* rgba, uint8_t* dest);
+
+/* Compress a whole RGBA8 image, edge blocks are padded by clamping. Rows of blocks are spread across the executor threads,
+   ETC formats use the etc2comp job system with as many jobs as the executor has workers */
+std::vector<uint8_t> CompressImage(eTextureCompression fmt, const uint8_t* rgba, int w, int h, tf::Executor* executor = nullptr, float etcEffort = kDefaultETCEffort);
+
+struct MipChainOptions {
+    // color channels are stored in sRGB and filtered in linear light
+    bool mSRGB = true;
+
+    // RGB is a tangent-space normal which is renormalized in every level
+    bool mNormalMap = false;
+
+    // alpha test threshold (0 - disabled). Alpha of every level is scaled to keep the coverage of the first level,
+    // so alpha-tested geometry does not thin out in the distance
+    float mAlphaCutoff = 0.0f;
+};
+
+/* All mip levels of an RGBA8 image starting with the image itself. Every level is a Kaiser-windowed sinc downsampling
+   of the previous one (wrapping at the edges), the last level is 1x1 */
+std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* rgba, int w, int h, const MipChainOptions& options);
+
+/* Compress the image with a full mip chain (see GenerateMipChain()) and save it as KTX */
+bool SaveCompressedKTX(const char* fileName, eTextureCompression fmt, const uint8_t* rgba, int w, int h, tf::Executor* executor = nullptr,
+                       float etcEffort = kDefaultETCEffort, const MipChainOptions& mipOptions = MipChainOptions());
+
+struct KTXImageInfo {
+    uint32_t mFormat = 0;   // gli::format (the same values as VkFormat)
+    int mWidth = 0;
+    int mHeight = 0;
+    int mLevels = 0;
+};
+
+/* Format and size of a 2D KTX file. Returns false if the file cannot be loaded or is not a single 2D texture */
+bool GetKTXImageInfo(const char* fileName, KTXImageInfo& info);
+
+/* Combine 2D KTX files of the same format, size and mip count into one 2D array KTX file (one layer per file, in order) */
+bool SaveKTXArray(const char* fileName, const std::vector<std::string>& layerFiles);
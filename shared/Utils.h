@@ -5,6 +5,7 @@
 #endif
 
 #include <malloc.h>
+#include <cstdint>
 #include <string>
 #include <algorithm>
 #include <cstring>
@@ -35,6 +36,14 @@ inline int AddUnique(std::vector<std::string>& files, const std::string& file) {
     return (int)std::distance(files.begin(), i);
 }
 
+// 64-bit FNV-1a hash of a memory block (pass the previous result as 'hash' to hash several blocks)
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0 ; i != size ; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
 // From https://stackoverflow.com/a/64152990/1182653
 // Delete a list of items from std::vector with indices in 'selection'
 template <class T, class Index = int> inline void EraseSelected(std::vector<T>& v, const std::vector<Index>& selection)
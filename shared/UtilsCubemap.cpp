@@ -24,6 +24,18 @@ vec3 FaceCoordsToXYZ(int i, int j, int faceID, int faceSize)
     return {};
 }
 
+vec3 EquirectangularToDirection(float u, float v) {
+    const float theta = u * glm::two_pi<float>() - glm::pi<float>();
+    const float phi = glm::half_pi<float>() - v * glm::pi<float>();
+    return vec3(cos(phi) * cos(theta), cos(phi) * sin(theta), sin(phi));
+}
+
+glm::vec2 DirectionToEquirectangular(const vec3& dir) {
+    const float theta = atan2(dir.y, dir.x);
+    const float phi = asin(std::clamp(dir.z, -1.0f, 1.0f));
+    return glm::vec2((theta + glm::pi<float>()) / glm::two_pi<float>(), (glm::half_pi<float>() - phi) / glm::pi<float>());
+}
+
 Bitmap ConvertEquirectangularMapToVerticalCross(const Bitmap& b) {
     if (b.mType != eBitmapType::TwoD) return {};
     const int faceSize = b.mW / 4;
@@ -3,4 +3,9 @@
 #include "Bitmap.h"
 
 Bitmap ConvertEquirectangularMapToVerticalCross(const Bitmap& b);
-Bitmap ConvertVerticalCrossToCubeMapFaces(const Bitmap& b);
\ No newline at end of file
+Bitmap ConvertVerticalCrossToCubeMapFaces(const Bitmap& b);
+
+/* Direction of the point of an equirectangular map at normalized coordinates (u, v), the inverse of the mapping used by
+   ConvertEquirectangularMapToVerticalCross() */
+glm::vec3 EquirectangularToDirection(float u, float v);
+glm::vec2 DirectionToEquirectangular(const glm::vec3& dir);
@@ -0,0 +1,285 @@
+#include "UtilsIBL.h"
+#include "UtilsCubemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/ext.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <gli/texture2d.hpp>
+#include <gli/texture_cube.hpp>
+#include <gli/save_ktx.hpp>
+
+using glm::vec2;
+using glm::vec3;
+
+namespace {
+    /// From Henry J. Warren's "Hacker's Delight", the same sequence as FilterEnvmap
+    float RadicalInverse_VdC(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
+    }
+
+    std::vector<vec2> GenerateHammersleyTable(int numSamples) {
+        std::vector<vec2> table(numSamples);
+        for (int i = 0 ; i != numSamples ; i++)
+            table[i] = vec2(float(i) / float(numSamples), RadicalInverse_VdC(i));
+        return table;
+    }
+
+    /* GGX half vector around +Z, 'alpha' is the squared perceptual roughness */
+    vec3 ImportanceSampleGGX(const vec2& xi, float alpha) {
+        const float phi = glm::two_pi<float>() * xi.x;
+        const float cosTheta = sqrt((1.0f - xi.y) / (1.0f + (alpha * alpha - 1.0f) * xi.y));
+        const float sinTheta = sqrt(1.0f - cosTheta * cosTheta);
+        return vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+    }
+
+    float D_GGX(float NdotH, float alpha) {
+        const float a2 = alpha * alpha;
+        const float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (glm::pi<float>() * d * d);
+    }
+
+    /* Smith-Schlick geometry term with k = alpha / 2, the IBL remapping of "Real Shading in Unreal Engine 4" */
+    float G_SmithIBL(float NdotV, float NdotL, float alpha) {
+        const float k = alpha / 2.0f;
+        const float gV = NdotV / (NdotV * (1.0f - k) + k);
+        const float gL = NdotL / (NdotL * (1.0f - k) + k);
+        return gV * gL;
+    }
+
+    /* Box filtered mip chain of an equirectangular map, sampled with trilinear filtering, wrapping horizontally */
+    class EquirectangularMipChain {
+    public:
+        EquirectangularMipChain(const vec3* data, int w, int h) {
+            mLevels.push_back({ w, h, std::vector<vec3>(data, data + w * h) });
+
+            while (mLevels.back().mW > 1 && mLevels.back().mH > 1) {
+                const Level& src = mLevels.back();
+                Level dst = { src.mW / 2, src.mH / 2, {} };
+                dst.mData.resize(dst.mW * dst.mH);
+                for (int y = 0 ; y != dst.mH ; y++)
+                    for (int x = 0 ; x != dst.mW ; x++)
+                        dst.mData[y * dst.mW + x] = 0.25f * (src.Get(2 * x, 2 * y) + src.Get(2 * x + 1, 2 * y) +
+                                                             src.Get(2 * x, 2 * y + 1) + src.Get(2 * x + 1, 2 * y + 1));
+                mLevels.push_back(std::move(dst));
+            }
+        }
+
+        /* Average solid angle of a texel of mip 0 */
+        [[nodiscard]] float GetTexelSolidAngle() const {
+            return 4.0f * glm::pi<float>() / float(mLevels[0].mW * mLevels[0].mH);
+        }
+
+        [[nodiscard]] vec3 Sample(const vec3& dir, float lod) const {
+            const vec2 uv = DirectionToEquirectangular(dir);
+
+            lod = std::clamp(lod, 0.0f, float(mLevels.size() - 1));
+            const int l0 = (int)lod;
+            const int l1 = std::min(l0 + 1, (int)mLevels.size() - 1);
+            const float t = lod - float(l0);
+
+            const vec3 c0 = mLevels[l0].Sample(uv);
+            return t > 0.0f ? glm::mix(c0, mLevels[l1].Sample(uv), t) : c0;
+        }
+
+    private:
+        struct Level {
+            int mW;
+            int mH;
+            std::vector<vec3> mData;
+
+            [[nodiscard]] vec3 Get(int x, int y) const {
+                x = (x % mW + mW) % mW;
+                y = std::clamp(y, 0, mH - 1);
+                return mData[y * mW + x];
+            }
+
+            [[nodiscard]] vec3 Sample(const vec2& uv) const {
+                // texel centers
+                const float fx = uv.x * float(mW) - 0.5f;
+                const float fy = uv.y * float(mH) - 0.5f;
+                const int x = (int)floor(fx);
+                const int y = (int)floor(fy);
+                const float s = fx - float(x);
+                const float t = fy - float(y);
+                return glm::mix(glm::mix(Get(x, y), Get(x + 1, y), s), glm::mix(Get(x, y + 1), Get(x + 1, y + 1), s), t);
+            }
+        };
+
+        std::vector<Level> mLevels;
+    };
+
+    /* Light direction around +Z (N = V = +Z), its weight and the source mip it is fetched from */
+    struct GGXSample {
+        vec3 mL;
+        float mNdotL;
+        float mLod;
+    };
+
+    /* Filtered importance sampling ("GPU-Based Importance Sampling", GPU Gems 3): every sample fetches from the source mip
+       whose texels cover the solid angle of the sample, which removes the noise of low sample counts */
+    std::vector<GGXSample> GenerateGGXSamples(const std::vector<vec2>& hammersley, float alpha, float texelSolidAngle) {
+        std::vector<GGXSample> samples;
+
+        for (const vec2& xi: hammersley) {
+            const vec3 H = ImportanceSampleGGX(xi, alpha);
+            const vec3 L = vec3(2.0f * H.z * H.x, 2.0f * H.z * H.y, 2.0f * H.z * H.z - 1.0f);
+            if (L.z <= 0.0f)
+                continue;
+
+            // with N = V the pdf of L is D * NdotH / (4 * VdotH) = D / 4
+            const float pdf = D_GGX(H.z, alpha) / 4.0f;
+            const float sampleSolidAngle = 1.0f / (float(hammersley.size()) * pdf + 0.0001f);
+            const float lod = std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f);
+
+            samples.push_back({ L, L.z, lod });
+        }
+
+        return samples;
+    }
+
+    vec3 PrefilterTexel(const EquirectangularMipChain& source, const std::vector<GGXSample>& samples, const vec3& N) {
+        const vec3 up = fabs(N.z) < 0.999f ? vec3(0.0f, 0.0f, 1.0f) : vec3(1.0f, 0.0f, 0.0f);
+        const vec3 T = glm::normalize(glm::cross(up, N));
+        const vec3 B = glm::cross(N, T);
+
+        vec3 color(0.0f);
+        float weight = 0.0f;
+        for (const GGXSample& s: samples) {
+            const vec3 L = T * s.mL.x + B * s.mL.y + N * s.mL.z;
+            color += source.Sample(L, s.mLod) * s.mNdotL;
+            weight += s.mNdotL;
+        }
+
+        return weight > 0.0f ? color / weight : color;
+    }
+}
+
+std::vector<Bitmap> PrefilterSpecularCubemap(const vec3* data, int w, int h, const SpecularPrefilterSettings& settings,
+                                             tf::Executor& executor) {
+    const EquirectangularMipChain source(data, w, h);
+    const std::vector<vec2> hammersley = GenerateHammersleyTable(settings.numSamples);
+
+    int numLevels = 1;
+    while (settings.faceSize >> numLevels)
+        numLevels++;
+
+    std::vector<Bitmap> levels;
+
+    for (int l = 0 ; l != numLevels ; l++) {
+        // every mip is filtered as an equirectangular map and converted to cube faces like the HDR cube maps of GLTexture
+        const int faceSize = std::max(settings.faceSize >> l, 1);
+        const int dstW = faceSize * 4;
+        const int dstH = faceSize * 2;
+
+        const float roughness = float(l) / float(numLevels);
+        const std::vector<GGXSample> samples = l ? GenerateGGXSamples(hammersley, roughness * roughness, source.GetTexelSolidAngle()) :
+                                               std::vector<GGXSample>();
+
+        // mip 0 is a mirror, only the resolution of the source changes
+        const float mirrorLod = std::max(std::log2(float(w) / float(dstW)), 0.0f);
+
+        std::vector<vec3> equirect(dstW * dstH);
+
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(0, dstH, 1, [&](int y) {
+            for (int x = 0 ; x != dstW ; x++) {
+                // the texel positions sampled by ConvertEquirectangularMapToVerticalCross()
+                const vec3 N = EquirectangularToDirection(float(x) / float(dstW), float(y) / float(dstH));
+                equirect[y * dstW + x] = l ? PrefilterTexel(source, samples, N) : source.Sample(N, mirrorLod);
+            }
+        });
+        executor.run(taskflow).wait();
+
+        const Bitmap in(dstW, dstH, 3, eBitmapFormat::Float, equirect.data());
+        levels.push_back(ConvertVerticalCrossToCubeMapFaces(ConvertEquirectangularMapToVerticalCross(in)));
+    }
+
+    return levels;
+}
+
+bool SaveCubemapKTX(const char* fileName, const std::vector<Bitmap>& levels) {
+    if (levels.empty())
+        return false;
+
+    gli::texture_cube texture(gli::FORMAT_RGBA16_SFLOAT_PACK16, gli::extent2d(levels[0].mW, levels[0].mH), levels.size());
+
+    for (size_t l = 0 ; l != levels.size() ; l++) {
+        const Bitmap& b = levels[l];
+        const auto* src = reinterpret_cast<const float*>(b.mData.data());
+        const int texels = b.mW * b.mH;
+
+        for (int face = 0 ; face != 6 ; face++) {
+            auto* dst = texture.data<uint16_t>(0, face, l);
+            for (int i = 0 ; i != texels ; i++) {
+                const float* c = src + (face * texels + i) * b.mComp;
+                dst[i * 4 + 0] = glm::packHalf1x16(c[0]);
+                dst[i * 4 + 1] = glm::packHalf1x16(c[1]);
+                dst[i * 4 + 2] = glm::packHalf1x16(c[2]);
+                dst[i * 4 + 3] = glm::packHalf1x16(1.0f);
+            }
+        }
+    }
+
+    return gli::save_ktx(texture, fileName);
+}
+
+std::vector<vec2> GenerateBRDFLUT(int size, int numSamples, tf::Executor& executor) {
+    const std::vector<vec2> hammersley = GenerateHammersleyTable(numSamples);
+
+    std::vector<vec2> lut(size * size);
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, size, 1, [&](int y) {
+        const float roughness = 1.0f - (float(y) + 0.5f) / float(size);
+        const float alpha = roughness * roughness;
+
+        for (int x = 0 ; x != size ; x++) {
+            const float NdotV = (float(x) + 0.5f) / float(size);
+            const vec3 V = vec3(sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+
+            float scale = 0.0f;
+            float bias = 0.0f;
+            for (const vec2& xi: hammersley) {
+                const vec3 H = ImportanceSampleGGX(xi, alpha);
+                const float VdotH = glm::dot(V, H);
+                const vec3 L = 2.0f * VdotH * H - V;
+
+                const float NdotL = L.z;
+                if (NdotL <= 0.0f)
+                    continue;
+
+                const float NdotH = H.z;
+                const float G_Vis = G_SmithIBL(NdotV, NdotL, alpha) * VdotH / (NdotH * NdotV);
+                const float Fc = pow(1.0f - VdotH, 5.0f);
+                scale += (1.0f - Fc) * G_Vis;
+                bias += Fc * G_Vis;
+            }
+
+            lut[y * size + x] = vec2(scale, bias) / float(numSamples);
+        }
+    });
+    executor.run(taskflow).wait();
+
+    return lut;
+}
+
+bool SaveBRDFLUTKTX(const char* fileName, const std::vector<vec2>& lut, int size) {
+    gli::texture2d texture(gli::FORMAT_RG16_SFLOAT_PACK16, gli::extent2d(size, size), 1);
+
+    auto* dst = texture.data<uint16_t>(0, 0, 0);
+    for (int i = 0 ; i != size * size ; i++) {
+        dst[i * 2 + 0] = glm::packHalf1x16(lut[i].x);
+        dst[i * 2 + 1] = glm::packHalf1x16(lut[i].y);
+    }
+
+    return gli::save_ktx(texture, fileName);
+}
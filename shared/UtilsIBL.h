@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <taskflow/taskflow.hpp>
+
+#include "Bitmap.h"
+
+/* Offline baking of the image based lighting inputs of PBR.frag: the GGX prefiltered specular cube map (texEnvMap) and the
+   split-sum BRDF integration LUT (texBRDF_LUT). Both use precomputed Hammersley sample tables and run one task per row */
+
+struct SpecularPrefilterSettings {
+    // face size of mip 0, every mip down to 1x1 is generated
+    int faceSize = 256;
+
+    // GGX samples per texel, filtered importance sampling (fetches from the mip chain of the source) keeps low counts noise free
+    int numSamples = 64;
+};
+
+/* Mip chain of the prefiltered cube map of an equirectangular map, one float RGB cube Bitmap per mip. Mip 'l' of 'n' is
+   convolved with roughness l / n, the same mapping as the lookup in PBR.frag */
+std::vector<Bitmap> PrefilterSpecularCubemap(const glm::vec3* data, int w, int h, const SpecularPrefilterSettings& settings,
+                                             tf::Executor& executor);
+
+/* RGBA16F KTX cube map */
+bool SaveCubemapKTX(const char* fileName, const std::vector<Bitmap>& levels);
+
+/* size x size LUT sampled at (NdotV, 1 - roughness), the scale and the bias of F0 */
+std::vector<glm::vec2> GenerateBRDFLUT(int size, int numSamples, tf::Executor& executor);
+
+/* RG16F KTX texture */
+bool SaveBRDFLUTKTX(const char* fileName, const std::vector<glm::vec2>& lut, int size);
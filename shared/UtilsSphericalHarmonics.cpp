@@ -0,0 +1,129 @@
+#include "UtilsSphericalHarmonics.h"
+#include "UtilsCubemap.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <glm/ext.hpp>
+
+using glm::vec3;
+using glm::dvec3;
+
+namespace {
+    constexpr uint32_t kSHMagic = 0x12345678;
+
+    /* Real SH basis of bands 0..2 */
+    void EvaluateSHBasis(const vec3& d, float Y[9]) {
+        Y[0] = 0.282095f;
+        Y[1] = 0.488603f * d.y;
+        Y[2] = 0.488603f * d.z;
+        Y[3] = 0.488603f * d.x;
+        Y[4] = 1.092548f * d.x * d.y;
+        Y[5] = 1.092548f * d.y * d.z;
+        Y[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        Y[7] = 1.092548f * d.x * d.z;
+        Y[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    /* Convolution of the bands with the clamped cosine (PI, 2*PI/3, PI/4), divided by PI */
+    constexpr float kCosineLobe[9] = {
+            1.0f,
+            2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+            0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+    };
+}
+
+SHIrradiance ProjectEquirectangularMapToSH(const vec3* data, int w, int h, tf::Executor& executor) {
+    struct RowSum {
+        dvec3 mCoeffs[9] = {};
+    };
+    std::vector<RowSum> rows(h);
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, h, 1, [&](int y) {
+        const float v = (float(y) + 0.5f) / float(h);
+
+        // solid angle of a texel of this row
+        const double dOmega = (glm::two_pi<double>() / w) * (glm::pi<double>() / h) *
+                              cos(glm::half_pi<double>() - v * glm::pi<double>());
+
+        dvec3 sum[9] = {};
+        for (int x = 0 ; x != w ; x++) {
+            float Y[9];
+            EvaluateSHBasis(EquirectangularToDirection((float(x) + 0.5f) / float(w), v), Y);
+            const dvec3 L = dvec3(data[y * w + x]);
+            for (int i = 0 ; i != 9 ; i++)
+                sum[i] += L * double(Y[i]);
+        }
+
+        for (int i = 0 ; i != 9 ; i++)
+            rows[y].mCoeffs[i] = sum[i] * dOmega;
+    });
+    executor.run(taskflow).wait();
+
+    dvec3 total[9] = {};
+    for (const RowSum& r: rows)
+        for (int i = 0 ; i != 9 ; i++)
+            total[i] += r.mCoeffs[i];
+
+    SHIrradiance sh;
+    for (int i = 0 ; i != 9 ; i++)
+        sh.mCoeffs[i] = vec3(total[i]) * kCosineLobe[i];
+
+    return sh;
+}
+
+vec3 EvaluateSHIrradiance(const SHIrradiance& sh, const vec3& n) {
+    float Y[9];
+    EvaluateSHBasis(n, Y);
+
+    vec3 E(0.0f);
+    for (int i = 0 ; i != 9 ; i++)
+        E += sh.mCoeffs[i] * Y[i];
+
+    // ringing of the truncated SH can go below zero for very bright and small light sources
+    return glm::max(E, vec3(0.0f));
+}
+
+void RenderSHIrradiance(const SHIrradiance& sh, int w, int h, vec3* output, tf::Executor& executor) {
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, h, 1, [&](int y) {
+        const float v = (float(y) + 0.5f) / float(h);
+        for (int x = 0 ; x != w ; x++)
+            output[y * w + x] = EvaluateSHIrradiance(sh, EquirectangularToDirection((float(x) + 0.5f) / float(w), v));
+    });
+    executor.run(taskflow).wait();
+}
+
+void SaveSHIrradiance(const char* fileName, const SHIrradiance& sh) {
+    FILE* f = fopen(fileName, "wb");
+    if (!f) {
+        printf("Cannot write SH irradiance file %s\n", fileName);
+        return;
+    }
+
+    const SHFileHeader header = {
+            .magicValue = kSHMagic,
+            .coeffCount = 9
+    };
+    fwrite(&header, 1, sizeof(header), f);
+    fwrite(sh.mCoeffs, sizeof(vec3), 9, f);
+    fclose(f);
+}
+
+bool LoadSHIrradiance(const char* fileName, SHIrradiance& sh) {
+    FILE* f = fopen(fileName, "rb");
+    if (!f)
+        return false;
+
+    SHFileHeader header;
+    const bool ok = fread(&header, 1, sizeof(header), f) == sizeof(header) &&
+                    header.magicValue == kSHMagic && header.coeffCount == 9 &&
+                    fread(sh.mCoeffs, sizeof(vec3), 9, f) == 9;
+    fclose(f);
+
+    if (!ok)
+        printf("Invalid SH irradiance file %s\n", fileName);
+
+    return ok;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <taskflow/taskflow.hpp>
+
+/* L2 spherical harmonics (9 RGB coefficients) of the diffuse irradiance of an environment map.
+   Directions follow the cube map convention of ConvertEquirectangularMapToVerticalCross(), so the shaders evaluate the SH
+   with the same vector they would use to sample the irradiance cube map (see data/shaders/SHIrradiance.h) */
+struct SHIrradiance {
+    // band order: (0,0), (1,-1), (1,0), (1,1), (2,-2), (2,-1), (2,0), (2,1), (2,2). Convolved with the clamped cosine and
+    // divided by PI, in the same units as the Monte Carlo irradiance maps of FilterEnvmap
+    glm::vec3 mCoeffs[9] = {};
+};
+
+struct SHFileHeader {
+    uint32_t magicValue;
+    uint32_t coeffCount;
+};
+
+/* Project the radiance of a full resolution equirectangular map into SH, one task per row. Every texel is weighted by its
+   solid angle. The rows are reduced in order, so the result does not depend on the scheduling */
+SHIrradiance ProjectEquirectangularMapToSH(const glm::vec3* data, int w, int h, tf::Executor& executor);
+
+glm::vec3 EvaluateSHIrradiance(const SHIrradiance& sh, const glm::vec3& n);
+
+/* Reconstruct the irradiance of every texel of an equirectangular map */
+void RenderSHIrradiance(const SHIrradiance& sh, int w, int h, glm::vec3* output, tf::Executor& executor);
+
+void SaveSHIrradiance(const char* fileName, const SHIrradiance& sh);
+
+/* Returns false if the file does not exist or is not an SH irradiance file */
+bool LoadSHIrradiance(const char* fileName, SHIrradiance& sh);
@@ -1438,6 +1438,30 @@ void CopyBufferToImage(VulkanRenderDevice &vkDev, VkBuffer buffer, VkImage image
     EndSingleTimeCommands(vkDev, commandBuffer);
 }
 
+void CopyBufferToImageLevels(VulkanRenderDevice& vkDev, VkBuffer buffer, VkImage image, const std::vector<VkDeviceSize>& levelOffsets, uint32_t width, uint32_t height) {
+    auto commandBuffer = BeginSingleTimeCommands(vkDev);
+
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t level = 0 ; level != (uint32_t)levelOffsets.size() ; level++) {
+        regions.push_back(VkBufferImageCopy {
+                .bufferOffset = levelOffsets[level],
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = VkImageSubresourceLayers{
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .mipLevel = level,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                },
+                .imageOffset = VkOffset3D{.x = 0, .y = 0, .z = 0},
+                .imageExtent = VkExtent3D{.width = std::max(width >> level, 1u), .height = std::max(height >> level, 1u), .depth = 1}
+        });
+    }
+    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+
+    EndSingleTimeCommands(vkDev, commandBuffer);
+}
+
 bool CreateDepthSampler(VkDevice device, VkSampler* sampler) {
     VkSamplerCreateInfo si = {
             .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -1828,7 +1852,7 @@ bool CreateColorAndDepthFramebuffers(VulkanRenderDevice& vkDev, VkRenderPass ren
 }
 
 bool CreateTextureSampler(VkDevice device, VkSampler *sampler, VkFilter minFilter, VkFilter maxFilter,
-                          VkSamplerAddressMode addressMode) {
+                          VkSamplerAddressMode addressMode, float maxLod) {
     const VkSamplerCreateInfo samplerCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
             .pNext = nullptr,
@@ -1845,7 +1869,7 @@ bool CreateTextureSampler(VkDevice device, VkSampler *sampler, VkFilter minFilte
             .compareEnable = VK_FALSE,
             .compareOp = VK_COMPARE_OP_ALWAYS,
             .minLod = 0.0f,
-            .maxLod = 0.0f,
+            .maxLod = maxLod,
             .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
             .unnormalizedCoordinates = VK_FALSE
     };
@@ -182,7 +182,7 @@ size_t CreateSwapchainImages(VkDevice device, VkSwapchainKHR swapchain, std::vec
 
 VkResult CreateSemaphore(VkDevice device, VkSemaphore* outSemaphore);
 
-bool CreateTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter = VK_FILTER_LINEAR, VkFilter maxFilter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+bool CreateTextureSampler(VkDevice device, VkSampler* sampler, VkFilter minFilter = VK_FILTER_LINEAR, VkFilter maxFilter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT, float maxLod = 0.0f);
 
 bool CreateDescriptorPool(VulkanRenderDevice& vkDev, uint32_t uniformBufferCount, uint32_t storageBufferCount, uint32_t samplerCount, VkDescriptorPool* descriptorPool);
 
@@ -312,6 +312,9 @@ bool CreateDepthOnlyFramebuffer(VulkanRenderDevice& vkDev,
 void CopyBufferToImage(VulkanRenderDevice& vkDev, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount = 1);
 void CopyImageToBuffer(VulkanRenderDevice& vkDev, VkImage image, VkBuffer buffer, uint32_t width, uint32_t height, uint32_t layerCount = 1);
 
+/* Copy a mip chain stored in 'buffer' (levelOffsets[i] is the offset of level i), works for block-compressed formats */
+void CopyBufferToImageLevels(VulkanRenderDevice& vkDev, VkBuffer buffer, VkImage image, const std::vector<VkDeviceSize>& levelOffsets, uint32_t width, uint32_t height);
+
 void CopyMIPBufferToImage(VulkanRenderDevice& vkDev, VkBuffer buffer, VkImage image, uint32_t mipLevels, uint32_t width, uint32_t height, uint32_t bytesPP, uint32_t layerCount = 1);
 
 void DestroyVulkanImage(VkDevice device, VulkanImage& image);
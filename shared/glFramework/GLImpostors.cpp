@@ -0,0 +1,90 @@
+#include "GLImpostors.h"
+
+#include <algorithm>
+#include <string>
+
+struct ImpostorDrawCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+GLImpostors::GLImpostors(const GLSceneData& data, const char* impostorFile)
+    // a scene has at most one impostor per mesh and one card per shape
+    : mBufferImpostors(sizeof(GPUImpostor) * std::max<size_t>(data.mMeshData.mMeshes.size(), 1), nullptr, GL_DYNAMIC_STORAGE_BIT)
+    , mBufferCards(sizeof(GPUCard) * std::max<size_t>(data.mShapes.size(), 1), nullptr, GL_DYNAMIC_STORAGE_BIT)
+    , mBufferIndirect(sizeof(ImpostorDrawCommand) * std::max<size_t>(data.mShapes.size(), 1), nullptr, GL_DYNAMIC_STORAGE_BIT) {
+
+    std::vector<std::string> files;
+    if (!LoadImpostors(impostorFile, mImpostors, files))
+        return;
+
+    for (const auto& f: files)
+        mTextures.emplace_back(GL_TEXTURE_2D, f.c_str());
+
+    std::vector<GPUImpostor> impostors(std::min(mImpostors.size(), data.mMeshData.mMeshes.size()));
+    for (size_t i = 0 ; i != impostors.size() ; i++) {
+        const ImpostorDescription& d = mImpostors[i];
+        impostors[i] = {
+                .centerRadius = glm::vec4(d.mCenterRadius.x, d.mCenterRadius.y, d.mCenterRadius.z, d.mCenterRadius.w),
+                .framesPerSide = d.mFramesPerSide,
+                .frameSize = d.mFrameSize,
+                .padding0 = { 0, 0 },
+                .albedoMap = mTextures[d.mAlbedoMap].GetHandleBindless(),
+                .normalMap = mTextures[d.mNormalMap].GetHandleBindless(),
+                .depthMap = mTextures[d.mDepthMap].GetHandleBindless(),
+                .padding1 = 0
+        };
+    }
+    glNamedBufferSubData(mBufferImpostors.GetHandle(), 0, sizeof(GPUImpostor) * impostors.size(), impostors.data());
+
+    UpdateDrawCommands(data);
+}
+
+void GLImpostors::UpdateDrawCommands(const GLSceneData& data) {
+    if (mImpostors.empty())
+        return;
+
+    std::vector<GPUCard> cards;
+    std::vector<ImpostorDrawCommand> commands;
+
+    for (const DrawData& d: data.mShapes) {
+        const Mesh& mesh = data.mMeshData.mMeshes[d.meshIndex];
+        if (!IsImpostorLOD(mesh, d.LOD) || mesh.impostorIndex >= mImpostors.size())
+            continue;
+
+        // the card index goes to gl_BaseInstance
+        commands.push_back({
+                .count = mesh.GetLODIndicesCount(d.LOD),
+                .instanceCount = 1,
+                .firstIndex = d.indexOffset,
+                .baseVertex = d.vertexOffset,
+                .baseInstance = (GLuint)cards.size()
+        });
+        cards.push_back({
+                .model = data.mDrawTransforms[d.transformIndex],
+                .impostor = mesh.impostorIndex,
+                .padding = { 0, 0, 0 }
+        });
+    }
+
+    mNumCards = (GLsizei)cards.size();
+    if (!mNumCards)
+        return;
+
+    glNamedBufferSubData(mBufferCards.GetHandle(), 0, sizeof(GPUCard) * cards.size(), cards.data());
+    glNamedBufferSubData(mBufferIndirect.GetHandle(), 0, sizeof(ImpostorDrawCommand) * commands.size(), commands.data());
+}
+
+void GLImpostors::Draw(GLuint vao) const {
+    if (!mNumCards)
+        return;
+
+    glBindVertexArray(vao);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBufferIndex_Impostors, mBufferImpostors.GetHandle());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBufferIndex_ImpostorCards, mBufferCards.GetHandle());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mBufferIndirect.GetHandle());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, mNumCards, 0);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <vector>
+
+#include "shared/glFramework/GLShader.h"
+#include "shared/glFramework/GLTexture.h"
+#include "shared/glFramework/GLSceneData.h"
+#include "shared/scene/Impostor.h"
+
+const GLuint kBufferIndex_Impostors = 3;
+const GLuint kBufferIndex_ImpostorCards = 4;
+
+/* Card renderer of octahedral impostors (see shared/scene/Impostor.h). Draws the shapes whose current LOD is the impostor LOD
+   of their mesh with data/shaders/impostor.vert/.frag, the regular mesh pass has to skip them (see IsImpostorLOD()) */
+class GLImpostors final {
+public:
+    /* A missing impostor file means the scene has no impostors */
+    GLImpostors(const GLSceneData& data, const char* impostorFile);
+
+    GLImpostors(const GLImpostors&) = delete;
+    GLImpostors(GLImpostors&&) = delete;
+
+    /* Rebuild the card list, called again whenever the LODs of data.mShapes change */
+    void UpdateDrawCommands(const GLSceneData& data);
+
+    /* 'vao' is the vertex array of the scene meshes, the cards use their impostor LOD quads */
+    void Draw(GLuint vao) const;
+
+    [[nodiscard]] bool IsEmpty() const { return mImpostors.empty(); }
+
+private:
+    // std430 layouts of impostor.vert/.frag
+    struct GPUImpostor {
+        glm::vec4 centerRadius;
+        uint32_t framesPerSide;
+        uint32_t frameSize;
+        uint32_t padding0[2];
+        GLuint64 albedoMap;
+        GLuint64 normalMap;
+        GLuint64 depthMap;
+        GLuint64 padding1;
+    };
+
+    struct GPUCard {
+        glm::mat4 model;
+        uint32_t impostor;
+        uint32_t padding[3];
+    };
+
+    std::vector<ImpostorDescription> mImpostors;
+    std::vector<GLTexture> mTextures;
+
+    GLsizei mNumCards = 0;
+
+    GLBuffer mBufferImpostors;
+    GLBuffer mBufferCards;
+    GLBuffer mBufferIndirect;
+};
@@ -4,6 +4,7 @@
 
 #include "shared/glFramework/GLShader.h"
 #include "shared/scene/Material.h"
+#include "shared/scene/VtxData.h"
 
 #include <vector>
 #include <functional>
@@ -34,6 +35,18 @@ public:
     }
 
 
+    /* Rewrite the index ranges of the draw commands after the LODs of the shapes have changed (see LODSelector). Command i draws shapes[i].
+       Impostor LODs are skipped, they are drawn by GLImpostors */
+    void UpdateLODs(const std::vector<DrawData>& shapes, const MeshData& meshData) {
+        for (size_t i = 0 ; i != shapes.size() && i != mDrawCommands.size() ; i++) {
+            const DrawData& d = shapes[i];
+            mDrawCommands[i].count = meshData.mMeshes[d.meshIndex].GetLODIndicesCount(d.LOD);
+            mDrawCommands[i].instanceCount = IsImpostorLOD(meshData.mMeshes[d.meshIndex], d.LOD) ? 0 : 1;
+            mDrawCommands[i].firstIndex = d.indexOffset;
+        }
+        UploadIndirectBuffer();
+    }
+
     void SelectTo(GLIndirectBuffer& buffer, const std::function<bool(const DrawElementsIndirectCommand)>& pred) {
         buffer.mDrawCommands.clear();
         for(const auto& c : mDrawCommands) {
@@ -54,14 +67,14 @@ public:
     explicit GLMesh(const GLSceneDataType& data)
         : mNumIndices(data.mHeader.indexDataSize / sizeof(uint32_t))
         , mBufferIndices(data.mHeader.indexDataSize, data.mMeshData.mIndexData.data(), 0)
-        , mBufferVertices(data.mHeader.vertexDataSize, data.mMeshData.mVertexData().data(), 0)
+        , mBufferVertices(data.mHeader.vertexDataSize, data.mMeshData.mVertexData.data(), 0)
         , mBufferMaterials(sizeof(MaterialDescription) * data.mMaterials.size(), data.mMaterials.data(), GL_DYNAMIC_STORAGE_BIT)
         , mBufferModelMatrices(sizeof(glm::mat4) * data.mShapes.size(), nullptr, GL_DYNAMIC_STORAGE_BIT)
         , mBufferIndirect(data.mShapes.size()) {
 
         glCreateVertexArrays(1, &mVao);
         glVertexArrayElementBuffer(mVao, mBufferIndices.GetHandle());
-        glVertexArrayVertexBuffer(mVao, 0, mBufferIndices.GetHandle(), 0, sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2));
+        glVertexArrayVertexBuffer(mVao, 0, mBufferVertices.GetHandle(), 0, sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2));
         // position
         glEnableVertexArrayAttrib(mVao, 0);
         glVertexArrayAttribFormat(mVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
@@ -78,18 +91,18 @@ public:
         std::vector<glm::mat4> matrices(data.mShapes.size());
 
         // prepare indirect commands buffer
-        for (size_t i = 0; i != data.shapes_.size(); i++)
+        for (size_t i = 0; i != data.mShapes.size(); i++)
         {
-            const uint32_t meshIdx = data.shapes_[i].meshIndex;
-            const uint32_t lod = data.shapes_[i].LOD;
+            const uint32_t meshIdx = data.mShapes[i].meshIndex;
+            const uint32_t lod = data.mShapes[i].LOD;
             mBufferIndirect.mDrawCommands[i] = {
-                    .count = data.mMeshData.meshes_[meshIdx].GetLODIndicesCount(lod),
-                    .instanceCount = 1,
+                    .count = data.mMeshData.mMeshes[meshIdx].GetLODIndicesCount(lod),
+                    .instanceCount = IsImpostorLOD(data.mMeshData.mMeshes[meshIdx], lod) ? 0u : 1u,
                     .firstIndex = data.mShapes[i].indexOffset,
                     .baseVertex = data.mShapes[i].vertexOffset,
                     .baseInstance = data.mShapes[i].materialIndex + (uint32_t(i) << 16)
             };
-            matrices[i] = data.mScene.mGlobalTransform[data.mShapes[i].transformIndex];
+            matrices[i] = data.mDrawTransforms[data.mShapes[i].transformIndex];
         }
         mBufferIndirect.UploadIndirectBuffer();
 
@@ -100,6 +113,11 @@ public:
         glNamedBufferSubData(mBufferMaterials.GetHandle(), 0, sizeof(MaterialDescription) * data.mMaterials.size(), data.mMaterials.data());
     }
 
+    /* Rewrite the default indirect buffer after the LODs of data.mShapes were changed */
+    void UpdateLODs(const GLSceneDataType& data) {
+        mBufferIndirect.UpdateLODs(data.mShapes, data.mMeshData);
+    }
+
     void Draw(size_t numDrawCommands, const GLIndirectBuffer* buffer = nullptr) const {
         glBindVertexArray(mVao);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBufferIndex_Materials, mBufferMaterials.GetHandle());
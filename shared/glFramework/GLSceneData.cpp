@@ -1,5 +1,7 @@
 #include "GLSceneData.h"
 
+#include "shared/scene/DrawList.h"
+
 static uint64_t GetTextureHandleBindless(uint64_t idx, const std::vector<GLTexture>& textures) {
     if(idx == INVALID_TEXTURE) return 0;
 
@@ -13,8 +15,9 @@ GLSceneData::GLSceneData(const char *meshFile, const char *sceneFile, const char
     std::vector<std::string> mTextureFiles;
     LoadMaterials(materialFile, mMaterials, mTextureFiles);
 
+    // material textures are always sampled as arrays, small textures share arrays (see MaterialDescription layers)
     for(const auto& f : mTextureFiles) {
-        mAllMaterialTextures.emplace_back(GL_TEXTURE_2D, f.c_str());
+        mAllMaterialTextures.emplace_back(GL_TEXTURE_2D_ARRAY, f.c_str());
     }
 
     for(auto& mtl : mMaterials) {
@@ -29,24 +32,12 @@ GLSceneData::GLSceneData(const char *meshFile, const char *sceneFile, const char
 void GLSceneData::LoadScene(const char *sceneFile) {
     ::LoadScene(sceneFile, mScene);
 
-    // prepare draw data buffer
-    for(const auto& c : mScene.mMeshes) {
-        auto material = mScene.mMaterialForNode.find(c.first);
-        if(material != mScene.mMaterialForNode.end()) {
-            mShapes.push_back(
-                DrawData {
-                    .meshIndex = c.second,
-                    .materialIndex = material->second,
-                    .LOD = 0,
-                    .indexOffset = mMeshData.mMeshes[c.second].indexOffset,
-                    .vertexOffset = mMeshData.mMeshes[c.second].vertexOffset,
-                    .transformIndex = c.first
-                }
-            );
-        }
-    }
+    // prepare draw data buffer (prototype instances are expanded here)
+    BuildDrawList(mScene, mMeshData, mShapes);
 
     // recalculate all global transformation
     MarkAsChanged(mScene, 0);
     RecalculateGlobalTransforms(mScene);
+
+    BuildDrawTransforms(mScene, mDrawTransforms);
 }
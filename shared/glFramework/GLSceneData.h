@@ -22,6 +22,9 @@ public:
     std::vector<MaterialDescription> mMaterials;
     std::vector<DrawData> mShapes;
 
+    // indexed by DrawData::transformIndex
+    std::vector<glm::mat4> mDrawTransforms;
+
     void LoadScene(const char* sceneFile);
 };
 
@@ -61,6 +61,7 @@ GLTexture::GLTexture(GLenum type, const char *fileName)
             int w = 0;
             int h = 0;
             int numMipmaps = 0;
+            bool generateMipmaps = true;
             if(isKTX) {
                 gli::texture gliTex = gli::load_ktx(fileName);
                 gli::gl GL(gli::gl::PROFILE_KTX);
@@ -68,9 +69,21 @@ GLTexture::GLTexture(GLenum type, const char *fileName)
                 glm::tvec3<GLsizei> extent(gliTex.extent(0));
                 w = extent.x;
                 h = extent.y;
-                numMipmaps = GetNumMipMapLevels2D(w, h);
+
+                // use the mip chain stored in the file, compressed textures cannot be mipmapped by the driver
+                const bool isCompressed = gli::is_compressed(gliTex.format());
+                const auto numLevels = (int)gliTex.levels();
+                generateMipmaps = numLevels == 1 && !isCompressed;
+                numMipmaps = generateMipmaps ? GetNumMipMapLevels2D(w, h) : numLevels;
+
                 glTextureStorage2D(mHandle, numMipmaps, format.Internal, w, h);
-                glTextureSubImage2D(mHandle, 0, 0, 0, w, h, format.External, format.Type, gliTex.data(0, 0, 0));
+                for (int level = 0 ; level != numLevels ; level++) {
+                    const glm::tvec3<GLsizei> levelExtent(gliTex.extent(level));
+                    if (isCompressed)
+                        glCompressedTextureSubImage2D(mHandle, level, 0, 0, levelExtent.x, levelExtent.y, format.Internal, (GLsizei)gliTex.size(level), gliTex.data(0, 0, level));
+                    else
+                        glTextureSubImage2D(mHandle, level, 0, 0, levelExtent.x, levelExtent.y, format.External, format.Type, gliTex.data(0, 0, level));
+                }
             }else {
                 uint8_t* img = stbi_load(fileName, &w, &h, nullptr, STBI_rgb_alpha);
 
@@ -91,13 +104,101 @@ GLTexture::GLTexture(GLenum type, const char *fileName)
                 glTextureSubImage2D(mHandle, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, img);
                 stbi_image_free((void*)img);
             }
-            glGenerateTextureMipmap(mHandle);
+            if (generateMipmaps)
+                glGenerateTextureMipmap(mHandle);
+            glTextureParameteri(mHandle, GL_TEXTURE_MAX_LEVEL, numMipmaps-1);
+            glTextureParameteri(mHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTextureParameteri(mHandle, GL_TEXTURE_MAX_ANISOTROPY , 16);
+            break;
+        }
+        case GL_TEXTURE_2D_ARRAY: {
+            // KTX files may hold several layers, any other image (or a 2D KTX file) becomes a single-layer array
+            int w = 0;
+            int h = 0;
+            int numMipmaps = 0;
+            bool generateMipmaps = true;
+            if(isKTX) {
+                gli::texture gliTex = gli::load_ktx(fileName);
+                gli::gl GL(gli::gl::PROFILE_KTX);
+                gli::gl::format const format = GL.translate(gliTex.format(), gliTex.swizzles());
+                glm::tvec3<GLsizei> extent(gliTex.extent(0));
+                w = extent.x;
+                h = extent.y;
+
+                const bool isCompressed = gli::is_compressed(gliTex.format());
+                const auto numLevels = (int)gliTex.levels();
+                const auto numLayers = (int)gliTex.layers();
+                generateMipmaps = numLevels == 1 && !isCompressed;
+                numMipmaps = generateMipmaps ? GetNumMipMapLevels2D(w, h) : numLevels;
+
+                glTextureStorage3D(mHandle, numMipmaps, format.Internal, w, h, numLayers);
+                for (int layer = 0 ; layer != numLayers ; layer++)
+                    for (int level = 0 ; level != numLevels ; level++) {
+                        const glm::tvec3<GLsizei> levelExtent(gliTex.extent(level));
+                        if (isCompressed)
+                            glCompressedTextureSubImage3D(mHandle, level, 0, 0, layer, levelExtent.x, levelExtent.y, 1, format.Internal, (GLsizei)gliTex.size(level), gliTex.data(layer, 0, level));
+                        else
+                            glTextureSubImage3D(mHandle, level, 0, 0, layer, levelExtent.x, levelExtent.y, 1, format.External, format.Type, gliTex.data(layer, 0, level));
+                    }
+            }else {
+                uint8_t* img = stbi_load(fileName, &w, &h, nullptr, STBI_rgb_alpha);
+                GLenum imgFormat = GL_RGBA;
+
+                if (!img)
+                {
+                    fprintf(stderr, "WARNING: could not load image `%s`, using a fallback.\n", fileName);
+                    img = GenDefaultCheckerboardImage(&w, &h);
+                    imgFormat = GL_RGB;
+                    if (!img)
+                    {
+                        fprintf(stderr, "FATAL ERROR: out of memory allocating image for fallback texture\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+
+                numMipmaps = GetNumMipMapLevels2D(w, h);
+                glTextureStorage3D(mHandle, numMipmaps, GL_RGBA8, w, h, 1);
+                glTextureSubImage3D(mHandle, 0, 0, 0, 0, w, h, 1, imgFormat, GL_UNSIGNED_BYTE, img);
+                stbi_image_free((void*)img);
+            }
+            if (generateMipmaps)
+                glGenerateTextureMipmap(mHandle);
             glTextureParameteri(mHandle, GL_TEXTURE_MAX_LEVEL, numMipmaps-1);
             glTextureParameteri(mHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             glTextureParameteri(mHandle, GL_TEXTURE_MAX_ANISOTROPY , 16);
             break;
         }
         case GL_TEXTURE_CUBE_MAP: {
+            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(mHandle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+            if (isKTX) {
+                // prefiltered cube maps keep their own mip chain (see FilterEnvmap), one roughness per mip
+                gli::texture gliTex = gli::load_ktx(fileName);
+                if (gliTex.empty() || gliTex.target() != gli::TARGET_CUBE) {
+                    fprintf(stderr, "FATAL ERROR: `%s` is not a KTX cube map\n", fileName);
+                    exit(EXIT_FAILURE);
+                }
+                gli::gl GL(gli::gl::PROFILE_KTX);
+                gli::gl::format const format = GL.translate(gliTex.format(), gliTex.swizzles());
+                const glm::tvec3<GLsizei> extent(gliTex.extent(0));
+                const auto numLevels = (int)gliTex.levels();
+
+                glTextureStorage2D(mHandle, numLevels, format.Internal, extent.x, extent.y);
+                for (int level = 0 ; level != numLevels ; level++) {
+                    const glm::tvec3<GLsizei> levelExtent(gliTex.extent(level));
+                    for (int face = 0 ; face != 6 ; face++)
+                        glTextureSubImage3D(mHandle, level, 0, 0, face, levelExtent.x, levelExtent.y, 1, format.External, format.Type, gliTex.data(0, face, level));
+                }
+                glTextureParameteri(mHandle, GL_TEXTURE_BASE_LEVEL, 0);
+                glTextureParameteri(mHandle, GL_TEXTURE_MAX_LEVEL, numLevels-1);
+                glTextureParameteri(mHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                break;
+            }
+
             int w, h, comp;
             const float* img = stbi_loadf(fileName, &w, &h, &comp, 3);
             assert(img);
@@ -109,14 +210,9 @@ GLTexture::GLTexture(GLenum type, const char *fileName)
 
             const int numMipmaps = GetNumMipMapLevels2D(cubemap.mW, cubemap.mH);
 
-            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTextureParameteri(mHandle, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
             glTextureParameteri(mHandle, GL_TEXTURE_BASE_LEVEL, 0);
             glTextureParameteri(mHandle, GL_TEXTURE_MAX_LEVEL, numMipmaps-1);
             glTextureParameteri(mHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTextureParameteri(mHandle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
             glTextureStorage2D(mHandle, numMipmaps, GL_RGB32F, cubemap.mW, cubemap.mH);
             const uint8_t* data = cubemap.mData.data();
 
@@ -0,0 +1,363 @@
+#include "Collision.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#include <btBulletCollisionCommon.h>
+#include <LinearMath/btConvexHullComputer.h>
+
+namespace {
+    constexpr uint32_t kCollisionMagic = 0x12345678;
+
+    // serialized BVHs must start at this alignment (see btQuantizedBvh::deSerializeInPlace())
+    constexpr size_t kBvhAlignment = 16;
+
+    // quantized BVH nodes store 21-bit triangle indices, larger meshes use the uncompressed nodes
+    bool UseQuantizedBvh(uint32_t numTriangles) { return numTriangles < (1u << 21); }
+
+    // geometry of one proxy before the proxies are packed into CollisionData
+    struct ProxyGeometry {
+        CollisionProxy mProxy;
+        std::vector<float> mVertices;
+        std::vector<uint32_t> mIndices;
+        std::vector<uint8_t> mBvh;
+    };
+
+    uint32_t SelectCollisionLOD(const Mesh& mesh, float maxError) {
+        const uint32_t numLODs = (mesh.impostorIndex != kNoImpostor) ? mesh.lodCount - 1 : mesh.lodCount;
+
+        uint32_t lod = 0;
+        while (lod + 1 < numLODs && mesh.lodError[lod + 1] <= maxError)
+            lod++;
+        return lod;
+    }
+
+    // positions of the triangles of one LOD, vertices with the same position are welded (uv seams and hard normals split them)
+    void ExtractTriangles(const MeshData& meshData, const Mesh& mesh, uint32_t lod, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+        const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+        const float* src = meshData.mVertexData.data() + mesh.streamOffset[0] / sizeof(float);
+        const uint32_t* srcIndices = meshData.mIndexData.data() + mesh.indexOffset + mesh.lodOffset[lod];
+
+        std::map<std::tuple<float, float, float>, uint32_t> welded;
+
+        for (uint32_t i = 0 ; i != mesh.GetLODIndicesCount(lod) ; i++) {
+            const float* v = src + (size_t)srcIndices[i] * stride;
+            const auto [it, inserted] = welded.try_emplace({ v[0], v[1], v[2] }, (uint32_t)(vertices.size() / 3));
+            if (inserted)
+                vertices.insert(vertices.end(), v, v + 3);
+            indices.push_back(it->second);
+        }
+
+        // welding may collapse triangles
+        size_t numIndices = 0;
+        for (size_t t = 0 ; t + 2 < indices.size() ; t += 3) {
+            const uint32_t a = indices[t + 0], b = indices[t + 1], c = indices[t + 2];
+            if (a == b || b == c || c == a)
+                continue;
+            indices[numIndices++] = a;
+            indices[numIndices++] = b;
+            indices[numIndices++] = c;
+        }
+        indices.resize(numIndices);
+    }
+
+    void MakeBox(const glm::vec3& boxMin, const glm::vec3& boxMax, ProxyGeometry& g) {
+        const glm::vec3 center = 0.5f * (boxMin + boxMax);
+        const glm::vec3 halfExtents = 0.5f * (boxMax - boxMin);
+
+        g.mProxy.mType = eCollisionShape::Box;
+        g.mProxy.mCenter = gpuvec4(center.x, center.y, center.z, 0.0f);
+        g.mProxy.mHalfExtents = gpuvec4(halfExtents.x, halfExtents.y, halfExtents.z, 0.0f);
+        g.mVertices.clear();
+        g.mIndices.clear();
+    }
+
+    void BuildProxy(const MeshData& meshData, uint32_t meshIndex, const CollisionSettings& settings, ProxyGeometry& g) {
+        const Mesh& mesh = meshData.mMeshes[meshIndex];
+        if (IsSkinnedMesh(mesh) || mesh.lodCount == 0)
+            return;
+
+        const uint32_t lod = SelectCollisionLOD(mesh, settings.maxError);
+        ExtractTriangles(meshData, mesh, lod, g.mVertices, g.mIndices);
+        if (g.mIndices.empty())
+            return;
+
+        glm::vec3 boxMin(std::numeric_limits<float>::max());
+        glm::vec3 boxMax(std::numeric_limits<float>::lowest());
+        for (size_t i = 0 ; i + 2 < g.mVertices.size() ; i += 3) {
+            boxMin = glm::min(boxMin, glm::vec3(g.mVertices[i], g.mVertices[i + 1], g.mVertices[i + 2]));
+            boxMax = glm::max(boxMax, glm::vec3(g.mVertices[i], g.mVertices[i + 1], g.mVertices[i + 2]));
+        }
+
+        const float radius = 0.5f * glm::length(boxMax - boxMin);
+
+        if (radius < settings.boxRadius) {
+            MakeBox(boxMin, boxMax, g);
+            return;
+        }
+
+        if (radius < settings.hullRadius) {
+            btConvexHullComputer hull;
+            hull.compute(g.mVertices.data(), 3 * sizeof(float), (int)(g.mVertices.size() / 3), 0.0f, 0.0f);
+
+            // flat meshes have no volume
+            if (hull.vertices.size() < 4) {
+                MakeBox(boxMin, boxMax, g);
+                return;
+            }
+
+            g.mProxy.mType = eCollisionShape::ConvexHull;
+            g.mVertices.clear();
+            g.mIndices.clear();
+            for (int i = 0 ; i != hull.vertices.size() ; i++)
+                g.mVertices.insert(g.mVertices.end(), { hull.vertices[i].x(), hull.vertices[i].y(), hull.vertices[i].z() });
+            g.mProxy.mVertexCount = (uint32_t)(g.mVertices.size() / 3);
+            return;
+        }
+
+        g.mProxy.mType = eCollisionShape::TriangleMesh;
+        g.mProxy.mVertexCount = (uint32_t)(g.mVertices.size() / 3);
+        g.mProxy.mIndexCount = (uint32_t)g.mIndices.size();
+
+        btTriangleIndexVertexArray meshInterface((int)(g.mIndices.size() / 3), (int*)g.mIndices.data(), 3 * sizeof(uint32_t),
+                                                 (int)(g.mVertices.size() / 3), g.mVertices.data(), 3 * sizeof(float));
+        btBvhTriangleMeshShape shape(&meshInterface, UseQuantizedBvh(g.mProxy.mIndexCount / 3), true);
+
+        const btOptimizedBvh* bvh = shape.getOptimizedBvh();
+        const unsigned size = bvh->calculateSerializeBufferSize();
+
+        void* buffer = btAlignedAlloc(size, kBvhAlignment);
+        if (bvh->serializeInPlace(buffer, size, false)) {
+            g.mBvh.resize(size);
+            memcpy(g.mBvh.data(), buffer, size);
+        }
+        btAlignedFree(buffer);
+    }
+
+    btTransform ToBulletTransform(const glm::mat3& rotation, const glm::vec3& origin) {
+        // btMatrix3x3 takes rows, glm matrices are column-major
+        const btMatrix3x3 basis(rotation[0][0], rotation[1][0], rotation[2][0],
+                                rotation[0][1], rotation[1][1], rotation[2][1],
+                                rotation[0][2], rotation[1][2], rotation[2][2]);
+        return btTransform(basis, btVector3(origin.x, origin.y, origin.z));
+    }
+}
+
+uint32_t GetCollisionBvhLayout() {
+    return (uint32_t)sizeof(btOptimizedBvh) | (uint32_t)sizeof(btScalar) << 16 | (uint32_t)sizeof(void*) << 24;
+}
+
+void BuildCollisionProxies(const MeshData& meshData, const CollisionSettings& settings, CollisionData& out, tf::Executor& executor) {
+    std::vector<ProxyGeometry> proxies(meshData.mMeshes.size());
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, (int)proxies.size(), 1, [&](int i) {
+        BuildProxy(meshData, (uint32_t)i, settings, proxies[i]);
+    });
+    executor.run(taskflow).wait();
+
+    out = CollisionData();
+    out.mBvhLayout = GetCollisionBvhLayout();
+    out.mProxies.reserve(proxies.size());
+
+    for (ProxyGeometry& g: proxies) {
+        CollisionProxy& p = out.mProxies.emplace_back(g.mProxy);
+        if (p.mType != eCollisionShape::ConvexHull && p.mType != eCollisionShape::TriangleMesh)
+            continue;
+
+        p.mVertexOffset = (uint32_t)(out.mVertexData.size() / 3);
+        p.mIndexOffset = (uint32_t)out.mIndexData.size();
+        out.mVertexData.insert(out.mVertexData.end(), g.mVertices.begin(), g.mVertices.end());
+        out.mIndexData.insert(out.mIndexData.end(), g.mIndices.begin(), g.mIndices.end());
+
+        if (!g.mBvh.empty()) {
+            out.mBvhData.resize((out.mBvhData.size() + kBvhAlignment - 1) / kBvhAlignment * kBvhAlignment);
+            p.mBvhOffset = (uint32_t)out.mBvhData.size();
+            p.mBvhSize = (uint32_t)g.mBvh.size();
+            out.mBvhData.insert(out.mBvhData.end(), g.mBvh.begin(), g.mBvh.end());
+        }
+    }
+}
+
+void SaveCollisionData(const char* fileName, const CollisionData& data) {
+    FILE* f = fopen(fileName, "wb");
+    if (!f)
+        return;
+
+    const CollisionFileHeader header = {
+            .magicValue = kCollisionMagic,
+            .proxyCount = (uint32_t)data.mProxies.size(),
+            .vertexDataSize = (uint32_t)(data.mVertexData.size() * sizeof(float)),
+            .indexDataSize = (uint32_t)(data.mIndexData.size() * sizeof(uint32_t)),
+            .bvhDataSize = (uint32_t)data.mBvhData.size(),
+            .bvhLayout = data.mBvhLayout
+    };
+
+    fwrite(&header, 1, sizeof(header), f);
+    fwrite(data.mProxies.data(), sizeof(CollisionProxy), header.proxyCount, f);
+    fwrite(data.mVertexData.data(), 1, header.vertexDataSize, f);
+    fwrite(data.mIndexData.data(), 1, header.indexDataSize, f);
+    fwrite(data.mBvhData.data(), 1, header.bvhDataSize, f);
+    fclose(f);
+}
+
+bool LoadCollisionData(const char* fileName, CollisionData& data) {
+    data = CollisionData();
+
+    FILE* f = fopen(fileName, "rb");
+    if (!f)
+        return false;
+
+    CollisionFileHeader header = {};
+    if (fread(&header, 1, sizeof(header), f) != sizeof(header) || header.magicValue != kCollisionMagic) {
+        printf("Invalid collision file %s\n", fileName);
+        fclose(f);
+        return false;
+    }
+
+    data.mProxies.resize(header.proxyCount);
+    data.mVertexData.resize(header.vertexDataSize / sizeof(float));
+    data.mIndexData.resize(header.indexDataSize / sizeof(uint32_t));
+    data.mBvhData.resize(header.bvhDataSize);
+    data.mBvhLayout = header.bvhLayout;
+
+    if (fread(data.mProxies.data(), sizeof(CollisionProxy), header.proxyCount, f) != header.proxyCount ||
+        fread(data.mVertexData.data(), 1, header.vertexDataSize, f) != header.vertexDataSize ||
+        fread(data.mIndexData.data(), 1, header.indexDataSize, f) != header.indexDataSize ||
+        fread(data.mBvhData.data(), 1, header.bvhDataSize, f) != header.bvhDataSize) {
+        printf("Unable to read collision data from %s\n", fileName);
+        data = CollisionData();
+        fclose(f);
+        return false;
+    }
+
+    fclose(f);
+    return true;
+}
+
+CollisionShapes::CollisionShapes(CollisionData data)
+    : mData(std::move(data)) {
+    if (!mData.mBvhData.empty()) {
+        mBvhBuffer = (uint8_t*)btAlignedAlloc(mData.mBvhData.size(), kBvhAlignment);
+        memcpy(mBvhBuffer, mData.mBvhData.data(), mData.mBvhData.size());
+    }
+
+    const bool bvhValid = mData.mBvhLayout == GetCollisionBvhLayout();
+
+    mShapes.resize(mData.mProxies.size());
+
+    for (size_t i = 0 ; i != mData.mProxies.size() ; i++) {
+        const CollisionProxy& p = mData.mProxies[i];
+        float* vertices = mData.mVertexData.data() + (size_t)p.mVertexOffset * 3;
+
+        switch (p.mType) {
+            case eCollisionShape::Box:
+                mShapes[i] = std::make_unique<btBoxShape>(btVector3(p.mHalfExtents.x, p.mHalfExtents.y, p.mHalfExtents.z));
+                break;
+            case eCollisionShape::ConvexHull:
+                mShapes[i] = std::make_unique<btConvexHullShape>(vertices, (int)p.mVertexCount, (int)(3 * sizeof(float)));
+                break;
+            case eCollisionShape::TriangleMesh: {
+                auto& meshInterface = mMeshInterfaces.emplace_back(std::make_unique<btTriangleIndexVertexArray>(
+                        (int)(p.mIndexCount / 3), (int*)(mData.mIndexData.data() + p.mIndexOffset), (int)(3 * sizeof(uint32_t)),
+                        (int)p.mVertexCount, vertices, (int)(3 * sizeof(float))));
+
+                // BVHs from another platform or Bullet version are rebuilt
+                btOptimizedBvh* bvh = (bvhValid && p.mBvhSize) ? btOptimizedBvh::deSerializeInPlace(mBvhBuffer + p.mBvhOffset, p.mBvhSize, false) : nullptr;
+
+                auto shape = std::make_unique<btBvhTriangleMeshShape>(meshInterface.get(), UseQuantizedBvh(p.mIndexCount / 3), bvh == nullptr);
+                if (bvh)
+                    shape->setOptimizedBvh(bvh);
+                else
+                    mNumRebuiltBvhs++;
+                mShapes[i] = std::move(shape);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+CollisionShapes::~CollisionShapes() {
+    if (mWorld)
+        for (const auto& o: mObjects)
+            mWorld->removeCollisionObject(o.get());
+
+    // the shapes reference the mesh interfaces and the BVH buffer
+    mObjects.clear();
+    mScaledShapes.clear();
+    mShapes.clear();
+    mMeshInterfaces.clear();
+
+    btAlignedFree(mBvhBuffer);
+}
+
+btCollisionShape* CollisionShapes::GetShape(uint32_t meshIndex) const {
+    return (meshIndex < mShapes.size()) ? mShapes[meshIndex].get() : nullptr;
+}
+
+uint32_t CollisionShapes::AddToWorld(btCollisionWorld& world, const std::vector<DrawData>& draws, const std::vector<glm::mat4>& transforms) {
+    mWorld = &world;
+
+    uint32_t numAdded = 0;
+
+    for (size_t i = 0 ; i != draws.size() ; i++) {
+        const DrawData& d = draws[i];
+        btCollisionShape* shape = GetShape(d.meshIndex);
+        if (!shape)
+            continue;
+
+        const CollisionProxy& p = mData.mProxies[d.meshIndex];
+        const glm::mat4& t = transforms[d.transformIndex];
+
+        // Bullet transforms are rigid, the scale goes to the shape
+        const glm::vec3 scale(glm::length(glm::vec3(t[0])), glm::length(glm::vec3(t[1])), glm::length(glm::vec3(t[2])));
+        if (scale.x <= 0.0f || scale.y <= 0.0f || scale.z <= 0.0f)
+            continue;
+
+        const glm::mat3 rotation(glm::vec3(t[0]) / scale.x, glm::vec3(t[1]) / scale.y, glm::vec3(t[2]) / scale.z);
+
+        // boxes are centered at the origin of their shape
+        glm::vec3 origin(t[3]);
+        if (p.mType == eCollisionShape::Box)
+            origin += glm::mat3(t) * glm::vec3(p.mCenter.x, p.mCenter.y, p.mCenter.z);
+
+        if (glm::any(glm::greaterThan(glm::abs(scale - glm::vec3(1.0f)), glm::vec3(1e-4f)))) {
+            const btVector3 s(scale.x, scale.y, scale.z);
+            switch (p.mType) {
+                case eCollisionShape::Box:
+                    mScaledShapes.push_back(std::make_unique<btBoxShape>(btVector3(p.mHalfExtents.x, p.mHalfExtents.y, p.mHalfExtents.z) * s));
+                    break;
+                case eCollisionShape::ConvexHull: {
+                    auto hull = std::make_unique<btConvexHullShape>(mData.mVertexData.data() + (size_t)p.mVertexOffset * 3, (int)p.mVertexCount, (int)(3 * sizeof(float)));
+                    hull->setLocalScaling(s);
+                    mScaledShapes.push_back(std::move(hull));
+                    break;
+                }
+                default:
+                    mScaledShapes.push_back(std::make_unique<btScaledBvhTriangleMeshShape>(static_cast<btBvhTriangleMeshShape*>(shape), s));
+                    break;
+            }
+            shape = mScaledShapes.back().get();
+        }
+
+        auto object = std::make_unique<btCollisionObject>();
+        object->setCollisionShape(shape);
+        object->setWorldTransform(ToBulletTransform(rotation, origin));
+        object->setCollisionFlags(object->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+
+        // queries report the draw they hit
+        object->setUserIndex((int)i);
+
+        world.addCollisionObject(object.get(), btBroadphaseProxy::StaticFilter, btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+        mObjects.push_back(std::move(object));
+        numAdded++;
+    }
+
+    return numAdded;
+}
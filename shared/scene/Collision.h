@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <taskflow/taskflow.hpp>
+
+#include "shared/scene/vec4.h"
+#include "shared/scene/VtxData.h"
+
+class btCollisionShape;
+class btCollisionObject;
+class btCollisionWorld;
+class btTriangleIndexVertexArray;
+
+/* Simplified collision geometry of the meshes of a scene, built by SceneConverter and loaded by the applications into Bullet.
+   Small props become boxes, medium ones convex hulls and everything else a triangle mesh made of a coarse LOD. The quantized BVHs
+   of triangle meshes are built offline and stored in Bullet's in-place serialized form, so loading them is a single copy */
+enum class eCollisionShape : uint32_t {
+    None = 0,       // no collision (skinned meshes)
+    Box,
+    ConvexHull,
+    TriangleMesh,
+};
+
+struct PACKED_STRUCT CollisionProxy final {
+    eCollisionShape mType = eCollisionShape::None;
+
+    // ConvexHull: hull points, TriangleMesh: vertices and triangles. Vertices are vec3 in CollisionData::mVertexData
+    uint32_t mVertexOffset = 0;
+    uint32_t mVertexCount = 0;
+    uint32_t mIndexOffset = 0;
+    uint32_t mIndexCount = 0;
+
+    // TriangleMesh: serialized btOptimizedBvh in CollisionData::mBvhData (bytes, 16-byte aligned)
+    uint32_t mBvhOffset = 0;
+    uint32_t mBvhSize = 0;
+
+    uint32_t mPadding = 0;
+
+    // Box: mesh space center and half extents
+    gpuvec4 mCenter = gpuvec4(0.0f);
+    gpuvec4 mHalfExtents = gpuvec4(0.0f);
+};
+
+static_assert(sizeof(CollisionProxy) == sizeof(uint32_t) * 8 + sizeof(gpuvec4) * 2);
+
+struct CollisionFileHeader {
+    uint32_t magicValue;
+
+    /* Number of proxies following this header, one per mesh */
+    uint32_t proxyCount;
+
+    uint32_t vertexDataSize;
+    uint32_t indexDataSize;
+    uint32_t bvhDataSize;
+
+    /* GetCollisionBvhLayout() of the converter, the serialized BVHs are rebuilt at load time if it does not match */
+    uint32_t bvhLayout;
+};
+
+struct CollisionData final {
+    std::vector<CollisionProxy> mProxies;
+    std::vector<float> mVertexData;
+    std::vector<uint32_t> mIndexData;
+    std::vector<uint8_t> mBvhData;
+    uint32_t mBvhLayout = 0;
+};
+
+struct CollisionSettings final {
+    // the proxy geometry comes from the coarsest LOD with at most this error (see Mesh::lodError), impostor LODs are never used
+    float maxError = 0.05f;
+
+    // meshes with a smaller bounding sphere are boxes or convex hulls, everything else is a triangle mesh
+    float boxRadius = 0.25f;
+    float hullRadius = 1.0f;
+};
+
+/* Size of btOptimizedBvh, btScalar and pointers: in-place serialized BVHs are only valid for the same layout */
+uint32_t GetCollisionBvhLayout();
+
+/* Build the proxies of all meshes, one task per mesh */
+void BuildCollisionProxies(const MeshData& meshData, const CollisionSettings& settings, CollisionData& out, tf::Executor& executor);
+
+void SaveCollisionData(const char* fileName, const CollisionData& data);
+
+/* Returns false if the file does not exist (the scene has no collision) */
+bool LoadCollisionData(const char* fileName, CollisionData& data);
+
+/* Bullet shapes of the proxies and static collision objects of the draws using them */
+class CollisionShapes final {
+public:
+    explicit CollisionShapes(CollisionData data);
+    ~CollisionShapes();
+
+    CollisionShapes(const CollisionShapes&) = delete;
+    CollisionShapes& operator=(const CollisionShapes&) = delete;
+
+    /* Shape of a mesh, nullptr if it has no collision */
+    [[nodiscard]] btCollisionShape* GetShape(uint32_t meshIndex) const;
+
+    /* Add a static collision object for every draw of a mesh with a proxy. 'transforms' are indexed by DrawData::transformIndex.
+       Scaled draws get their own scaled shapes. The objects are removed from the world by the destructor.
+       Returns the number of added objects */
+    uint32_t AddToWorld(btCollisionWorld& world, const std::vector<DrawData>& draws, const std::vector<glm::mat4>& transforms);
+
+    /* Number of triangle meshes whose BVH had to be rebuilt at load time */
+    [[nodiscard]] uint32_t GetNumRebuiltBvhs() const { return mNumRebuiltBvhs; }
+
+private:
+    CollisionData mData;
+
+    // aligned copy of mData.mBvhData, the BVHs live in it
+    uint8_t* mBvhBuffer = nullptr;
+
+    std::vector<std::unique_ptr<btTriangleIndexVertexArray>> mMeshInterfaces;
+    std::vector<std::unique_ptr<btCollisionShape>> mShapes;
+    std::vector<std::unique_ptr<btCollisionShape>> mScaledShapes;
+    std::vector<std::unique_ptr<btCollisionObject>> mObjects;
+
+    btCollisionWorld* mWorld = nullptr;
+    uint32_t mNumRebuiltBvhs = 0;
+};
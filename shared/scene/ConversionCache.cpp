@@ -0,0 +1,112 @@
+#include "ConversionCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // entries are written to a temporary file first, so an interrupted run never leaves a truncated entry behind
+    std::string GetTempPath(const std::string& path) {
+        char suffix[64];
+        snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+        return path + suffix;
+    }
+
+    void Commit(const std::string& tmpPath, const std::string& path) {
+        std::error_code ec;
+        fs::rename(tmpPath, path, ec);
+        if (ec)
+            fs::remove(tmpPath, ec);
+    }
+}
+
+ConversionCache::ConversionCache(std::string directory)
+    : mDirectory(std::move(directory)) {
+    std::error_code ec;
+    fs::create_directories(mDirectory, ec);
+}
+
+uint64_t ConversionCache::HashFile(const std::string& fileName, uint64_t hash) {
+    FILE* f = fopen(fileName.c_str(), "rb");
+    if (!f)
+        return hash;
+
+    std::vector<uint8_t> buffer(1 << 20);
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+        hash = HashBytes(buffer.data(), bytesRead, hash);
+
+    fclose(f);
+    return hash;
+}
+
+std::string ConversionCache::GetPath(uint64_t key, const char* ext) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return mDirectory + "/" + name + ext;
+}
+
+bool ConversionCache::Fetch(uint64_t key, const char* ext, const std::string& outFile) const {
+    const std::string path = GetPath(key, ext);
+    std::error_code ec;
+    if (!fs::exists(path, ec))
+        return false;
+
+    fs::copy_file(path, outFile, fs::copy_options::overwrite_existing, ec);
+    return !ec;
+}
+
+void ConversionCache::Store(uint64_t key, const char* ext, const std::string& srcFile) const {
+    const std::string path = GetPath(key, ext);
+    const std::string tmpPath = GetTempPath(path);
+    std::error_code ec;
+    fs::copy_file(srcFile, tmpPath, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        printf("Cannot store '%s' in the conversion cache\n", srcFile.c_str());
+        return;
+    }
+    Commit(tmpPath, path);
+}
+
+bool ConversionCache::LoadMesh(uint64_t key, Mesh& mesh, MeshData& data) const {
+    FILE* f = fopen(GetPath(key, ".mesh").c_str(), "rb");
+    if (!f)
+        return false;
+
+    uint32_t sizes[3];
+    bool ok = fread(&mesh, sizeof(Mesh), 1, f) == 1 && fread(sizes, sizeof(sizes), 1, f) == 1;
+    if (ok) {
+        data.mVertexData.resize(sizes[0]);
+        data.mIndexData.resize(sizes[1]);
+        data.mSkinData.resize(sizes[2]);
+        ok = fread(data.mVertexData.data(), sizeof(float), sizes[0], f) == sizes[0] &&
+             fread(data.mIndexData.data(), sizeof(uint32_t), sizes[1], f) == sizes[1] &&
+             fread(data.mSkinData.data(), sizeof(VertexBoneData), sizes[2], f) == sizes[2];
+    }
+
+    fclose(f);
+    return ok;
+}
+
+void ConversionCache::SaveMesh(uint64_t key, const Mesh& mesh, const MeshData& data) const {
+    const std::string path = GetPath(key, ".mesh");
+    const std::string tmpPath = GetTempPath(path);
+
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        printf("Cannot write '%s'\n", tmpPath.c_str());
+        return;
+    }
+
+    const uint32_t sizes[3] = { (uint32_t)data.mVertexData.size(), (uint32_t)data.mIndexData.size(), (uint32_t)data.mSkinData.size() };
+    fwrite(&mesh, sizeof(Mesh), 1, f);
+    fwrite(sizes, sizeof(sizes), 1, f);
+    fwrite(data.mVertexData.data(), sizeof(float), sizes[0], f);
+    fwrite(data.mIndexData.data(), sizeof(uint32_t), sizes[1], f);
+    fwrite(data.mSkinData.data(), sizeof(VertexBoneData), sizes[2], f);
+    fclose(f);
+
+    Commit(tmpPath, path);
+}
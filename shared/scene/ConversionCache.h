@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "shared/Utils.h"
+#include "shared/scene/VtxData.h"
+
+/* Content-addressed cache of converter outputs. Entries are files named after a 64-bit key (see HashBytes()) which the caller
+   builds from the input bytes and all conversion settings, so changed inputs or settings simply produce a different key.
+   Bump kConverterVersion whenever the conversion code changes its output. All methods may be called from several threads */
+class ConversionCache final {
+public:
+    static constexpr uint64_t kConverterVersion = 8;
+
+    explicit ConversionCache(std::string directory);
+
+    /* Hash the contents of a file into 'hash'. Missing files hash as empty */
+    static uint64_t HashFile(const std::string& fileName, uint64_t hash);
+
+    template <typename T>
+    static uint64_t HashValue(const T& value, uint64_t hash) { return HashBytes(&value, sizeof(T), hash); }
+
+    static uint64_t HashString(const std::string& s, uint64_t hash) { return HashBytes(s.data(), s.size(), HashValue(s.size(), hash)); }
+
+    [[nodiscard]] std::string GetPath(uint64_t key, const char* ext) const;
+
+    /* Copy the cached entry to 'outFile'. Returns false on a cache miss */
+    bool Fetch(uint64_t key, const char* ext, const std::string& outFile) const;
+
+    /* Copy 'srcFile' into the cache */
+    void Store(uint64_t key, const char* ext, const std::string& srcFile) const;
+
+    /* Converted single mesh with its private buffers (offsets relative to 'data', as produced by SceneConverter) */
+    bool LoadMesh(uint64_t key, Mesh& mesh, MeshData& data) const;
+    void SaveMesh(uint64_t key, const Mesh& mesh, const MeshData& data) const;
+
+private:
+    std::string mDirectory;
+};
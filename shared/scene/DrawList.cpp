@@ -0,0 +1,67 @@
+#include "DrawList.h"
+
+#include <algorithm>
+
+// instances are expanded in node order, so the draw list and the transforms always agree
+static std::vector<uint32_t> sortedInstanceNodes(const Scene& scene) {
+    std::vector<uint32_t> nodes;
+    nodes.reserve(scene.mPrototypeForNode.size());
+    for (const auto& i: scene.mPrototypeForNode)
+        nodes.push_back(i.first);
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+void BuildDrawList(const Scene& scene, const MeshData& meshData, std::vector<DrawData>& drawData) {
+    drawData.clear();
+
+    for (const auto& c: scene.mMeshes) {
+        const auto material = scene.mMaterialForNode.find(c.first);
+        if (material == scene.mMaterialForNode.end())
+            continue;
+
+        drawData.push_back(DrawData {
+                .meshIndex = c.second,
+                .materialIndex = material->second,
+                .LOD = 0,
+                .indexOffset = meshData.mMeshes[c.second].indexOffset,
+                .vertexOffset = meshData.mMeshes[c.second].vertexOffset,
+                .transformIndex = c.first
+        });
+    }
+
+    auto transformIndex = (uint32_t)scene.mGlobalTransform.size();
+
+    for (uint32_t node: sortedInstanceNodes(scene)) {
+        const Prototype& p = scene.mPrototypes[scene.mPrototypeForNode.at(node)];
+
+        for (uint32_t n = 0 ; n != (uint32_t)p.mHierarchy.size() ; n++) {
+            const auto mesh = p.mMeshes.find(n);
+            const auto material = p.mMaterialForNode.find(n);
+            if (mesh == p.mMeshes.end() || material == p.mMaterialForNode.end())
+                continue;
+
+            drawData.push_back(DrawData {
+                    .meshIndex = mesh->second,
+                    .materialIndex = material->second,
+                    .LOD = 0,
+                    .indexOffset = meshData.mMeshes[mesh->second].indexOffset,
+                    .vertexOffset = meshData.mMeshes[mesh->second].vertexOffset,
+                    .transformIndex = transformIndex++
+            });
+        }
+    }
+}
+
+void BuildDrawTransforms(const Scene& scene, std::vector<glm::mat4>& transforms) {
+    transforms.assign(scene.mGlobalTransform.begin(), scene.mGlobalTransform.end());
+
+    for (uint32_t node: sortedInstanceNodes(scene)) {
+        const Prototype& p = scene.mPrototypes[scene.mPrototypeForNode.at(node)];
+        const glm::mat4& instanceTransform = scene.mGlobalTransform[node];
+
+        for (uint32_t n = 0 ; n != (uint32_t)p.mHierarchy.size() ; n++)
+            if (p.mMeshes.contains(n) && p.mMaterialForNode.contains(n))
+                transforms.push_back(instanceTransform * p.mGlobalTransform[n]);
+    }
+}
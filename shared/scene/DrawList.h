@@ -0,0 +1,11 @@
+#pragma once
+
+#include "shared/scene/Scene.h"
+#include "shared/scene/VtxData.h"
+
+/* Flatten the scene into a draw list. Regular mesh nodes use their node index as DrawData::transformIndex,
+   prototype instances are expanded here and reference the matrices appended after the node transforms (see BuildDrawTransforms()) */
+void BuildDrawList(const Scene& scene, const MeshData& meshData, std::vector<DrawData>& drawData);
+
+/* Node global transforms followed by one matrix for every expanded instance draw. Call after RecalculateGlobalTransforms() */
+void BuildDrawTransforms(const Scene& scene, std::vector<glm::mat4>& transforms);
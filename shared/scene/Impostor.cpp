@@ -0,0 +1,398 @@
+#include "Impostor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+void SaveStringList(FILE* f, const std::vector<std::string>& lines);
+void LoadStringList(FILE* f, std::vector<std::string>& lines);
+
+namespace {
+    // samples per texel side
+    constexpr int kSupersampling = 2;
+
+    // texels outside of the mesh are filled up to this distance from the silhouette
+    constexpr int kDilationPasses = 8;
+
+    glm::vec2 SignNotZero(const glm::vec2& v) {
+        return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    float EdgeFunction(const glm::vec3& a, const glm::vec3& b, const glm::vec2& p) {
+        return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    }
+
+    glm::vec4 FetchAlbedo(const ImpostorMaterial& material, const glm::vec2& uv) {
+        if (!material.mAlbedo || material.mWidth <= 0 || material.mHeight <= 0)
+            return material.mAlbedoColor;
+
+        const int x = std::clamp((int)((uv.x - std::floor(uv.x)) * (float)material.mWidth), 0, material.mWidth - 1);
+        const int y = std::clamp((int)((uv.y - std::floor(uv.y)) * (float)material.mHeight), 0, material.mHeight - 1);
+        const uint8_t* texel = material.mAlbedo + ((size_t)y * material.mWidth + x) * 4;
+
+        return material.mAlbedoColor * glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+    }
+
+    uint8_t ToByte(float v) {
+        return (uint8_t)std::clamp((int)std::lround(v * 255.0f), 0, 255);
+    }
+
+    // Fill the uncovered texels of one frame with the average of their already filled neighbours, one ring per pass.
+    // Coverage (alpha) stays 0
+    void DilateFrame(ImpostorAtlas& atlas, int x0, int y0, int frameSize) {
+        std::vector<uint8_t> filled((size_t)frameSize * frameSize);
+        for (int y = 0 ; y != frameSize ; y++)
+            for (int x = 0 ; x != frameSize ; x++)
+                filled[y * frameSize + x] = atlas.mAlbedo[((size_t)(y0 + y) * atlas.mSize + x0 + x) * 4 + 3] > 0;
+
+        std::vector<int> newlyFilled;
+
+        for (int pass = 0 ; pass != kDilationPasses ; pass++) {
+            newlyFilled.clear();
+
+            for (int y = 0 ; y != frameSize ; y++)
+                for (int x = 0 ; x != frameSize ; x++) {
+                    if (filled[y * frameSize + x])
+                        continue;
+
+                    glm::vec3 albedo(0.0f), normal(0.0f);
+                    float depth = 0.0f;
+                    int count = 0;
+
+                    const int neighbours[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+                    for (const auto& [nx, ny]: neighbours) {
+                        if (nx < 0 || ny < 0 || nx >= frameSize || ny >= frameSize || !filled[ny * frameSize + nx])
+                            continue;
+                        const size_t i = (size_t)(y0 + ny) * atlas.mSize + x0 + nx;
+                        albedo += glm::vec3(atlas.mAlbedo[i * 4 + 0], atlas.mAlbedo[i * 4 + 1], atlas.mAlbedo[i * 4 + 2]);
+                        normal += glm::vec3(atlas.mNormal[i * 4 + 0], atlas.mNormal[i * 4 + 1], atlas.mNormal[i * 4 + 2]);
+                        depth += atlas.mDepth[i];
+                        count++;
+                    }
+
+                    if (!count)
+                        continue;
+
+                    const size_t i = (size_t)(y0 + y) * atlas.mSize + x0 + x;
+                    albedo /= (float)count * 255.0f;
+                    normal /= (float)count * 255.0f;
+                    for (int c = 0 ; c != 3 ; c++) {
+                        atlas.mAlbedo[i * 4 + c] = ToByte(albedo[c]);
+                        atlas.mNormal[i * 4 + c] = ToByte(normal[c]);
+                    }
+                    atlas.mDepth[i] = ToByte(depth / ((float)count * 255.0f));
+                    newlyFilled.push_back(y * frameSize + x);
+                }
+
+            if (newlyFilled.empty())
+                break;
+            for (int i: newlyFilled)
+                filled[i] = 1;
+        }
+    }
+}
+
+glm::vec2 OctahedralEncode(const glm::vec3& dir) {
+    const glm::vec3 d = dir / (std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z));
+
+    // the upper hemisphere is the inner diamond, the lower one is folded into the corners
+    glm::vec2 p(d.x, d.z);
+    if (d.y < 0.0f)
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * SignNotZero(p);
+
+    return p * 0.5f + 0.5f;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2& uv) {
+    const glm::vec2 p = uv * 2.0f - 1.0f;
+
+    glm::vec3 d(p.x, 1.0f - std::abs(p.x) - std::abs(p.y), p.y);
+    if (d.y < 0.0f) {
+        const glm::vec2 xz = (1.0f - glm::abs(glm::vec2(d.z, d.x))) * SignNotZero(glm::vec2(d.x, d.z));
+        d.x = xz.x;
+        d.z = xz.y;
+    }
+
+    return glm::normalize(d);
+}
+
+glm::vec3 GetImpostorFrameDirection(uint32_t x, uint32_t y, uint32_t framesPerSide) {
+    return OctahedralDecode(glm::vec2((float)x, (float)y) / (float)(framesPerSide - 1));
+}
+
+void GetImpostorFrameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up) {
+    const glm::vec3 ref = (std::abs(dir.y) > 0.999f) ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    right = glm::normalize(glm::cross(ref, dir));
+    up = glm::cross(dir, right);
+}
+
+float GetImpostorError(const ImpostorDescription& impostor) {
+    const float radius = impostor.mCenterRadius.w;
+    if (impostor.mFramesPerSide < 2 || impostor.mFrameSize == 0)
+        return radius;
+
+    // neighbouring frames are about pi / (framesPerSide - 1) apart and the card shows the nearest one
+    const float parallax = radius * std::sin(0.5f * glm::pi<float>() / (float)(impostor.mFramesPerSide - 1));
+    const float texel = 2.0f * radius / (float)impostor.mFrameSize;
+
+    return std::max(parallax, texel);
+}
+
+ImpostorDescription DescribeImpostor(const MeshData& meshData, uint32_t meshIndex, uint32_t framesPerSide, uint32_t frameSize) {
+    const Mesh& mesh = meshData.mMeshes[meshIndex];
+    const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+    const float* vertices = &meshData.mVertexData[mesh.streamOffset[0] / sizeof(float)];
+    const uint32_t* indices = &meshData.mIndexData[mesh.indexOffset + mesh.lodOffset[0]];
+
+    glm::vec3 vmin(std::numeric_limits<float>::max());
+    glm::vec3 vmax(std::numeric_limits<float>::lowest());
+
+    for (uint32_t i = 0 ; i != mesh.GetLODIndicesCount(0) ; i++) {
+        const float* v = vertices + (size_t)indices[i] * stride;
+        vmin = glm::min(vmin, glm::vec3(v[0], v[1], v[2]));
+        vmax = glm::max(vmax, glm::vec3(v[0], v[1], v[2]));
+    }
+
+    ImpostorDescription impostor;
+    impostor.mFramesPerSide = framesPerSide;
+    impostor.mFrameSize = frameSize;
+
+    // the same sphere as the one used by LODSelector
+    if (vmin.x <= vmax.x) {
+        const BoundingBox box(vmin, vmax);
+        impostor.mCenterRadius = gpuvec4(glm::vec4(box.getCenter(), 0.5f * glm::length(box.getSize())));
+    }
+
+    return impostor;
+}
+
+void BakeImpostor(const MeshData& meshData, uint32_t meshIndex, const ImpostorMaterial& material, const ImpostorDescription& impostor, ImpostorAtlas& atlas) {
+    const Mesh& mesh = meshData.mMeshes[meshIndex];
+    const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+    const float* vertices = &meshData.mVertexData[mesh.streamOffset[0] / sizeof(float)];
+    const uint32_t* indices = &meshData.mIndexData[mesh.indexOffset + mesh.lodOffset[0]];
+    const uint32_t numIndices = mesh.GetLODIndicesCount(0);
+
+    const int framesPerSide = (int)impostor.mFramesPerSide;
+    const int frameSize = (int)impostor.mFrameSize;
+    const glm::vec3 center(impostor.mCenterRadius.x, impostor.mCenterRadius.y, impostor.mCenterRadius.z);
+    const float radius = std::max(impostor.mCenterRadius.w, std::numeric_limits<float>::min());
+
+    atlas.mSize = framesPerSide * frameSize;
+    atlas.mAlbedo.assign((size_t)atlas.mSize * atlas.mSize * 4, 0);
+    atlas.mNormal.assign((size_t)atlas.mSize * atlas.mSize * 4, 0);
+    atlas.mDepth.assign((size_t)atlas.mSize * atlas.mSize, 0);
+
+    // samples of one frame: depth towards the viewer in [-1, 1] (lowest - empty), linear albedo and mesh space normal
+    const int size = frameSize * kSupersampling;
+    std::vector<float> depth((size_t)size * size);
+    std::vector<glm::vec3> albedo((size_t)size * size);
+    std::vector<glm::vec3> normal((size_t)size * size);
+
+    // vertices in sample coordinates and depth
+    std::vector<glm::vec3> projected(mesh.vertexCount);
+
+    for (int fy = 0 ; fy != framesPerSide ; fy++)
+        for (int fx = 0 ; fx != framesPerSide ; fx++) {
+            const glm::vec3 dir = GetImpostorFrameDirection(fx, fy, framesPerSide);
+            glm::vec3 right, up;
+            GetImpostorFrameBasis(dir, right, up);
+
+            for (uint32_t i = 0 ; i != mesh.vertexCount ; i++) {
+                const float* v = vertices + (size_t)i * stride;
+                const glm::vec3 d = (glm::vec3(v[0], v[1], v[2]) - center) / radius;
+                projected[i] = glm::vec3((glm::dot(d, right) * 0.5f + 0.5f) * (float)size, (glm::dot(d, up) * 0.5f + 0.5f) * (float)size, glm::dot(d, dir));
+            }
+
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::lowest());
+
+            // no culling, foliage and other thin geometry is double-sided
+            for (uint32_t t = 0 ; t + 2 < numIndices ; t += 3) {
+                const uint32_t i0 = indices[t + 0], i1 = indices[t + 1], i2 = indices[t + 2];
+                const glm::vec3& a = projected[i0];
+                const glm::vec3& b = projected[i1];
+                const glm::vec3& c = projected[i2];
+
+                const float area = EdgeFunction(a, b, glm::vec2(c));
+                if (std::abs(area) < 1e-8f)
+                    continue;
+
+                const int xmin = std::max((int)std::floor(std::min({ a.x, b.x, c.x })), 0);
+                const int xmax = std::min((int)std::ceil(std::max({ a.x, b.x, c.x })), size - 1);
+                const int ymin = std::max((int)std::floor(std::min({ a.y, b.y, c.y })), 0);
+                const int ymax = std::min((int)std::ceil(std::max({ a.y, b.y, c.y })), size - 1);
+
+                const float* v0 = vertices + (size_t)i0 * stride;
+                const float* v1 = vertices + (size_t)i1 * stride;
+                const float* v2 = vertices + (size_t)i2 * stride;
+
+                for (int y = ymin ; y <= ymax ; y++)
+                    for (int x = xmin ; x <= xmax ; x++) {
+                        const glm::vec2 p((float)x + 0.5f, (float)y + 0.5f);
+                        const float w0 = EdgeFunction(b, c, p) / area;
+                        const float w1 = EdgeFunction(c, a, p) / area;
+                        const float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                            continue;
+
+                        // orthographic projection, attributes are interpolated linearly
+                        const float z = w0 * a.z + w1 * b.z + w2 * c.z;
+                        const size_t s = (size_t)y * size + x;
+                        if (z <= depth[s])
+                            continue;
+
+                        const glm::vec2 uv = w0 * glm::vec2(v0[3], v0[4]) + w1 * glm::vec2(v1[3], v1[4]) + w2 * glm::vec2(v2[3], v2[4]);
+                        const glm::vec4 color = FetchAlbedo(material, uv);
+                        if (material.mAlphaTest > 0.0f && color.w < material.mAlphaTest)
+                            continue;
+
+                        const glm::vec3 n = w0 * glm::vec3(v0[5], v0[6], v0[7]) + w1 * glm::vec3(v1[5], v1[6], v1[7]) + w2 * glm::vec3(v2[5], v2[6], v2[7]);
+
+                        depth[s] = z;
+                        albedo[s] = glm::pow(glm::clamp(glm::vec3(color), 0.0f, 1.0f), glm::vec3(2.2f));
+                        normal[s] = (glm::dot(n, n) > 0.0f) ? glm::normalize(n) : dir;
+                    }
+            }
+
+            // resolve: albedo is averaged in linear space, coverage goes to alpha, the nearest depth is kept
+            for (int ty = 0 ; ty != frameSize ; ty++)
+                for (int tx = 0 ; tx != frameSize ; tx++) {
+                    glm::vec3 sumAlbedo(0.0f), sumNormal(0.0f);
+                    float maxDepth = std::numeric_limits<float>::lowest();
+                    int covered = 0;
+
+                    for (int sy = 0 ; sy != kSupersampling ; sy++)
+                        for (int sx = 0 ; sx != kSupersampling ; sx++) {
+                            const size_t s = (size_t)(ty * kSupersampling + sy) * size + tx * kSupersampling + sx;
+                            if (depth[s] == std::numeric_limits<float>::lowest())
+                                continue;
+                            sumAlbedo += albedo[s];
+                            sumNormal += normal[s];
+                            maxDepth = std::max(maxDepth, depth[s]);
+                            covered++;
+                        }
+
+                    if (!covered)
+                        continue;
+
+                    const glm::vec3 a = glm::pow(sumAlbedo / (float)covered, glm::vec3(1.0f / 2.2f));
+                    const glm::vec3 n = (glm::dot(sumNormal, sumNormal) > 0.0f) ? glm::normalize(sumNormal) : dir;
+                    const uint8_t coverage = ToByte((float)covered / (float)(kSupersampling * kSupersampling));
+
+                    const size_t i = (size_t)(fy * frameSize + ty) * atlas.mSize + fx * frameSize + tx;
+                    for (int c = 0 ; c != 3 ; c++) {
+                        atlas.mAlbedo[i * 4 + c] = ToByte(a[c]);
+                        atlas.mNormal[i * 4 + c] = ToByte(n[c] * 0.5f + 0.5f);
+                    }
+                    atlas.mAlbedo[i * 4 + 3] = coverage;
+                    atlas.mNormal[i * 4 + 3] = coverage;
+                    atlas.mDepth[i] = ToByte(std::clamp(maxDepth, -1.0f, 1.0f) * 0.5f + 0.5f);
+                }
+
+            DilateFrame(atlas, fx * frameSize, fy * frameSize, frameSize);
+        }
+}
+
+void AddImpostorLODs(MeshData& meshData, const std::vector<uint32_t>& impostorForMesh, const std::vector<ImpostorDescription>& impostors) {
+    std::vector<float> newVertices;
+    std::vector<uint32_t> newIndices;
+    newVertices.reserve(meshData.mVertexData.size() + impostors.size() * 4 * 8);
+    newIndices.reserve(meshData.mIndexData.size() + impostors.size() * 6);
+
+    for (uint32_t m = 0 ; m != (uint32_t)meshData.mMeshes.size() ; m++) {
+        Mesh& mesh = meshData.mMeshes[m];
+        const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+        const uint32_t impostor = (m < impostorForMesh.size()) ? impostorForMesh[m] : kNoImpostor;
+
+        // the card needs the position, uv and normal layout
+        const bool addImpostor = impostor != kNoImpostor && stride >= 8 && !IsSkinnedMesh(mesh);
+
+        const auto firstVertex = (uint32_t)(newVertices.size() / std::max(stride, 1u));
+        const auto firstIndex = (uint32_t)newIndices.size();
+
+        const auto vertexStart = meshData.mVertexData.begin() + mesh.streamOffset[0] / sizeof(float);
+        newVertices.insert(newVertices.end(), vertexStart, vertexStart + (size_t)mesh.vertexCount * stride);
+
+        // Mesh::lodCount stays strictly less than kMaxLODs
+        if (addImpostor && mesh.lodCount + 1 >= kMaxLODs)
+            mesh.lodCount = kMaxLODs - 2;
+
+        const auto indexStart = meshData.mIndexData.begin() + mesh.indexOffset;
+        newIndices.insert(newIndices.end(), indexStart, indexStart + mesh.lodOffset[mesh.lodCount]);
+
+        if (addImpostor) {
+            // card space quad: positions in [-1, 1]^2, facing +Z
+            const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+            for (const auto& [x, y]: corners) {
+                newVertices.insert(newVertices.end(), { x, y, 0.0f, x * 0.5f + 0.5f, y * 0.5f + 0.5f, 0.0f, 0.0f, 1.0f });
+                newVertices.insert(newVertices.end(), stride - 8, 0.0f);
+            }
+            for (uint32_t i: { 0u, 1u, 2u, 0u, 2u, 3u })
+                newIndices.push_back(mesh.vertexCount + i);
+
+            const uint32_t lod = mesh.lodCount;
+            mesh.lodError[lod] = std::max(GetImpostorError(impostors[impostor]), lod > 0 ? mesh.lodError[lod - 1] : 0.0f);
+            mesh.lodOffset[lod + 1] = mesh.lodOffset[lod] + 6;
+            mesh.lodCount++;
+            mesh.vertexCount += 4;
+            mesh.impostorIndex = impostor;
+        }
+
+        mesh.indexOffset = firstIndex;
+        mesh.vertexOffset = firstVertex;
+        mesh.streamOffset[0] = firstVertex * stride * sizeof(float);
+    }
+
+    meshData.mVertexData = std::move(newVertices);
+    meshData.mIndexData = std::move(newIndices);
+}
+
+void SaveImpostors(const char* fileName, const std::vector<ImpostorDescription>& impostors, const std::vector<std::string>& files) {
+    FILE* f = fopen(fileName, "wb");
+    if (!f)
+        return;
+
+    const auto sz = (uint32_t)impostors.size();
+    fwrite(&sz, 1, sizeof(uint32_t), f);
+    fwrite(impostors.data(), sizeof(ImpostorDescription), sz, f);
+    SaveStringList(f, files);
+    fclose(f);
+}
+
+bool LoadImpostors(const char* fileName, std::vector<ImpostorDescription>& impostors, std::vector<std::string>& files) {
+    impostors.clear();
+    files.clear();
+
+    FILE* f = fopen(fileName, "rb");
+    if (!f)
+        return false;
+
+    uint32_t sz = 0;
+    if (fread(&sz, 1, sizeof(uint32_t), f) == sizeof(uint32_t)) {
+        impostors.resize(sz);
+        if (fread(impostors.data(), sizeof(ImpostorDescription), sz, f) == sz)
+            LoadStringList(f, files);
+        else
+            impostors.clear();
+    }
+    fclose(f);
+
+    return true;
+}
+
+uint32_t MergeImpostorLists(std::vector<ImpostorDescription>& impostors, std::vector<std::string>& files,
+                            const std::vector<ImpostorDescription>& otherImpostors, const std::vector<std::string>& otherFiles) {
+    const auto first = (uint32_t)impostors.size();
+    const auto textureOffset = (uint32_t)files.size();
+
+    for (ImpostorDescription d: otherImpostors) {
+        d.mAlbedoMap += textureOffset;
+        d.mNormalMap += textureOffset;
+        d.mDepthMap += textureOffset;
+        impostors.push_back(d);
+    }
+    files.insert(files.end(), otherFiles.begin(), otherFiles.end());
+
+    return first;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shared/scene/vec4.h"
+#include "shared/scene/VtxData.h"
+
+/* Octahedral impostors. A mesh is rendered offline from mFramesPerSide x mFramesPerSide view directions laid out on an octahedron
+   (+Y at the center of the atlas, -Y at the corners) into albedo, normal and depth atlases. Far away the mesh is drawn as its
+   impostor LOD: one quad which the card renderer aligns with the baked view closest to the camera direction.
+
+   Frame (x, y) covers the atlas texels [x, x + 1) * frameSize by [y, y + 1) * frameSize (rows go up the card, as GL texture coordinates)
+   and shows the bounding sphere of the mesh from GetImpostorFrameDirection(), with the card axes of GetImpostorFrameBasis() */
+struct PACKED_STRUCT ImpostorDescription final {
+    // bounding sphere of the mesh in mesh space, every frame covers it
+    gpuvec4 mCenterRadius = gpuvec4(0.0f);
+
+    uint32_t mFramesPerSide = 0;
+    uint32_t mFrameSize = 0;
+
+    // indices in the texture list of the impostor file
+    uint32_t mAlbedoMap = 0;    // RGB - albedo, A - coverage
+    uint32_t mNormalMap = 0;    // RGB - mesh space normal (n * 0.5 + 0.5), A - coverage
+    uint32_t mDepthMap = 0;     // R - offset along the view direction, 0..1 over the bounding sphere (1 is the nearest)
+
+    uint32_t mPadding[3] = { 0, 0, 0 };
+};
+
+static_assert(sizeof(ImpostorDescription) % 16 == 0, "ImpostorDescription should be padded to 16 bytes");
+
+/* Surface of the mesh as seen by the baker */
+struct ImpostorMaterial final {
+    glm::vec4 mAlbedoColor = glm::vec4(1.0f);
+
+    // optional RGBA8 albedo texture (sampled with wrapping, rows in the GL texture coordinate order), multiplied by mAlbedoColor
+    const uint8_t* mAlbedo = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+
+    // texels with a lower albedo alpha are not rendered (0 - the surface is opaque)
+    float mAlphaTest = 0.0f;
+};
+
+/* Baked atlases of one impostor, (mFramesPerSide * mFrameSize)^2 texels each */
+struct ImpostorAtlas final {
+    int mSize = 0;
+    std::vector<uint8_t> mAlbedo;   // RGBA8
+    std::vector<uint8_t> mNormal;   // RGBA8
+    std::vector<uint8_t> mDepth;    // R8
+};
+
+/* Octahedral mapping of unit directions to [0, 1]^2 and back */
+glm::vec2 OctahedralEncode(const glm::vec3& dir);
+glm::vec3 OctahedralDecode(const glm::vec2& uv);
+
+/* Direction from the mesh towards the viewer of frame (x, y) */
+glm::vec3 GetImpostorFrameDirection(uint32_t x, uint32_t y, uint32_t framesPerSide);
+
+/* Card axes of a frame: the mesh +Y stays up except for the views from straight above or below */
+void GetImpostorFrameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up);
+
+/* Geometric error of the impostor in mesh units (see Mesh::lodError): the parallax of a view snapped to the nearest frame
+   or the frame texel size, whichever is larger */
+float GetImpostorError(const ImpostorDescription& impostor);
+
+/* Bounding sphere of LOD0 and the atlas layout. The map indices are left for the caller to fill in */
+ImpostorDescription DescribeImpostor(const MeshData& meshData, uint32_t meshIndex, uint32_t framesPerSide, uint32_t frameSize);
+
+/* Render LOD0 of the mesh (position, uv, normal vertices) into all frames with a CPU rasterizer. Every texel is supersampled
+   and texels outside of the mesh take the color of their covered neighbours, so filtering does not bleed the background in */
+void BakeImpostor(const MeshData& meshData, uint32_t meshIndex, const ImpostorMaterial& material, const ImpostorDescription& impostor, ImpostorAtlas& atlas);
+
+/* Append the impostor LOD to every mesh with impostorForMesh[mesh] != kNoImpostor and set Mesh::impostorIndex and its LOD error.
+   Meshes with the maximum number of LODs lose their coarsest LOD. The vertex and index data are rebuilt */
+void AddImpostorLODs(MeshData& meshData, const std::vector<uint32_t>& impostorForMesh, const std::vector<ImpostorDescription>& impostors);
+
+void SaveImpostors(const char* fileName, const std::vector<ImpostorDescription>& impostors, const std::vector<std::string>& files);
+
+/* Returns false if the file does not exist (the scene has no impostors) */
+bool LoadImpostors(const char* fileName, std::vector<ImpostorDescription>& impostors, std::vector<std::string>& files);
+
+/* Append the impostors of another scene, its texture indices are rebased. Returns the index of its first impostor */
+uint32_t MergeImpostorLists(std::vector<ImpostorDescription>& impostors, std::vector<std::string>& files,
+                            const std::vector<ImpostorDescription>& otherImpostors, const std::vector<std::string>& otherFiles);
@@ -0,0 +1,68 @@
+#include "LODSelector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+float LODSelector::GetProjectedError(const MeshData& meshData, const DrawData& draw, const glm::mat4& transform, uint32_t lod,
+                                     const glm::vec3& cameraPos, float pixelsPerUnit) {
+    const Mesh& mesh = meshData.mMeshes[draw.meshIndex];
+
+    // the largest axis scale of the transform makes the error conservative for non-uniform scaling
+    const float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+
+    glm::vec3 center = glm::vec3(transform[3]);
+    float radius = 0.0f;
+    if (draw.meshIndex < meshData.mBoxes.size()) {
+        const BoundingBox& box = meshData.mBoxes[draw.meshIndex];
+        center = glm::vec3(transform * glm::vec4(box.getCenter(), 1.0f));
+        radius = 0.5f * glm::length(box.getSize()) * scale;
+    }
+
+    // distance to the bounding sphere, the error of a mesh we are inside of is never acceptable
+    const float distance = glm::length(center - cameraPos) - radius;
+    if (distance <= 0.0f)
+        return (mesh.lodError[lod] > 0.0f) ? std::numeric_limits<float>::max() : 0.0f;
+
+    return mesh.lodError[lod] * scale * pixelsPerUnit / distance;
+}
+
+bool LODSelector::Update(const MeshData& meshData, const std::vector<glm::mat4>& transforms, std::vector<DrawData>& drawData,
+                         const glm::vec3& cameraPos, float fovY, float viewportHeight) const {
+    const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(0.5f * fovY));
+
+    const float coarsenThreshold = mPixelThreshold * (1.0f - mHysteresis);
+    const float refineThreshold = mPixelThreshold * (1.0f + mHysteresis);
+
+    bool changed = false;
+
+    for (auto& d: drawData) {
+        const Mesh& mesh = meshData.mMeshes[d.meshIndex];
+        const glm::mat4& t = transforms[d.transformIndex];
+
+        auto error = [&](uint32_t lod) { return GetProjectedError(meshData, d, t, lod, cameraPos, pixelsPerUnit); };
+
+        const uint32_t lodCount = (!mImpostors && mesh.impostorIndex != kNoImpostor) ? mesh.lodCount - 1 : mesh.lodCount;
+
+        const uint32_t current = std::min(d.LOD, lodCount - 1);
+        uint32_t lod = current;
+
+        if (error(current) > refineThreshold) {
+            // refine: the coarsest finer LOD which is good enough (LOD0 is always acceptable)
+            while (lod > 0 && error(lod) > mPixelThreshold)
+                lod--;
+        } else {
+            // coarsen: errors grow monotonically with the LOD index
+            while (lod + 1 < lodCount && error(lod + 1) <= coarsenThreshold)
+                lod++;
+        }
+
+        if (lod != d.LOD) {
+            d.LOD = lod;
+            d.indexOffset = mesh.indexOffset + mesh.lodOffset[lod];
+            changed = true;
+        }
+    }
+
+    return changed;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shared/scene/VtxData.h"
+
+/* Screen-space error LOD selection. For every draw the simplification error (Mesh::lodError) is projected through the camera
+   and the coarsest LOD whose error stays below the pixel threshold is selected */
+class LODSelector final {
+public:
+    // maximum allowed projected error in pixels
+    float mPixelThreshold = 1.0f;
+
+    // relative dead zone around the threshold: a draw switches to a coarser LOD only below threshold * (1 - h)
+    // and goes back to a finer one only above threshold * (1 + h), so LODs do not flicker near the boundary
+    float mHysteresis = 0.25f;
+
+    // select impostor LODs (see Mesh::impostorIndex), renderers without a card pass turn this off
+    bool mImpostors = true;
+
+    /* Update DrawData::LOD and DrawData::indexOffset of all draws. 'transforms' are indexed by DrawData::transformIndex.
+       Returns true if any draw changed its LOD */
+    bool Update(const MeshData& meshData, const std::vector<glm::mat4>& transforms, std::vector<DrawData>& drawData,
+                const glm::vec3& cameraPos, float fovY, float viewportHeight) const;
+
+    /* Projected error (in pixels) of the given LOD of a draw */
+    [[nodiscard]] static float GetProjectedError(const MeshData& meshData, const DrawData& draw, const glm::mat4& transform, uint32_t lod,
+                                                 const glm::vec3& cameraPos, float pixelsPerUnit);
+};
@@ -59,47 +59,64 @@ void LoadMaterials(const char *filename, std::vector<MaterialDescription> &mater
     fclose(f);
 }
 
-void MergeMaterialLists(const std::vector<std::vector<MaterialDescription> *> &oldMaterials,
-                        const std::vector<std::vector<std::string> *> &oldTextures,
-                        std::vector<MaterialDescription> &allMaterials, std::vector<std::string>& newTextures) {
-    // map texture names to indices in newTexturesList (calculated as we fill the newTexturesList)
-    std::unordered_map<std::string, int> newTextureNames;
-    std::unordered_map<int, int> materialToTextureList; // direct MaterialDescription usage as a key is impossible, so we use its index in the allMaterials array
-
-    // Create combined material list [no hashing of materials, just straightforward merging of all lists]
-    int midx = 0;
-    for (const std::vector<MaterialDescription>* ml: oldMaterials) {
-        for (const MaterialDescription& m: *ml) {
-            allMaterials.push_back(m);
-            materialToTextureList[allMaterials.size() - 1] = midx;
-        }
+uint64_t HashMaterial(const MaterialDescription& m) {
+    // the structure is packed, so there is no uninitialized padding to worry about
+    return HashBytes(&m, sizeof(MaterialDescription));
+}
 
-        midx++;
-    }
+std::vector<uint32_t> MergeMaterialLists(const std::vector<std::vector<MaterialDescription> *> &oldMaterials,
+                                         const std::vector<std::vector<std::string> *> &oldTextures,
+                                         std::vector<MaterialDescription> &allMaterials, std::vector<std::string>& newTextures) {
+    // Create one combined texture list: map texture names to indices in newTextures and remember the new index of every old one
+    std::unordered_map<std::string, uint64_t> newTextureNames;
+    std::vector<std::vector<uint64_t>> textureRemap(oldTextures.size());
 
-    // Create one combined texture list
-    for (const std::vector<std::string>* tl: oldTextures)
-        for (const std::string& file: *tl) {
-            newTextureNames[file] = AddUnique(newTextures, file); // addUnique() is in SceneConverter/MaterialConv.inl
+    for (size_t l = 0 ; l != oldTextures.size() ; l++) {
+        textureRemap[l].reserve(oldTextures[l]->size());
+        for (const std::string& file: *oldTextures[l]) {
+            const auto [it, inserted] = newTextureNames.try_emplace(file, newTextures.size());
+            if (inserted)
+                newTextures.push_back(file);
+            textureRemap[l].push_back(it->second);
         }
+    }
 
-    // Lambda to replace textureID by a new "version" (from global list)
-    auto replaceTexture = [&materialToTextureList, &oldTextures, &newTextureNames](int m, uint64_t* textureID) {
-        if (*textureID < INVALID_TEXTURE) {
-            auto listIdx = materialToTextureList[m];
-            auto texList = oldTextures[listIdx];
-            const std::string& texFile = (*texList)[*textureID];
-            *textureID = (uint64_t)(newTextureNames[texFile]);
-        }
+    // Replace textureID by a new "version" (from global list)
+    auto replaceTexture = [&textureRemap](size_t listIdx, uint64_t* textureID) {
+        if (*textureID < INVALID_TEXTURE)
+            *textureID = textureRemap[listIdx][*textureID];
     };
 
-    for (size_t i = 0 ; i < allMaterials.size() ; i++)
-    {
-        auto& m = allMaterials[i];
-        replaceTexture(i, &m.mAmbientOcclusionMap);
-        replaceTexture(i, &m.mEmissiveMap);
-        replaceTexture(i, &m.mAlbedoMap);
-        replaceTexture(i, &m.mMetallicRoughnessMap);
-        replaceTexture(i, &m.mNormalMap);
+    // Create combined material list. Materials with equal hashes are compared byte by byte to rule out collisions
+    std::unordered_multimap<uint64_t, uint32_t> materialsForHash;
+    std::vector<uint32_t> materialRemap;
+
+    for (size_t l = 0 ; l != oldMaterials.size() ; l++) {
+        for (MaterialDescription m: *oldMaterials[l]) {
+            replaceTexture(l, &m.mAmbientOcclusionMap);
+            replaceTexture(l, &m.mEmissiveMap);
+            replaceTexture(l, &m.mAlbedoMap);
+            replaceTexture(l, &m.mMetallicRoughnessMap);
+            replaceTexture(l, &m.mNormalMap);
+
+            const uint64_t hash = HashMaterial(m);
+
+            auto newIndex = (uint32_t)allMaterials.size();
+            const auto range = materialsForHash.equal_range(hash);
+            for (auto i = range.first ; i != range.second ; i++)
+                if (!memcmp(&allMaterials[i->second], &m, sizeof(MaterialDescription))) {
+                    newIndex = i->second;
+                    break;
+                }
+
+            if (newIndex == allMaterials.size()) {
+                allMaterials.push_back(m);
+                materialsForHash.emplace(hash, newIndex);
+            }
+
+            materialRemap.push_back(newIndex);
+        }
     }
+
+    return materialRemap;
 }
@@ -34,6 +34,15 @@ struct PACKED_STRUCT MaterialDescription final {
     uint64_t mMetallicRoughnessMap = INVALID_TEXTURE;
     uint64_t mNormalMap = INVALID_TEXTURE;
     uint64_t mOpacityMap = INVALID_TEXTURE;
+
+    // layer of every map in its texture array (small textures are packed into arrays by SceneConverter), 0 for standalone textures
+    uint16_t mAmbientOcclusionLayer = 0;
+    uint16_t mEmissiveLayer = 0;
+    uint16_t mAlbedoLayer = 0;
+    uint16_t mMetallicRoughnessLayer = 0;
+    uint16_t mNormalLayer = 0;
+    uint16_t mOpacityLayer = 0;
+    uint16_t mPadding[2] = { 0, 0 };
 };
 
 static_assert(sizeof(MaterialDescription) % 16 == 0, "MaterialDescription should be padded to 16 bytes");
@@ -41,8 +50,11 @@ static_assert(sizeof(MaterialDescription) % 16 == 0, "MaterialDescription should
 void SaveMaterials(const char* filename, const std::vector<MaterialDescription>& materials, const std::vector<std::string>& files);
 void LoadMaterials(const char* filename, std::vector<MaterialDescription>& materials, std::vector<std::string>& files);
 
-// Merge material lists from multiple scenes
-void MergeMaterialLists(
+uint64_t HashMaterial(const MaterialDescription& m);
+
+// Merge material lists from multiple scenes. Identical materials (after texture remapping) are stored only once.
+// Returns the old-to-new remap table: index in the concatenation of all oldMaterials -> index in allMaterials (see RemapMaterials())
+std::vector<uint32_t> MergeMaterialLists(
         // Input:
         const std::vector<std::vector<MaterialDescription>*>& oldMaterials, // all materials
         const std::vector<std::vector<std::string>*>& oldTextures,          // all textures from all material list
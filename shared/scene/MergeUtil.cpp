@@ -2,108 +2,288 @@
 
 #include "shared/scene/Material.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 #include <map>
+#include <tuple>
 
-static uint32_t shiftMeshIndices(MeshData& meshData, const std::vector<uint32_t>& meshesToMerge)
-{
-    auto minVtxOffset = std::numeric_limits<uint32_t>::max();
-    for (auto i: meshesToMerge)
-        minVtxOffset = std::min(meshData.mMeshes[i].vertexOffset, minVtxOffset);
+// Merged meshes always use the pos(vec3) + uv(vec2) + normal(vec3) layout
+constexpr uint32_t kMergedVertexStride = 3 + 2 + 3;
 
-    auto mergeCount = 0u; // calculated by summing index counts in meshesToMerge
+void MergeScene(Scene &scene, MeshData &meshData, const std::string &materialName) {
+    MergeSceneMaterials(scene, meshData, { materialName });
+}
+
+// (material, cell.x, cell.y, cell.z); std::map keeps the output order deterministic
+using MergeGroupKey = std::tuple<uint32_t, int, int, int>;
+
+static uint32_t getMeshIndexCount(const Mesh& mesh) {
+    return mesh.lodOffset[mesh.lodCount];
+}
+
+// index + vertexOffset is the absolute vertex, but mergeMeshData() bakes the offsets of the merged files into the indices
+// and leaves vertexOffset alone. Subtracting this bias from an index makes it local to the vertex range of the mesh
+static uint32_t getMeshIndexBias(const Mesh& mesh) {
+    return mesh.streamElementSize[0] ? mesh.streamOffset[0] / mesh.streamElementSize[0] - mesh.vertexOffset : 0;
+}
 
-    // now shift all the indices in individual index blocks [use minVtxOffset]
-    for (auto i: meshesToMerge)
-    {
-        auto& m = meshData.mMeshes[i];
-        // for how much should we shift the indices in mesh [m]
-        const uint32_t delta = m.vertexOffset - minVtxOffset;
+// Append the vertices of 'mesh' transformed by 't' and return the bounding box of the transformed positions
+static BoundingBox appendTransformedVertices(const MeshData& src, const Mesh& mesh, const glm::mat4& t, std::vector<float>& dst) {
+    const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(t)));
 
-        const auto idxCount = m.GetLODIndicesCount(0);
-        for (auto ii = 0u ; ii < idxCount ; ii++)
-            meshData.mIndexData[m.indexOffset + ii] += delta;
+    glm::vec3 vmin(std::numeric_limits<float>::max());
+    glm::vec3 vmax(std::numeric_limits<float>::lowest());
 
-        m.vertexOffset = minVtxOffset;
+    const float* v = &src.mVertexData[mesh.streamOffset[0] / sizeof(float)];
+    for (uint32_t i = 0 ; i != mesh.vertexCount ; i++, v += stride) {
+        const glm::vec3 p = glm::vec3(t * glm::vec4(v[0], v[1], v[2], 1.0f));
+        const glm::vec3 n = glm::normalize(normalMatrix * glm::vec3(v[5], v[6], v[7]));
 
-        // sum all the deleted meshes' indices
-        mergeCount += idxCount;
+        dst.insert(dst.end(), { p.x, p.y, p.z, v[3], v[4], n.x, n.y, n.z });
+
+        vmin = glm::min(vmin, p);
+        vmax = glm::max(vmax, p);
     }
 
-    return meshData.mIndexData.size() - mergeCount;
+    return BoundingBox(vmin, vmax);
 }
 
-// All the meshesToMerge now have the same vertexOffset and individual index values are shifted by appropriate amount
-// Here we move all the indices to appropriate places in the new index array
-static void mergeIndexArray(MeshData& md, const std::vector<uint32_t>& meshesToMerge, std::map<uint32_t, uint32_t>& oldToNew)
-{
-    std::vector<uint32_t> newIndices(md.mIndexData.size());
-    // Two offsets in the new indices array (one begins at the start, the second one after all the copied indices)
-    uint32_t copyOffset = 0,
-            mergeOffset = shiftMeshIndices(md, meshesToMerge);
-
-    const auto mergedMeshIndex = md.mMeshes.size() - meshesToMerge.size();
-    auto newIndex = 0u;
-    for (auto midx = 0u ; midx < md.mMeshes.size() ; midx++)
-    {
-        const bool shouldMerge = std::binary_search( meshesToMerge.begin(), meshesToMerge.end(), midx);
-
-        oldToNew[midx] = shouldMerge ? mergedMeshIndex : newIndex;
-        newIndex += shouldMerge ? 0 : 1;
-
-        auto& mesh = md.mMeshes[midx];
-        auto idxCount = mesh.GetLODIndicesCount(0);
-        // move all indices to the new array at mergeOffset
-        const auto start = md.mIndexData.begin() + mesh.indexOffset;
-        mesh.indexOffset = copyOffset;
-        const auto offsetPtr = shouldMerge ? &mergeOffset : &copyOffset;
-        std::copy(start, start + idxCount, newIndices.begin() + *offsetPtr);
-        *offsetPtr += idxCount;
+void MergeSceneMaterials(Scene &scene, MeshData &meshData, const std::vector<std::string> &materialNames, float cellSize) {
+    // Find material indices
+    std::vector<uint32_t> materials;
+    for (const auto& name: materialNames) {
+        const auto i = std::find(scene.mMaterialNames.begin(), scene.mMaterialNames.end(), name);
+        if (i != scene.mMaterialNames.end())
+            materials.push_back((uint32_t)std::distance(scene.mMaterialNames.begin(), i));
     }
+    std::sort(materials.begin(), materials.end());
 
-    md.mIndexData = newIndices;
+    if (materials.empty())
+        return;
 
-    // all the merged indices are now in lastMesh
-    Mesh lastMesh = md.mMeshes[meshesToMerge[0]];
-    lastMesh.indexOffset = copyOffset;
-    lastMesh.lodOffset[0] = copyOffset;
-    lastMesh.lodOffset[1] = mergeOffset;
-    lastMesh.lodCount = 1;
-    md.mMeshes.push_back(lastMesh);
+    MergeSceneNodes(scene, meshData, [&scene, &materials](uint32_t node) {
+        return std::binary_search(materials.begin(), materials.end(), scene.mMaterialForNode.at(node));
+    }, cellSize);
 }
 
-void MergeScene(Scene &scene, MeshData &meshData, const std::string &materialName) {
-// Find material index
-    int oldMaterial = (int)std::distance(std::begin(scene.mMaterialNames), std::find(std::begin(scene.mMaterialNames), std::end(scene.mMaterialNames), materialName));
+uint32_t MergeSceneNodes(Scene &scene, MeshData &meshData, const std::function<bool(uint32_t node)> &shouldMerge, float cellSize) {
+    MarkAsChanged(scene, 0);
+    RecalculateGlobalTransforms(scene);
+
+    // merged nodes are reattached to the root, so the vertices end up in the root space
+    const glm::mat4 rootInv = glm::inverse(scene.mGlobalTransform[0]);
 
+    // 1) Group the nodes by material and spatial cell
     std::vector<uint32_t> toDelete;
+    std::map<MergeGroupKey, std::vector<uint32_t>> groups;
+
+    for (uint32_t i = 0 ; i < (uint32_t)scene.mHierarchy.size() ; i++) {
+        const auto mesh = scene.mMeshes.find(i);
+        const auto material = scene.mMaterialForNode.find(i);
+        if (mesh == scene.mMeshes.end() || material == scene.mMaterialForNode.end())
+            continue;
+        if (IsSkinnedMesh(meshData.mMeshes[mesh->second]) || !shouldMerge(i))
+            continue;
+
+        glm::ivec3 cell(0);
+        if (cellSize > 0.0f) {
+            const glm::mat4 t = rootInv * scene.mGlobalTransform[i];
+            const glm::vec3 center = (mesh->second < meshData.mBoxes.size()) ?
+                    meshData.mBoxes[mesh->second].getTransformed(t).getCenter() : glm::vec3(t[3]);
+            cell = glm::ivec3(glm::floor(center / cellSize));
+        }
+
+        groups[{ material->second, cell.x, cell.y, cell.z }].push_back(i);
+    }
+
+    // a single node does not save a draw call, leave it as it is
+    std::erase_if(groups, [](const auto& g) { return g.second.size() < 2; });
+
+    for (const auto& g: groups)
+        toDelete.insert(toDelete.end(), g.second.begin(), g.second.end());
+    std::sort(toDelete.begin(), toDelete.end());
+
+    if (toDelete.empty())
+        return 0;
+
+    // 2) Meshes which are not referenced by the remaining nodes (or prototypes) are dropped
+    std::vector<bool> meshUsed(meshData.mMeshes.size(), false);
+    for (const auto& m: scene.mMeshes)
+        if (!std::binary_search(toDelete.begin(), toDelete.end(), m.first))
+            meshUsed[m.second] = true;
+    for (const auto& p: scene.mPrototypes)
+        for (const auto& m: p.mMeshes)
+            meshUsed[m.second] = true;
+
+    std::vector<uint32_t> oldToNew(meshData.mMeshes.size(), ~0u);
+    std::vector<Mesh> newMeshes;
+    std::vector<BoundingBox> newBoxes;
+    newMeshes.reserve(meshData.mMeshes.size() + groups.size());
+
+    // 3) The single pass over the index and vertex data: copy the kept meshes and emit the merged ones,
+    //    the vertices of the dropped meshes are not copied
+    std::vector<float> newVertices;
+    std::vector<uint32_t> newIndices;
+    newVertices.reserve(meshData.mVertexData.size());
+    newIndices.reserve(meshData.mIndexData.size());
+
+    for (uint32_t m = 0 ; m != (uint32_t)meshData.mMeshes.size() ; m++) {
+        if (!meshUsed[m])
+            continue;
+
+        Mesh mesh = meshData.mMeshes[m];
+        const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+
+        const uint32_t* idx = &meshData.mIndexData[mesh.indexOffset];
+        const uint32_t bias = getMeshIndexBias(mesh);
+        mesh.indexOffset = (uint32_t)newIndices.size();
+        for (uint32_t i = 0 ; i != getMeshIndexCount(mesh) ; i++)
+            newIndices.push_back(idx[i] - bias);
+
+        const auto firstVertex = (uint32_t)(newVertices.size() / std::max(stride, 1u));
+        const auto vertexStart = meshData.mVertexData.begin() + mesh.streamOffset[0] / sizeof(float);
+        newVertices.insert(newVertices.end(), vertexStart, vertexStart + (size_t)mesh.vertexCount * stride);
+        mesh.vertexOffset = firstVertex;
+        mesh.streamOffset[0] = firstVertex * stride * sizeof(float);
+
+        oldToNew[m] = (uint32_t)newMeshes.size();
+        newMeshes.push_back(mesh);
+        if (m < meshData.mBoxes.size())
+            newBoxes.push_back(meshData.mBoxes[m]);
+    }
 
-    for (auto i = 0u ; i < scene.mHierarchy.size() ; i++)
-        if (scene.mMeshes.contains(i) && scene.mMaterialForNode.contains(i) && (scene.mMaterialForNode.at(i) == oldMaterial))
-            toDelete.push_back(i);
+    const uint32_t vertexStride = kMergedVertexStride;
+    std::vector<uint32_t> mergedNodes;
 
-    std::vector<uint32_t> meshesToMerge(toDelete.size());
+    for (const auto& [key, nodes]: groups) {
+        const auto firstVertex = (uint32_t)(newVertices.size() / vertexStride);
 
-    // Convert toDelete indices to mesh indices
-    std::transform(toDelete.begin(), toDelete.end(), meshesToMerge.begin(), [&scene](uint32_t i) { return scene.mMeshes.at(i); });
+        Mesh merged = {
+                .lodCount = 1,
+                .streamCount = 1,
+                .indexOffset = (uint32_t)newIndices.size(),
+                .vertexOffset = firstVertex,
+                .streamOffset = { firstVertex * vertexStride * (uint32_t)sizeof(float) },
+                .streamElementSize = { vertexStride * (uint32_t)sizeof(float) }
+        };
 
-    // TODO: if merged mesh transforms are non-zero, then we should pre-transform individual mesh vertices in meshData using local transform
+        BoundingBox box(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
 
-    // old-to-new mesh indices
-    std::map<uint32_t, uint32_t> oldToNew;
+        for (uint32_t node: nodes) {
+            const Mesh& src = meshData.mMeshes[scene.mMeshes.at(node)];
+            const BoundingBox b = appendTransformedVertices(meshData, src, rootInv * scene.mGlobalTransform[node], newVertices);
+            box = BoundingBox(glm::min(box.min_, b.min_), glm::max(box.max_, b.max_));
 
-    // now move all the meshesToMerge to the end of array
-    mergeIndexArray(meshData, meshesToMerge, oldToNew);
+            // only the finest LOD is merged, indices are rebased to the start of the merged vertex range
+            const uint32_t* idx = &meshData.mIndexData[src.indexOffset + src.lodOffset[0]];
+            const uint32_t bias = getMeshIndexBias(src);
+            for (uint32_t i = 0 ; i != src.GetLODIndicesCount(0) ; i++)
+                newIndices.push_back(idx[i] - bias + merged.vertexCount);
 
-    // cutoff all but one of the merged meshes (insert the last saved mesh from meshesToMerge - they are all the same)
-    EraseSelected(meshData.mMeshes, meshesToMerge);
+            merged.vertexCount += src.vertexCount;
+        }
+
+        merged.lodOffset[1] = (uint32_t)newIndices.size() - merged.indexOffset;
+
+        // reattach the node with merged meshes (identity transform, the vertices are already transformed)
+        const int newNode = AddNode(scene, 0, 1);
+        scene.mMeshes[newNode] = (uint32_t)newMeshes.size();
+        scene.mMaterialForNode[newNode] = std::get<0>(key);
+        SetNodeName(scene, newNode, "Merged_" + scene.mMaterialNames[std::get<0>(key)] + "_" + std::to_string(mergedNodes.size()));
+        mergedNodes.push_back(newNode);
+
+        newMeshes.push_back(merged);
+        if (!meshData.mBoxes.empty())
+            newBoxes.push_back(box);
+    }
+
+    meshData.mVertexData = std::move(newVertices);
+    meshData.mIndexData = std::move(newIndices);
+    meshData.mMeshes = std::move(newMeshes);
+    if (!meshData.mBoxes.empty())
+        meshData.mBoxes = std::move(newBoxes);
 
     for (auto& n: scene.mMeshes)
-        n.second = oldToNew[n.second];
+        if (std::find(mergedNodes.begin(), mergedNodes.end(), n.first) == mergedNodes.end())
+            n.second = oldToNew[n.second];
 
-    // reattach the node with merged meshes [identity transforms are assumed]
-    int newNode = AddNode(scene, 0, 1);
-    scene.mMeshes[newNode] = meshData.mMeshes.size() - 1;
-    scene.mMaterialForNode[newNode] = (uint32_t)oldMaterial;
+    for (auto& p: scene.mPrototypes)
+        for (auto& n: p.mMeshes)
+            n.second = oldToNew[n.second];
 
     DeleteSceneNodes(scene, toDelete);
+
+    return (uint32_t)mergedNodes.size();
+}
+
+SceneGeometrySummary SummarizeSceneGeometry(const Scene& scene, const MeshData& meshData) {
+    SceneGeometrySummary summary;
+
+    for (const auto& [node, meshIdx]: scene.mMeshes) {
+        const Mesh& mesh = meshData.mMeshes[meshIdx];
+        const uint32_t stride = mesh.streamElementSize[0] / sizeof(float);
+        const auto material = scene.mMaterialForNode.find(node);
+        const glm::mat4& t = scene.mGlobalTransform[node];
+
+        auto& item = summary.mMaterials[(material != scene.mMaterialForNode.end()) ? material->second : ~0u];
+
+        const uint32_t* idx = &meshData.mIndexData[mesh.indexOffset + mesh.lodOffset[0]];
+        for (uint32_t i = 0 ; i != mesh.GetLODIndicesCount(0) ; i++) {
+            const size_t first = ((size_t)idx[i] + mesh.vertexOffset) * stride;
+            if (first + 3 > meshData.mVertexData.size()) {
+                summary.mOutOfRange++;
+                continue;
+            }
+
+            const float* v = &meshData.mVertexData[first];
+            const glm::vec3 p = glm::vec3(t * glm::vec4(v[0], v[1], v[2], 1.0f));
+
+            item.mIndexCount++;
+            item.mPositionSum += glm::dvec3(p);
+            item.mMin = glm::min(item.mMin, p);
+            item.mMax = glm::max(item.mMax, p);
+        }
+    }
+
+    return summary;
+}
+
+bool CompareSceneGeometry(const SceneGeometrySummary& before, const SceneGeometrySummary& after, float tolerance) {
+    if (after.mOutOfRange != before.mOutOfRange) {
+        printf("Geometry mismatch: %llu -> %llu indices outside of the vertex data\n",
+               (unsigned long long)before.mOutOfRange, (unsigned long long)after.mOutOfRange);
+        return false;
+    }
+
+    if (after.mMaterials.size() != before.mMaterials.size()) {
+        printf("Geometry mismatch: %u -> %u materials\n", (uint32_t)before.mMaterials.size(), (uint32_t)after.mMaterials.size());
+        return false;
+    }
+
+    for (const auto& [material, a]: before.mMaterials) {
+        const auto i = after.mMaterials.find(material);
+        if (i == after.mMaterials.end() || i->second.mIndexCount != a.mIndexCount) {
+            printf("Geometry mismatch: material %u, %llu -> %llu indices\n", material, (unsigned long long)a.mIndexCount,
+                   (unsigned long long)(i == after.mMaterials.end() ? 0 : i->second.mIndexCount));
+            return false;
+        }
+
+        if (a.mIndexCount == 0)
+            continue;
+
+        const auto& b = i->second;
+        const float eps = tolerance * std::max(glm::length(a.mMax - a.mMin), 1.0f);
+        const glm::vec3 meanA = glm::vec3(a.mPositionSum / (double)a.mIndexCount);
+        const glm::vec3 meanB = glm::vec3(b.mPositionSum / (double)b.mIndexCount);
+
+        if (glm::length(meanA - meanB) > eps || glm::length(a.mMin - b.mMin) > eps || glm::length(a.mMax - b.mMax) > eps) {
+            printf("Geometry mismatch: material %u, mean (%f, %f, %f) -> (%f, %f, %f)\n",
+                   material, meanA.x, meanA.y, meanA.z, meanB.x, meanB.y, meanB.z);
+            return false;
+        }
+    }
+
+    return true;
 }
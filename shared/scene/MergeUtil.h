@@ -1,6 +1,42 @@
 #pragma once
 
+#include <functional>
+#include <limits>
+#include <map>
+
 #include "shared/scene/Scene.h"
 #include "shared/scene/VtxData.h"
 
-void MergeScene(Scene& scene, MeshData& meshData, const std::string& materialName);
\ No newline at end of file
+void MergeScene(Scene& scene, MeshData& meshData, const std::string& materialName);
+
+/* Merge all the mesh nodes using any of the given materials in a single pass over the index data.
+   Vertices are pre-transformed by the node global transforms (relative to the root), so non-identity instances are merged correctly.
+   If cellSize is positive, the merged geometry of every material is split into a uniform grid of cells (by mesh bounding box center),
+   so that the merged meshes can still be culled. Skinned meshes are never merged */
+void MergeSceneMaterials(Scene& scene, MeshData& meshData, const std::vector<std::string>& materialNames, float cellSize = 0.0f);
+
+/* Generic version of MergeSceneMaterials(): merge all (non-skinned) mesh nodes accepted by 'shouldMerge', grouped by material and cell.
+   Returns the number of merged meshes which were created */
+uint32_t MergeSceneNodes(Scene& scene, MeshData& meshData, const std::function<bool(uint32_t node)>& shouldMerge, float cellSize = 0.0f);
+
+/* Per-material checksum of the drawn geometry: index count, sum and bounds of the world space positions of the finest LOD of every
+   mesh node. Merging must not change it beyond rounding, see CompareSceneGeometry() */
+struct SceneGeometrySummary {
+    struct Item {
+        uint64_t mIndexCount = 0;
+        glm::dvec3 mPositionSum = glm::dvec3(0.0);
+        glm::vec3 mMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 mMax = glm::vec3(std::numeric_limits<float>::lowest());
+    };
+
+    std::map<uint32_t, Item> mMaterials;
+
+    // indices which point past the end of MeshData::mVertexData
+    uint64_t mOutOfRange = 0;
+};
+
+/* Global transforms must be up to date (see RecalculateGlobalTransforms()) */
+SceneGeometrySummary SummarizeSceneGeometry(const Scene& scene, const MeshData& meshData);
+
+/* Prints the first difference. 'tolerance' is relative to the extents of each material */
+bool CompareSceneGeometry(const SceneGeometrySummary& before, const SceneGeometrySummary& after, float tolerance = 1e-4f);
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <numeric>
 
+#include <taskflow/taskflow.hpp>
+
 void SaveStringList(FILE* f, const std::vector<std::string>& lines);
 void LoadStringList(FILE* f, std::vector<std::string>& lines);
 
@@ -76,10 +78,12 @@ bool mat4IsIdentity(const glm::mat4& m);
 void fprintfMat4(FILE* f, const glm::mat4& m);
 
 // CPU version of global transform update []
-void RecalculateGlobalTransforms(Scene &scene) {
+void RecalculateGlobalTransforms(Scene &scene, std::vector<uint32_t>* changedNodes) {
     if (!scene.mChangedAtThisFrame[0].empty()) {
         int c = scene.mChangedAtThisFrame[0][0];
         scene.mGlobalTransform[c] = scene.mLocalTransform[c];
+        if (changedNodes)
+            changedNodes->push_back(c);
         scene.mChangedAtThisFrame[0].clear();
     }
 
@@ -88,6 +92,8 @@ void RecalculateGlobalTransforms(Scene &scene) {
             int p = scene.mHierarchy[c].mParent;
             scene.mGlobalTransform[c] = scene.mGlobalTransform[p] * scene.mLocalTransform[c];
         }
+        if (changedNodes)
+            changedNodes->insert(changedNodes->end(), scene.mChangedAtThisFrame[i].begin(), scene.mChangedAtThisFrame[i].end());
         scene.mChangedAtThisFrame[i].clear();
     }
 }
@@ -104,6 +110,43 @@ void LoadMap(FILE* f, std::unordered_map<uint32_t, uint32_t>& map) {
         map[ms[i * 2 + 0]] = ms[i * 2 + 1];
 }
 
+void LoadSkins(FILE* f, std::vector<Skin>& skins) {
+    uint32_t sz = 0;
+    if (fread(&sz, sizeof(sz), 1, f) != 1)
+        return;
+
+    skins.resize(sz);
+    for (auto& skin: skins) {
+        uint32_t numJoints = 0;
+        fread(&numJoints, sizeof(numJoints), 1, f);
+        skin.mJoints.resize(numJoints);
+        skin.mInverseBindMatrices.resize(numJoints);
+        fread(skin.mJoints.data(), sizeof(uint32_t), numJoints, f);
+        fread(skin.mInverseBindMatrices.data(), sizeof(glm::mat4), numJoints, f);
+        fread(&skin.mBindShapeMatrix, sizeof(glm::mat4), 1, f);
+    }
+}
+
+void LoadPrototypes(FILE* f, std::vector<Prototype>& prototypes) {
+    uint32_t sz = 0;
+    if (fread(&sz, sizeof(sz), 1, f) != 1)
+        return;
+
+    prototypes.resize(sz);
+    for (auto& p: prototypes) {
+        uint32_t nodeCount = 0;
+        fread(&nodeCount, sizeof(nodeCount), 1, f);
+        p.mLocalTransform.resize(nodeCount);
+        p.mGlobalTransform.resize(nodeCount);
+        p.mHierarchy.resize(nodeCount);
+        fread(p.mLocalTransform.data(), sizeof(glm::mat4), nodeCount, f);
+        fread(p.mGlobalTransform.data(), sizeof(glm::mat4), nodeCount, f);
+        fread(p.mHierarchy.data(), sizeof(Hierarchy), nodeCount, f);
+        LoadMap(f, p.mMeshes);
+        LoadMap(f, p.mMaterialForNode);
+    }
+}
+
 void LoadScene(const char *fileName, Scene &scene) {
     FILE* f = fopen(fileName, "rb");
 
@@ -137,6 +180,20 @@ void LoadScene(const char *fileName, Scene &scene) {
         LoadStringList(f, scene.mMaterialNames);
     }
 
+    // optional skinning section (scenes without skinned meshes end here)
+    if (!feof(f))
+    {
+        LoadMap(f, scene.mSkinForNode);
+        LoadSkins(f, scene.mSkins);
+    }
+
+    // optional prototype instancing section
+    if (!feof(f))
+    {
+        LoadMap(f, scene.mPrototypeForNode);
+        LoadPrototypes(f, scene.mPrototypes);
+    }
+
     fclose(f);
 }
 
@@ -152,6 +209,34 @@ void SaveMap(FILE* f, const std::unordered_map<uint32_t, uint32_t>& map) {
     fwrite(ms.data(), sizeof(int), ms.size(), f);
 }
 
+void SaveSkins(FILE* f, const std::vector<Skin>& skins) {
+    const auto sz = static_cast<uint32_t>(skins.size());
+    fwrite(&sz, sizeof(sz), 1, f);
+
+    for (const auto& skin: skins) {
+        const auto numJoints = static_cast<uint32_t>(skin.mJoints.size());
+        fwrite(&numJoints, sizeof(numJoints), 1, f);
+        fwrite(skin.mJoints.data(), sizeof(uint32_t), numJoints, f);
+        fwrite(skin.mInverseBindMatrices.data(), sizeof(glm::mat4), numJoints, f);
+        fwrite(&skin.mBindShapeMatrix, sizeof(glm::mat4), 1, f);
+    }
+}
+
+void SavePrototypes(FILE* f, const std::vector<Prototype>& prototypes) {
+    const auto sz = static_cast<uint32_t>(prototypes.size());
+    fwrite(&sz, sizeof(sz), 1, f);
+
+    for (const auto& p: prototypes) {
+        const auto nodeCount = static_cast<uint32_t>(p.mHierarchy.size());
+        fwrite(&nodeCount, sizeof(nodeCount), 1, f);
+        fwrite(p.mLocalTransform.data(), sizeof(glm::mat4), nodeCount, f);
+        fwrite(p.mGlobalTransform.data(), sizeof(glm::mat4), nodeCount, f);
+        fwrite(p.mHierarchy.data(), sizeof(Hierarchy), nodeCount, f);
+        SaveMap(f, p.mMeshes);
+        SaveMap(f, p.mMaterialForNode);
+    }
+}
+
 void SaveScene(const char *fileName, const Scene &scene) {
     FILE* f = fopen(fileName, "wb");
 
@@ -166,12 +251,26 @@ void SaveScene(const char *fileName, const Scene &scene) {
     SaveMap(f, scene.mMaterialForNode);
     SaveMap(f, scene.mMeshes);
 
-    if (!scene.mNames.empty() && !scene.mNameForNode.empty()) {
+    // optional sections are chained: to write one of them all the previous ones have to be written (even if empty)
+    const bool hasPrototypes = !scene.mPrototypes.empty();
+    const bool hasSkins = !scene.mSkins.empty() || hasPrototypes;
+
+    if ((!scene.mNames.empty() && !scene.mNameForNode.empty()) || hasSkins) {
         SaveMap(f, scene.mNameForNode);
         SaveStringList(f, scene.mNames);
 
         SaveStringList(f, scene.mMaterialNames);
     }
+
+    if (hasSkins) {
+        SaveMap(f, scene.mSkinForNode);
+        SaveSkins(f, scene.mSkins);
+    }
+
+    if (hasPrototypes) {
+        SaveMap(f, scene.mPrototypeForNode);
+        SavePrototypes(f, scene.mPrototypes);
+    }
     fclose(f);
 }
 
@@ -226,32 +325,6 @@ void PrintChangedNodes(const Scene &scene) {
     }
 }
 
-// Shift all hierarchy components in the nodes
-void ShiftNodes(Scene& scene, int startOffset, int nodeCount, int shiftAmount)
-{
-    auto shiftNode = [shiftAmount](Hierarchy& node)
-    {
-        if (node.mParent > -1)
-            node.mParent += shiftAmount;
-        if (node.mFirstChild > -1)
-            node.mFirstChild += shiftAmount;
-        if (node.mNextSibling > -1)
-            node.mNextSibling += shiftAmount;
-        if (node.mLastSibling > -1)
-            node.mLastSibling += shiftAmount;
-        // node->mLevel does not have to be shifted
-    };
-
-
-//	std::transform(scene.hierarchy_.begin() + startOffset, scene.hierarchy_.begin() + nodeCount, scene.hierarchy_.begin() + startOffset, shiftNode);
-
-//	for (auto i = scene.hierarchy_.begin() + startOffset ; i != scene.hierarchy_.begin() + nodeCount ; i++)
-//		shiftNode(*i);
-
-    for (int i = 0 ; i < nodeCount ; i++)
-        shiftNode(scene.mHierarchy[i + startOffset]);
-}
-
 using ItemMap = std::unordered_map<uint32_t, uint32_t>;
 
 // Add the items from otherMap shifting indices and values along the way
@@ -290,90 +363,177 @@ void DumpSceneToDot(const char *fileName, const Scene &scene, const int *visited
     fclose(f);
 }
 
+// Offsets of one input scene inside the merged scene (phase one of MergeScenes)
+struct SceneMergeOffsets {
+    int mNode;
+    int mName;
+    int mMaterial;
+    int mMesh;
+    int mSkin;
+    int mPrototype;
+};
+
 void MergeScenes(Scene &scene, const std::vector<Scene *> &scenes, const std::vector<glm::mat4> &rootTransforms,
                  const std::vector<uint32_t> &meshCounts, bool mergeMeshes, bool mergeMaterials) {
-// Create new root node
-    scene.mHierarchy = {
-            {
-                    .mParent = -1,
-                    .mFirstChild = 1,
-                    .mNextSibling = -1,
-                    .mLastSibling = -1,
-                    .mLevel = 0
-            }
+    // 1) Compute the offsets of every input scene and the total sizes, so that nothing is reallocated later
+    std::vector<SceneMergeOffsets> offsets(scenes.size());
+
+    SceneMergeOffsets total = {
+            .mNode = 1, // new root
+            .mName = 1,
+            .mMaterial = 0,
+            .mMesh = 0,
+            .mSkin = 0,
+            .mPrototype = 0
     };
 
-    scene.mNameForNode[0] = 0;
-    scene.mNames = { "NewRoot" };
+    size_t numMeshItems = 0, numMaterialItems = 0, numNameItems = 0, numSkinItems = 0, numPrototypeItems = 0;
 
-    scene.mLocalTransform.emplace_back(1.f);
-    scene.mGlobalTransform.emplace_back(1.f);
+    for (size_t i = 0 ; i != scenes.size() ; i++) {
+        const Scene* s = scenes[i];
+        offsets[i] = total;
 
-    if (scenes.empty())
-        return;
+        total.mNode += (int)s->mHierarchy.size();
+        total.mName += (int)s->mNames.size();
+        total.mMaterial += (int)s->mMaterialNames.size();
+        total.mMesh += mergeMeshes ? (int)meshCounts[i] : 0;
+        total.mSkin += (int)s->mSkins.size();
+        total.mPrototype += (int)s->mPrototypes.size();
 
-    int offs = 1;
-    int meshOffs = 0;
-    int nameOffs = (int)scene.mNames.size();
-    int materialOfs = 0;
-    auto meshCount = meshCounts.begin();
+        numMeshItems += s->mMeshes.size();
+        numMaterialItems += s->mMaterialForNode.size();
+        numNameItems += s->mNameForNode.size();
+        numSkinItems += s->mSkinForNode.size();
+        numPrototypeItems += s->mPrototypeForNode.size();
+    }
 
-    if (!mergeMaterials)
-        scene.mMaterialNames = scenes[0]->mMaterialNames;
+    // Create new root node
+    scene.mHierarchy.resize(total.mNode);
+    scene.mHierarchy[0] = {
+            .mParent = -1,
+            .mFirstChild = scenes.empty() ? -1 : 1,
+            .mNextSibling = -1,
+            .mLastSibling = -1,
+            .mLevel = 0
+    };
 
-    // FIXME: too much logic (for all the components in a scene, though mesh data and materials go separately - there are dedicated data lists)
-    for (const Scene* s: scenes) {
-        mergeVectors(scene.mLocalTransform, s->mLocalTransform);
-        mergeVectors(scene.mGlobalTransform, s->mGlobalTransform);
+    scene.mLocalTransform.resize(total.mNode);
+    scene.mGlobalTransform.resize(total.mNode);
+    scene.mLocalTransform[0] = glm::mat4(1.f);
+    scene.mGlobalTransform[0] = glm::mat4(1.f);
 
-        mergeVectors(scene.mHierarchy, s->mHierarchy);
+    scene.mNames.resize(total.mName);
+    scene.mNames[0] = "NewRoot";
+    scene.mNameForNode[0] = 0;
 
-        mergeVectors(scene.mNames, s->mNames);
-        if (mergeMaterials)
-            mergeVectors(scene.mMaterialNames, s->mMaterialNames);
+    if (mergeMaterials)
+        scene.mMaterialNames.resize(total.mMaterial);
+    else if (!scenes.empty())
+        scene.mMaterialNames = scenes[0]->mMaterialNames;
 
-        int nodeCount = (int)s->mHierarchy.size();
+    scene.mSkins.resize(total.mSkin);
+    scene.mPrototypes.resize(total.mPrototype);
 
-        ShiftNodes(scene, offs, nodeCount, offs);
+    if (scenes.empty())
+        return;
 
-        MergeMaps(scene.mMeshes,          s->mMeshes,          offs, mergeMeshes ? meshOffs : 0);
-        MergeMaps(scene.mMaterialForNode, s->mMaterialForNode, offs, mergeMaterials ? materialOfs : 0);
-        MergeMaps(scene.mNameForNode,     s->mNameForNode,     offs, nameOffs);
+    scene.mMeshes.reserve(numMeshItems);
+    scene.mMaterialForNode.reserve(numMaterialItems);
+    scene.mNameForNode.reserve(numNameItems + 1);
+    scene.mSkinForNode.reserve(numSkinItems);
+    scene.mPrototypeForNode.reserve(numPrototypeItems);
+
+    // 2) Fill the pre-sized arrays. Every input scene writes to its own ranges, so the scenes are processed in parallel.
+    //    Each map is owned by a single task, because the hash maps cannot be filled concurrently
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+
+    taskflow.for_each_index(0, (int)scenes.size(), 1, [&](int i) {
+        const Scene* s = scenes[i];
+        const SceneMergeOffsets& o = offsets[i];
+        const int nodeCount = (int)s->mHierarchy.size();
+        const bool isLast = (i == (int)scenes.size() - 1);
+
+        std::copy(s->mLocalTransform.begin(), s->mLocalTransform.end(), scene.mLocalTransform.begin() + o.mNode);
+        std::copy(s->mGlobalTransform.begin(), s->mGlobalTransform.end(), scene.mGlobalTransform.begin() + o.mNode);
+
+        auto shift = [&o](int n) { return (n > -1) ? n + o.mNode : -1; };
+
+        for (int n = 0 ; n != nodeCount ; n++) {
+            const Hierarchy& h = s->mHierarchy[n];
+            scene.mHierarchy[o.mNode + n] = {
+                    .mParent = shift(h.mParent),
+                    .mFirstChild = shift(h.mFirstChild),
+                    .mNextSibling = shift(h.mNextSibling),
+                    .mLastSibling = shift(h.mLastSibling),
+                    // all nodes are one level below the new root
+                    .mLevel = h.mLevel + 1
+            };
+        }
 
-        offs += nodeCount;
+        // old scene roots become children of the new root and are chained as siblings
+        Hierarchy& oldRoot = scene.mHierarchy[o.mNode];
+        oldRoot.mParent = 0;
+        oldRoot.mNextSibling = isLast ? -1 : o.mNode + nodeCount;
 
-        materialOfs += (int)s->mMaterialNames.size();
-        nameOffs += (int)s->mNames.size();
+        // transform old root nodes, if the transforms are given
+        if (!rootTransforms.empty())
+            scene.mLocalTransform[o.mNode] = rootTransforms[i] * scene.mLocalTransform[o.mNode];
 
-        if (mergeMeshes) {
-            meshOffs += *meshCount;
-            meshCount++;
+        std::copy(s->mNames.begin(), s->mNames.end(), scene.mNames.begin() + o.mName);
+        if (mergeMaterials)
+            std::copy(s->mMaterialNames.begin(), s->mMaterialNames.end(), scene.mMaterialNames.begin() + o.mMaterial);
+
+        // joints are node indices, so they are shifted just like the hierarchy
+        for (size_t k = 0 ; k != s->mSkins.size() ; k++) {
+            Skin& skin = scene.mSkins[o.mSkin + k];
+            skin = s->mSkins[k];
+            for (auto& j: skin.mJoints)
+                j += o.mNode;
         }
-    }
 
-    // fixing 'nextSibling' fields in the old roots (zero-index in all the scenes)
-    offs = 1;
-    int idx = 0;
-    for (const Scene* s: scenes) {
-        int nodeCount = (int)s->mHierarchy.size();
-        bool isLast = (idx == scenes.size() - 1);
-        // calculate new next sibling for the old scene roots
-        int next = isLast ? -1 : offs + nodeCount;
-        scene.mHierarchy[offs].mNextSibling = next;
-        // attach to new root
-        scene.mHierarchy[offs].mParent = 0;
+        // prototypes are node-local, only their mesh and material references have to be shifted
+        for (size_t k = 0 ; k != s->mPrototypes.size() ; k++) {
+            const Prototype& src = s->mPrototypes[k];
+            Prototype& dst = scene.mPrototypes[o.mPrototype + k];
+            dst.mLocalTransform = src.mLocalTransform;
+            dst.mGlobalTransform = src.mGlobalTransform;
+            dst.mHierarchy = src.mHierarchy;
+            MergeMaps(dst.mMeshes,          src.mMeshes,          0, mergeMeshes ? o.mMesh : 0);
+            MergeMaps(dst.mMaterialForNode, src.mMaterialForNode, 0, mergeMaterials ? o.mMaterial : 0);
+        }
+    });
 
-        // transform old root nodes, if the transforms are given
-        if (!rootTransforms.empty())
-            scene.mLocalTransform[offs] = rootTransforms[idx] * scene.mLocalTransform[offs];
+    auto mergeComponent = [&scenes, &offsets](ItemMap& m, ItemMap Scene::* component, int SceneMergeOffsets::* itemOffset, bool shiftItems) {
+        for (size_t i = 0 ; i != scenes.size() ; i++)
+            MergeMaps(m, scenes[i]->*component, offsets[i].mNode, shiftItems ? offsets[i].*itemOffset : 0);
+    };
 
-        offs += nodeCount;
-        idx++;
-    }
+    taskflow.emplace([&] { mergeComponent(scene.mMeshes,           &Scene::mMeshes,           &SceneMergeOffsets::mMesh,      mergeMeshes);    });
+    taskflow.emplace([&] { mergeComponent(scene.mMaterialForNode,  &Scene::mMaterialForNode,  &SceneMergeOffsets::mMaterial,  mergeMaterials); });
+    taskflow.emplace([&] { mergeComponent(scene.mNameForNode,      &Scene::mNameForNode,      &SceneMergeOffsets::mName,      true);           });
+    taskflow.emplace([&] { mergeComponent(scene.mSkinForNode,      &Scene::mSkinForNode,      &SceneMergeOffsets::mSkin,      true);           });
+    taskflow.emplace([&] { mergeComponent(scene.mPrototypeForNode, &Scene::mPrototypeForNode, &SceneMergeOffsets::mPrototype, true);           });
 
-    // now shift levels of all nodes below the root
-    for (auto i = scene.mHierarchy.begin() + 1 ; i != scene.mHierarchy.end() ; i++)
-        i->mLevel++;
+    executor.run(taskflow).wait();
+}
+
+void RemapMaterials(Scene &scene, const std::vector<uint32_t> &materialRemap) {
+    for (auto& m: scene.mMaterialForNode)
+        m.second = materialRemap[m.second];
+
+    for (auto& p: scene.mPrototypes)
+        for (auto& m: p.mMaterialForNode)
+            m.second = materialRemap[m.second];
+
+    // a merged material keeps the name of its first occurrence
+    if (scene.mMaterialNames.size() == materialRemap.size()) {
+        std::vector<std::string> names;
+        for (size_t i = 0 ; i != materialRemap.size() ; i++)
+            if (materialRemap[i] == names.size())
+                names.push_back(scene.mMaterialNames[i]);
+        scene.mMaterialNames = std::move(names);
+    }
 }
 
 // Add an index to a sorted index array
@@ -438,7 +598,8 @@ void DeleteSceneNodes(Scene &scene, const std::vector<uint32_t> &nodesToDelete)
                 .mParent = (h.mParent != -1) ? newIndices[h.mParent] : -1,
                 .mFirstChild = FindLastNonDeletedItem(scene, newIndices, h.mFirstChild),
                 .mNextSibling = FindLastNonDeletedItem(scene, newIndices, h.mNextSibling),
-                .mLastSibling = FindLastNonDeletedItem(scene, newIndices, h.mLastSibling)
+                .mLastSibling = FindLastNonDeletedItem(scene, newIndices, h.mLastSibling),
+                .mLevel = h.mLevel
         };
     };
     std::transform(scene.mHierarchy.begin(), scene.mHierarchy.end(), scene.mHierarchy.begin(), nodeMover);
@@ -456,7 +617,91 @@ void DeleteSceneNodes(Scene &scene, const std::vector<uint32_t> &nodesToDelete)
     ShiftMapIndices(scene.mMeshes, newIndices);
     ShiftMapIndices(scene.mMaterialForNode, newIndices);
     ShiftMapIndices(scene.mNameForNode, newIndices);
+    ShiftMapIndices(scene.mSkinForNode, newIndices);
+    ShiftMapIndices(scene.mPrototypeForNode, newIndices);
+
+    // 4c) Skin joints reference nodes directly. Deleted joints fall back to the root to keep the joint palette intact
+    for (auto& skin: scene.mSkins)
+        for (auto& j: skin.mJoints)
+            j = (newIndices[j] != -1) ? newIndices[j] : 0;
 
     // 5) scene node names list is not modified, but in principle it can be (remove all non-used items and adjust the nameForNode_ map)
     // 6) Material names list is not modified also, but if some materials fell out of use
 }
+
+void RecalculatePrototypeTransforms(Prototype& prototype) {
+    // parents always precede their children (see CreatePrototype()), so a single forward pass is enough
+    for (size_t i = 0 ; i < prototype.mHierarchy.size() ; i++) {
+        const int p = prototype.mHierarchy[i].mParent;
+        prototype.mGlobalTransform[i] = (p > -1) ? prototype.mGlobalTransform[p] * prototype.mLocalTransform[i] : prototype.mLocalTransform[i];
+    }
+}
+
+uint32_t CreatePrototype(Scene& scene, int node) {
+    // breadth-first order of the subtree, parents always precede their children
+    std::vector<int> nodes = { node };
+    for (size_t i = 0 ; i < nodes.size() ; i++)
+        for (int c = scene.mHierarchy[nodes[i]].mFirstChild; c != -1 ; c = scene.mHierarchy[c].mNextSibling)
+            nodes.push_back(c);
+
+    std::unordered_map<int, int> newIndex;
+    for (size_t i = 0 ; i < nodes.size() ; i++)
+        newIndex[nodes[i]] = (int)i;
+
+    auto remap = [&newIndex](int n) { return (n > -1 && newIndex.contains(n)) ? newIndex[n] : -1; };
+
+    Prototype p;
+    const int baseLevel = scene.mHierarchy[node].mLevel;
+    for (int n: nodes) {
+        const Hierarchy& h = scene.mHierarchy[n];
+        p.mHierarchy.push_back({
+                .mParent = remap(h.mParent),
+                .mFirstChild = remap(h.mFirstChild),
+                .mNextSibling = (n == node) ? -1 : remap(h.mNextSibling),
+                .mLastSibling = remap(h.mLastSibling),
+                .mLevel = h.mLevel - baseLevel
+        });
+        p.mLocalTransform.push_back((n == node) ? glm::mat4(1.0f) : scene.mLocalTransform[n]);
+        p.mGlobalTransform.emplace_back(1.0f);
+
+        if (scene.mMeshes.contains(n))
+            p.mMeshes[newIndex[n]] = scene.mMeshes.at(n);
+        if (scene.mMaterialForNode.contains(n))
+            p.mMaterialForNode[newIndex[n]] = scene.mMaterialForNode.at(n);
+    }
+    p.mHierarchy[0].mParent = -1;
+
+    RecalculatePrototypeTransforms(p);
+
+    scene.mPrototypes.push_back(std::move(p));
+    return (uint32_t)scene.mPrototypes.size() - 1;
+}
+
+int AddInstance(Scene& scene, int parent, int level, uint32_t prototype, const mat4& localTransform) {
+    const int node = AddNode(scene, parent, level);
+    scene.mLocalTransform[node] = localTransform;
+    scene.mPrototypeForNode[node] = prototype;
+    return node;
+}
+
+int ReplaceWithInstance(Scene& scene, int node, uint32_t prototype) {
+    std::vector<uint32_t> descendants;
+    CollectNodesToDelete(scene, node, descendants);
+    std::sort(descendants.begin(), descendants.end());
+
+    scene.mMeshes.erase(node);
+    scene.mMaterialForNode.erase(node);
+    scene.mSkinForNode.erase(node);
+    scene.mPrototypeForNode[node] = prototype;
+
+    if (descendants.empty())
+        return node;
+
+    const int deletedBefore = (int)std::distance(descendants.begin(), std::lower_bound(descendants.begin(), descendants.end(), (uint32_t)node));
+
+    DeleteSceneNodes(scene, descendants);
+
+    const int newNode = node - deletedBefore;
+    scene.mHierarchy[newNode].mFirstChild = -1;
+    return newNode;
+}
@@ -28,6 +28,32 @@ struct Hierarchy {
     int mLevel;
 };
 
+/* Joint list of a skinned mesh. Joints are regular scene nodes, so the skeleton is animated through mLocalTransform */
+struct Skin {
+    // scene nodes used as joints (VertexBoneData::mBoneIndex refers to this list)
+    std::vector<uint32_t> mJoints;
+
+    // mesh space -> joint space transforms in the bind pose (one per joint)
+    std::vector<mat4> mInverseBindMatrices;
+
+    // applied after skinning to bring vertices back into the (scaled) mesh space used by the converter
+    mat4 mBindShapeMatrix = mat4(1.0f);
+};
+
+/* Shared template subtree (e.g. a repeated prop). Its content is stored once and referenced by lightweight instance nodes,
+   which only hold a root transform. Node 0 is the prototype root, all transforms are relative to it */
+struct Prototype {
+    std::vector<mat4> mLocalTransform;
+
+    // prototype-space transforms, calculated once by RecalculatePrototypeTransforms()
+    std::vector<mat4> mGlobalTransform;
+
+    std::vector<Hierarchy> mHierarchy;
+
+    std::unordered_map<uint32_t, uint32_t> mMeshes;
+    std::unordered_map<uint32_t, uint32_t> mMaterialForNode;
+};
+
 /* This scene is converted into a descriptorSet(s) in MultiRenderer class
    This structure is also used as a storage type in SceneExporter tool
  */
@@ -57,6 +83,18 @@ struct Scene {
 
     // Debug list of material names
     std::vector<std::string> mMaterialNames;
+
+    // Skin component: Which skin (joint list) is used to deform the mesh of the node
+    std::unordered_map<uint32_t, uint32_t> mSkinForNode;
+
+    // List of all skins in the scene
+    std::vector<Skin> mSkins;
+
+    // Instance component: Which prototype is referenced by the (childless) instance node
+    std::unordered_map<uint32_t, uint32_t> mPrototypeForNode;
+
+    // List of all prototypes in the scene
+    std::vector<Prototype> mPrototypes;
 };
 
 int AddNode(Scene& scene, int parent, int level);
@@ -78,7 +116,8 @@ inline void SetNodeName(Scene& scene, int node, const std::string& name) {
 
 int GetNodeLevel(const Scene& scene, int n);
 
-void RecalculateGlobalTransforms(Scene& scene);
+// changedNodes (optional) receives all the nodes whose global transform was updated
+void RecalculateGlobalTransforms(Scene& scene, std::vector<uint32_t>* changedNodes = nullptr);
 
 void LoadScene(const char* fileName, Scene& scene);
 void SaveScene(const char* fileName, const Scene& scene);
@@ -91,5 +130,19 @@ void DumpSceneToDot(const char* fileName, const Scene& scene, const int* visited
 void MergeScenes(Scene& scene, const std::vector<Scene*>& scenes, const std::vector<glm::mat4>& rootTransforms, const std::vector<uint32_t>& meshCounts,
                  bool mergeMeshes = true, bool mergeMaterials = true);
 
+// Apply the material remap table from MergeMaterialLists() to the material components and compact the material names
+void RemapMaterials(Scene& scene, const std::vector<uint32_t>& materialRemap);
+
 // Delete a collection of nodes from a scenegraph
 void DeleteSceneNodes(Scene& scene, const std::vector<uint32_t>& nodesToDelete);
+
+void RecalculatePrototypeTransforms(Prototype& prototype);
+
+// Copy the subtree starting at 'node' into a new prototype (the root transform is not copied, it belongs to the instances)
+uint32_t CreatePrototype(Scene& scene, int node);
+
+// Add an instance node. Instances never have children, their content is expanded while building draw lists
+int AddInstance(Scene& scene, int parent, int level, uint32_t prototype, const mat4& localTransform = mat4(1.0f));
+
+// Delete the subtree below 'node' and turn the node into an instance of the prototype. Returns the new index of the node
+int ReplaceWithInstance(Scene& scene, int node, uint32_t prototype);
@@ -0,0 +1,108 @@
+#include "SceneSnapshot.h"
+
+#include <algorithm>
+
+void SceneSnapshotBuffer::BeginWrite() {
+    std::unique_lock lock(mMutex);
+    mCondition.wait(lock, [this] { return mStopped || !(mReading && mReadSlot == 1 - mFront); });
+}
+
+void SceneSnapshotBuffer::WriteTransforms(const Scene& scene, const std::vector<uint32_t>& changedNodes) {
+    // the other snapshot has to receive the same changes when it is written next time
+    Slot& back = GetBack();
+    Slot& front = mSlots[mFront];
+    front.mPendingNodes.insert(front.mPendingNodes.end(), changedNodes.begin(), changedNodes.end());
+
+    auto& dst = back.mSnapshot.mGlobalTransform;
+
+    if (back.mFullCopy || dst.size() != scene.mGlobalTransform.size()) {
+        dst = scene.mGlobalTransform;
+        back.mFullCopy = false;
+        back.mPendingNodes.clear();
+        return;
+    }
+
+    auto& nodes = back.mPendingNodes;
+    nodes.insert(nodes.end(), changedNodes.begin(), changedNodes.end());
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+    // copy contiguous runs of changed nodes with a single memcpy each
+    for (size_t i = 0 ; i < nodes.size() ; ) {
+        size_t j = i + 1;
+        while (j < nodes.size() && nodes[j] == nodes[j - 1] + 1)
+            j++;
+
+        std::copy(scene.mGlobalTransform.begin() + nodes[i], scene.mGlobalTransform.begin() + nodes[j - 1] + 1, dst.begin() + nodes[i]);
+        i = j;
+    }
+
+    nodes.clear();
+}
+
+void SceneSnapshotBuffer::WriteDrawData(const std::vector<DrawData>& drawData) {
+    mLatestDrawData = drawData;
+    GetBack().mSnapshot.mDrawData = drawData;
+    GetBack().mDrawDataPending = false;
+    mSlots[mFront].mDrawDataPending = true;
+}
+
+void SceneSnapshotBuffer::WriteVisibility(const std::vector<uint8_t>& visibility) {
+    mLatestVisibility = visibility;
+    GetBack().mSnapshot.mVisibility = visibility;
+    GetBack().mVisibilityPending = false;
+    mSlots[mFront].mVisibilityPending = true;
+}
+
+void SceneSnapshotBuffer::EndWrite() {
+    Slot& back = GetBack();
+
+    // bring the data which was passed only for the previous frame up to date
+    if (back.mDrawDataPending) {
+        back.mSnapshot.mDrawData = mLatestDrawData;
+        back.mDrawDataPending = false;
+    }
+    if (back.mVisibilityPending) {
+        back.mSnapshot.mVisibility = mLatestVisibility;
+        back.mVisibilityPending = false;
+    }
+
+    back.mSnapshot.mFrame = ++mFrame;
+
+    {
+        std::lock_guard lock(mMutex);
+        mFront = 1 - mFront;
+        mFresh = true;
+    }
+    mCondition.notify_all();
+}
+
+const SceneSnapshot* SceneSnapshotBuffer::AcquireRead() {
+    std::unique_lock lock(mMutex);
+    mCondition.wait(lock, [this] { return mStopped || mFresh; });
+
+    if (mStopped)
+        return nullptr;
+
+    mFresh = false;
+    mReading = true;
+    mReadSlot = mFront;
+    return &mSlots[mReadSlot].mSnapshot;
+}
+
+void SceneSnapshotBuffer::ReleaseRead() {
+    {
+        std::lock_guard lock(mMutex);
+        mReading = false;
+        mReadSlot = -1;
+    }
+    mCondition.notify_all();
+}
+
+void SceneSnapshotBuffer::Stop() {
+    {
+        std::lock_guard lock(mMutex);
+        mStopped = true;
+    }
+    mCondition.notify_all();
+}
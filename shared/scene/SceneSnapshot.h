@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "shared/scene/Scene.h"
+#include "shared/scene/VtxData.h"
+
+/* Immutable copy of everything the renderer needs for one frame */
+struct SceneSnapshot {
+    uint64_t mFrame = 0;
+
+    std::vector<mat4> mGlobalTransform;
+    std::vector<DrawData> mDrawData;
+
+    // one entry per draw (0 = culled)
+    std::vector<uint8_t> mVisibility;
+};
+
+/* Double-buffered hand-off of scene state from a simulation thread to a render thread.
+
+   The simulation thread writes frame N+1 into the back snapshot while the render thread reads frame N from the front one.
+   The writer is at most one frame ahead: BeginWrite() blocks until the reader has moved on from the snapshot it wants to overwrite.
+   Every snapshot remembers which nodes changed since it was last written, so only the changed transform ranges are copied */
+class SceneSnapshotBuffer final {
+public:
+    /* Simulation thread */
+
+    // Blocks until the back snapshot is not used by the reader
+    void BeginWrite();
+
+    // Copy the global transforms of changedNodes (e.g. from RecalculateGlobalTransforms()) into the back snapshot.
+    // The first call after a resize of the scene copies everything
+    void WriteTransforms(const Scene& scene, const std::vector<uint32_t>& changedNodes);
+
+    // Draw lists change rarely (LOD switches, streaming), so they are copied as a whole and only when passed
+    void WriteDrawData(const std::vector<DrawData>& drawData);
+    void WriteVisibility(const std::vector<uint8_t>& visibility);
+
+    // Make the back snapshot available to the reader
+    void EndWrite();
+
+    /* Render thread */
+
+    // Blocks until a snapshot newer than the last acquired one is published (or Stop() is called, then nullptr is returned)
+    const SceneSnapshot* AcquireRead();
+    void ReleaseRead();
+
+    // Wake up a waiting reader/writer, e.g. on shutdown
+    void Stop();
+
+private:
+    struct Slot {
+        SceneSnapshot mSnapshot;
+
+        // nodes changed since this snapshot was written the last time
+        std::vector<uint32_t> mPendingNodes;
+        bool mFullCopy = true;
+
+        // the other slot received new draw data this slot has not seen yet
+        bool mDrawDataPending = false;
+        bool mVisibilityPending = false;
+    };
+
+    Slot mSlots[2];
+
+    // published snapshot (the back one is 1 - mFront)
+    int mFront = 0;
+
+    bool mFresh = false;
+    bool mReading = false;
+    int mReadSlot = -1;
+    bool mStopped = false;
+
+    uint64_t mFrame = 0;
+
+    // copies of the last passed draw data, used to bring the other slot up to date
+    std::vector<DrawData> mLatestDrawData;
+    std::vector<uint8_t> mLatestVisibility;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+
+    Slot& GetBack() { return mSlots[1 - mFront]; }
+};
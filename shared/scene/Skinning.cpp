@@ -0,0 +1,248 @@
+#include "Skinning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SKINNING_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// end of the vertex ranges of all meshes, MeshData::mVertexData may be padded after it
+static uint32_t getBindPoseVertexCount(const MeshData& meshData) {
+    uint32_t count = 0;
+    for (const Mesh& mesh: meshData.mMeshes)
+        if (mesh.streamElementSize[0])
+            count = std::max(count, mesh.streamOffset[0] / mesh.streamElementSize[0] + mesh.vertexCount);
+    return count;
+}
+
+void BuildSkinningJobs(const Scene& scene, const MeshData& meshData, std::vector<SkinningJob>& jobs, std::vector<glm::mat4>& jointMatrices) {
+    jobs.clear();
+    jointMatrices.clear();
+
+    uint32_t outputVertexOffset = getBindPoseVertexCount(meshData);
+
+    // iterate nodes in order to get the same joint palette layout on every call
+    std::vector<std::pair<uint32_t, uint32_t>> skinnedNodes(scene.mSkinForNode.begin(), scene.mSkinForNode.end());
+    std::sort(skinnedNodes.begin(), skinnedNodes.end());
+
+    for (const auto& [node, skinIdx]: skinnedNodes) {
+        const auto meshIt = scene.mMeshes.find(node);
+        if (meshIt == scene.mMeshes.end())
+            continue;
+
+        const Mesh& mesh = meshData.mMeshes[meshIt->second];
+        if (!IsSkinnedMesh(mesh))
+            continue;
+
+        const Skin& skin = scene.mSkins[skinIdx];
+
+        jobs.push_back(SkinningJob {
+                .vertexOffset = mesh.streamOffset[0] / mesh.streamElementSize[0],
+                .skinOffset = mesh.streamOffset[1] / (uint32_t)sizeof(VertexBoneData),
+                .vertexCount = mesh.vertexCount,
+                .jointOffset = (uint32_t)jointMatrices.size(),
+                .outputVertexOffset = outputVertexOffset,
+                .node = node
+        });
+        outputVertexOffset += mesh.vertexCount;
+
+        // skinned vertices stay in the space of the mesh node, the node transform is applied during rendering as usual
+        const glm::mat4 meshToWorldInv = glm::inverse(scene.mGlobalTransform[node]);
+        for (size_t j = 0 ; j < skin.mJoints.size() ; j++)
+            jointMatrices.push_back(skin.mBindShapeMatrix * meshToWorldInv * scene.mGlobalTransform[skin.mJoints[j]] * skin.mInverseBindMatrices[j]);
+    }
+}
+
+uint32_t GetSkinnedVertexCount(const MeshData& bindPose, const std::vector<SkinningJob>& jobs) {
+    uint32_t count = getBindPoseVertexCount(bindPose);
+    for (const SkinningJob& job: jobs)
+        count = std::max(count, job.outputVertexOffset + job.vertexCount);
+    return count;
+}
+
+void RedirectSkinnedDraws(const MeshData& meshData, const std::vector<SkinningJob>& jobs, std::vector<DrawData>& drawData) {
+    std::unordered_map<uint32_t, const SkinningJob*> jobForNode;
+    for (const SkinningJob& job: jobs)
+        jobForNode[job.node] = &job;
+
+    for (DrawData& d: drawData) {
+        const auto job = jobForNode.find(d.transformIndex);
+        d.vertexOffset = meshData.mMeshes[d.meshIndex].vertexOffset;
+
+        // indices stay the same, only the vertex range moves
+        if (job != jobForNode.end())
+            d.vertexOffset += job->second->outputVertexOffset - job->second->vertexOffset;
+    }
+}
+
+void SkinVerticesReference(const float* srcVertices, const VertexBoneData* skinData, uint32_t vertexCount, const glm::mat4* jointMatrices, float* dstVertices) {
+    for (uint32_t i = 0 ; i != vertexCount ; i++) {
+        const float* src = srcVertices + i * kSkinnedVertexStride;
+        float* dst = dstVertices + i * kSkinnedVertexStride;
+        const VertexBoneData& b = skinData[i];
+
+        glm::mat4 m(0.0f);
+        float totalWeight = 0.0f;
+        for (uint32_t k = 0 ; k != kMaxBonesPerVertex ; k++) {
+            if (b.mWeight[k] == 0.0f)
+                continue;
+            m += jointMatrices[b.mBoneIndex[k]] * b.mWeight[k];
+            totalWeight += b.mWeight[k];
+        }
+
+        // vertices without any influences keep their bind pose
+        if (totalWeight == 0.0f) {
+            std::copy(src, src + kSkinnedVertexStride, dst);
+            continue;
+        }
+
+        const glm::vec3 p = glm::vec3(m * glm::vec4(src[0], src[1], src[2], 1.0f));
+        const glm::vec3 n = glm::normalize(glm::vec3(m * glm::vec4(src[5], src[6], src[7], 0.0f)));
+
+        dst[0] = p.x;
+        dst[1] = p.y;
+        dst[2] = p.z;
+        dst[3] = src[3];
+        dst[4] = src[4];
+        dst[5] = n.x;
+        dst[6] = n.y;
+        dst[7] = n.z;
+    }
+}
+
+void SkinVertices(const float* srcVertices, const VertexBoneData* skinData, uint32_t vertexCount, const glm::mat4* jointMatrices, float* dstVertices) {
+#if SKINNING_USE_SSE
+    for (uint32_t i = 0 ; i != vertexCount ; i++) {
+        const float* src = srcVertices + i * kSkinnedVertexStride;
+        float* dst = dstVertices + i * kSkinnedVertexStride;
+        const VertexBoneData& b = skinData[i];
+
+        // blend the columns of the joint matrices
+        __m128 c0 = _mm_setzero_ps();
+        __m128 c1 = _mm_setzero_ps();
+        __m128 c2 = _mm_setzero_ps();
+        __m128 c3 = _mm_setzero_ps();
+        float totalWeight = 0.0f;
+
+        for (uint32_t k = 0 ; k != kMaxBonesPerVertex ; k++) {
+            if (b.mWeight[k] == 0.0f)
+                continue;
+            const float* m = glm::value_ptr(jointMatrices[b.mBoneIndex[k]]);
+            const __m128 w = _mm_set1_ps(b.mWeight[k]);
+            c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(m + 0)));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+            totalWeight += b.mWeight[k];
+        }
+
+        if (totalWeight == 0.0f) {
+            std::copy(src, src + kSkinnedVertexStride, dst);
+            continue;
+        }
+
+        const __m128 p = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(src[0])), _mm_mul_ps(c1, _mm_set1_ps(src[1]))),
+                _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(src[2])), c3));
+
+        __m128 n = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(src[5])), _mm_mul_ps(c1, _mm_set1_ps(src[6]))),
+                _mm_mul_ps(c2, _mm_set1_ps(src[7])));
+
+        // w component of n is zero, so a horizontal sum of n*n is the squared length
+        __m128 len2 = _mm_mul_ps(n, n);
+        len2 = _mm_add_ps(len2, _mm_shuffle_ps(len2, len2, _MM_SHUFFLE(2, 3, 0, 1)));
+        len2 = _mm_add_ps(len2, _mm_shuffle_ps(len2, len2, _MM_SHUFFLE(1, 0, 3, 2)));
+        n = _mm_div_ps(n, _mm_sqrt_ps(len2));
+
+        alignas(16) float pos[4];
+        alignas(16) float nrm[4];
+        _mm_store_ps(pos, p);
+        _mm_store_ps(nrm, n);
+
+        dst[0] = pos[0];
+        dst[1] = pos[1];
+        dst[2] = pos[2];
+        dst[3] = src[3];
+        dst[4] = src[4];
+        dst[5] = nrm[0];
+        dst[6] = nrm[1];
+        dst[7] = nrm[2];
+    }
+#else
+    SkinVerticesReference(srcVertices, skinData, vertexCount, jointMatrices, dstVertices);
+#endif
+}
+
+float CompareWithSkinningReference(const MeshData& bindPose, const std::vector<SkinningJob>& jobs, const std::vector<glm::mat4>& jointMatrices,
+                                   const std::vector<float>& skinnedVertices) {
+    float maxDiff = 0.0f;
+    std::vector<float> reference;
+
+    for (const SkinningJob& job: jobs) {
+        const size_t first = (size_t)job.outputVertexOffset * kSkinnedVertexStride;
+        const size_t count = (size_t)job.vertexCount * kSkinnedVertexStride;
+        reference.resize(count);
+
+        SkinVerticesReference(
+                bindPose.mVertexData.data() + (size_t)job.vertexOffset * kSkinnedVertexStride,
+                bindPose.mSkinData.data() + job.skinOffset,
+                job.vertexCount,
+                jointMatrices.data() + job.jointOffset,
+                reference.data());
+
+        for (size_t i = 0 ; i != count ; i++) {
+            const float diff = std::abs(skinnedVertices[first + i] - reference[i]) / std::max(std::abs(reference[i]), 1.0f);
+            // NaNs never compare greater, so they are reported explicitly
+            if (!(diff <= maxDiff))
+                maxDiff = std::isnan(diff) ? INFINITY : diff;
+        }
+    }
+
+    return maxDiff;
+}
+
+CPUSkinner::CPUSkinner(uint32_t numThreads)
+    : mExecutor(std::max(numThreads, 1u)) {
+}
+
+void CPUSkinner::Skin(const MeshData& bindPose, const std::vector<SkinningJob>& jobs, const std::vector<glm::mat4>& jointMatrices, std::vector<float>& outVertices) {
+    const size_t outputSize = std::max(bindPose.mVertexData.size(), (size_t)GetSkinnedVertexCount(bindPose, jobs) * kSkinnedVertexStride);
+    if (outVertices.size() != outputSize) {
+        outVertices = bindPose.mVertexData;
+        outVertices.resize(outputSize);
+    }
+
+    struct Batch {
+        uint32_t job;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    std::vector<Batch> batches;
+    for (uint32_t j = 0 ; j != (uint32_t)jobs.size() ; j++)
+        for (uint32_t first = 0 ; first < jobs[j].vertexCount ; first += mBatchSize)
+            batches.push_back({ .job = j, .first = first, .count = std::min(mBatchSize, jobs[j].vertexCount - first) });
+
+    if (batches.empty())
+        return;
+
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(0, (int)batches.size(), 1, [&](int i) {
+        const Batch& b = batches[i];
+        const SkinningJob& job = jobs[b.job];
+        const size_t src = (size_t)job.vertexOffset + b.first;
+        const size_t dst = (size_t)job.outputVertexOffset + b.first;
+        SkinVertices(
+                bindPose.mVertexData.data() + src * kSkinnedVertexStride,
+                bindPose.mSkinData.data() + job.skinOffset + b.first,
+                b.count,
+                jointMatrices.data() + job.jointOffset,
+                outVertices.data() + dst * kSkinnedVertexStride);
+    });
+
+    mExecutor.run(taskflow).wait();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <taskflow/taskflow.hpp>
+
+#include "shared/scene/Scene.h"
+#include "shared/scene/VtxData.h"
+
+/* Number of float values per vertex in MeshData::mVertexData: pos(vec3) + uv(vec2) + normal(vec3) */
+constexpr uint32_t kSkinnedVertexStride = 3 + 2 + 3;
+
+/* One skinned mesh instance. The layout is shared by the CPU skinner and the skinning compute shader (std430) */
+struct SkinningJob {
+    // first vertex of the mesh in MeshData::mVertexData (in vertices)
+    uint32_t vertexOffset;
+
+    // first element of the mesh in MeshData::mSkinData
+    uint32_t skinOffset;
+
+    uint32_t vertexCount;
+
+    // first joint matrix of this instance in the joint palette
+    uint32_t jointOffset;
+
+    // first vertex of the skinned copy of this instance in the output buffer (in vertices)
+    uint32_t outputVertexOffset;
+
+    // scene node of this instance, i.e. DrawData::transformIndex of its draws
+    uint32_t node;
+};
+
+static_assert(sizeof(SkinningJob) == sizeof(uint32_t) * 6);
+
+/* Collect skinning jobs and the joint palette (bindShape * inverse(meshGlobal) * jointGlobal * inverseBind) for all skinned nodes.
+   Nodes sharing a mesh have different poses, so every job gets its own output range after the bind pose vertices.
+   Global transforms must be up to date (see RecalculateGlobalTransforms()) */
+void BuildSkinningJobs(const Scene& scene, const MeshData& meshData, std::vector<SkinningJob>& jobs, std::vector<glm::mat4>& jointMatrices);
+
+/* Size of the skinned vertex buffer (in vertices): the bind pose vertices followed by the output ranges of all jobs */
+uint32_t GetSkinnedVertexCount(const MeshData& bindPose, const std::vector<SkinningJob>& jobs);
+
+/* Point the draws of skinned nodes at the output ranges of their jobs. Draws are recalculated from the meshes, so calling this again
+   with new jobs is fine */
+void RedirectSkinnedDraws(const MeshData& meshData, const std::vector<SkinningJob>& jobs, std::vector<DrawData>& drawData);
+
+/* Single-threaded scalar implementation. This is the reference the other skinning paths are validated against */
+void SkinVerticesReference(const float* srcVertices, const VertexBoneData* skinData, uint32_t vertexCount, const glm::mat4* jointMatrices, float* dstVertices);
+
+/* SSE version of SkinVerticesReference() (falls back to the scalar code on other architectures) */
+void SkinVertices(const float* srcVertices, const VertexBoneData* skinData, uint32_t vertexCount, const glm::mat4* jointMatrices, float* dstVertices);
+
+/* Largest difference between the output ranges of all jobs in skinnedVertices (e.g. the CPUSkinner output or a read back
+   GPU buffer) and SkinVerticesReference(). Differences are relative to the reference value, absolute below 1 */
+float CompareWithSkinningReference(const MeshData& bindPose, const std::vector<SkinningJob>& jobs, const std::vector<glm::mat4>& jointMatrices,
+                                   const std::vector<float>& skinnedVertices);
+
+/* Multithreaded CPU skinning of all jobs. Jobs are split into fixed-size vertex batches which are spread across the worker threads */
+class CPUSkinner final {
+public:
+    explicit CPUSkinner(uint32_t numThreads = std::thread::hardware_concurrency());
+
+    /* Writes skinned vertices into outVertices (GetSkinnedVertexCount() vertices, which start with a copy of bindPose.mVertexData) */
+    void Skin(const MeshData& bindPose, const std::vector<SkinningJob>& jobs, const std::vector<glm::mat4>& jointMatrices, std::vector<float>& outVertices);
+
+    uint32_t mBatchSize = 4096;
+
+private:
+    tf::Executor mExecutor;
+};
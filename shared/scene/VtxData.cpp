@@ -46,6 +46,18 @@ MeshFileHeader loadMeshData(const char* meshFile, MeshData& out) {
         exit(255);
     }
 
+    // optional skinning stream (older files end right after the vertex data)
+    uint32_t skinDataSize = 0;
+    if (fread(&skinDataSize, 1, sizeof(skinDataSize), f) == sizeof(skinDataSize) && skinDataSize > 0)
+    {
+        out.mSkinData.resize(skinDataSize / sizeof(VertexBoneData));
+        if (fread(out.mSkinData.data(), 1, skinDataSize, f) != skinDataSize)
+        {
+            printf("Unable to read skinning data\n");
+            exit(255);
+        }
+    }
+
     fclose(f);
 
     return header;
@@ -68,6 +80,13 @@ void saveMeshData(const char* fileName, const MeshData& m) {
     fwrite(m.mIndexData.data(), 1, header.indexDataSize, f);
     fwrite(m.mVertexData.data(), 1, header.vertexDataSize, f);
 
+    if (!m.mSkinData.empty())
+    {
+        const auto skinDataSize = (uint32_t)(m.mSkinData.size() * sizeof(VertexBoneData));
+        fwrite(&skinDataSize, 1, sizeof(skinDataSize), f);
+        fwrite(m.mSkinData.data(), 1, skinDataSize, f);
+    }
+
     fclose(f);
 }
 
@@ -110,6 +129,7 @@ void loadBoundingBoxes(const char* fileName, std::vector<BoundingBox>& boxes) {
 MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md) {
     uint32_t totalVertexDataSize = 0;
     uint32_t totalIndexDataSize  = 0;
+    uint32_t totalSkinDataSize   = 0;
 
     uint32_t offs = 0;
     for (const MeshData* i: md)
@@ -118,13 +138,22 @@ MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md) {
         mergeVectors(m.mVertexData, i->mVertexData);
         mergeVectors(m.mMeshes, i->mMeshes);
         mergeVectors(m.mBoxes, i->mBoxes);
+        mergeVectors(m.mSkinData, i->mSkinData);
 
         uint32_t vtxOffset = totalVertexDataSize / 8;  /* 8 is the number of per-vertex attributes: position, normal + UV */
 
         for (size_t j = 0 ; j < (uint32_t)i->mMeshes.size() ; j++)
+        {
             // m.vertexCount, m.lodCount and m.streamCount do not change
             // m.vertexOffset also does not change, because vertex offsets are local (i.e., baked into the indices)
-            m.mMeshes[offs + j].indexOffset += totalIndexDataSize;
+            Mesh& mesh = m.mMeshes[offs + j];
+            mesh.indexOffset += totalIndexDataSize;
+
+            // stream offsets are absolute byte offsets, so they move together with the appended data
+            mesh.streamOffset[0] += totalVertexDataSize * sizeof(float);
+            if (IsSkinnedMesh(mesh))
+                mesh.streamOffset[1] += totalSkinDataSize * sizeof(VertexBoneData);
+        }
 
         // shift individual indices
         for(size_t j = 0 ; j < i->mIndexData.size() ; j++)
@@ -134,6 +163,7 @@ MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md) {
 
         totalIndexDataSize += (uint32_t)i->mIndexData.size();
         totalVertexDataSize += (uint32_t)i->mVertexData.size();
+        totalSkinDataSize += (uint32_t)i->mSkinData.size();
     }
 
     return MeshFileHeader {
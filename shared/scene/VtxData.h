@@ -10,6 +10,12 @@
 constexpr uint32_t kMaxLODs = 8;
 constexpr uint32_t kMaxStreams = 8;
 
+/* Maximum number of bones influencing a single vertex (matches the aiProcess_LimitBoneWeights default) */
+constexpr uint32_t kMaxBonesPerVertex = 4;
+
+/* Mesh::impostorIndex of meshes without an impostor */
+constexpr uint32_t kNoImpostor = 0xFFFFFFFF;
+
 
 // All offsets are relative to the beginning of the data block (excluding headers with Mesh list)
 struct Mesh final {
@@ -32,6 +38,9 @@ struct Mesh final {
 
     [[nodiscard]] inline uint32_t GetLODIndicesCount(uint32_t lod) const { return lodOffset[lod + 1] - lodOffset[lod]; }
 
+    /* Geometric simplification error of each LOD in mesh units (0 for LOD0). Used for screen-space error LOD selection */
+    float lodError[kMaxLODs] = { 0.0f };
+
     /* All the data "pointers" for all the streams */
     uint32_t streamOffset[kMaxStreams] = { 0 };
 
@@ -40,6 +49,10 @@ struct Mesh final {
 
     /* TODO: We could have included the streamStride[] array here to allow interleaved storage of attributes.*/
 
+    /* Index in the impostor list of the scene (see shared/scene/Impostor.h) or kNoImpostor. The impostor is always the last LOD:
+       a single quad in card space which is rendered by the card renderer instead of the regular mesh shader */
+    uint32_t impostorIndex = kNoImpostor;
+
     /* TODO: Additional information, like mesh name, can be added here */
 };
 
@@ -71,17 +84,31 @@ struct DrawData {
     uint32_t transformIndex;
 };
 
+/* Per-vertex skinning stream. Indices refer to the joint list of the Skin attached to the mesh node (see Scene::mSkins) */
+struct VertexBoneData {
+    uint32_t mBoneIndex[kMaxBonesPerVertex] = { 0 };
+    float mWeight[kMaxBonesPerVertex] = { 0.0f };
+};
+
 struct MeshData
 {
     std::vector<uint32_t> mIndexData;
     std::vector<float> mVertexData;
     std::vector<Mesh> mMeshes;
     std::vector<BoundingBox> mBoxes;
+
+    /* Optional second vertex stream for skinned meshes: Mesh::streamOffset[1] is a byte offset into this array */
+    std::vector<VertexBoneData> mSkinData;
 };
 
 static_assert(sizeof(DrawData) == sizeof(uint32_t) * 6);
+static_assert(sizeof(VertexBoneData) == sizeof(uint32_t) * 2 * kMaxBonesPerVertex);
 static_assert(sizeof(BoundingBox) == sizeof(float) * 6);
 
+inline bool IsSkinnedMesh(const Mesh& mesh) { return mesh.streamCount > 1 && mesh.streamElementSize[1] == sizeof(VertexBoneData); }
+
+inline bool IsImpostorLOD(const Mesh& mesh, uint32_t lod) { return mesh.impostorIndex != kNoImpostor && lod + 1 == mesh.lodCount; }
+
 MeshFileHeader loadMeshData(const char* meshFile, MeshData& out);
 void saveMeshData(const char* fileName, const MeshData& m);
 
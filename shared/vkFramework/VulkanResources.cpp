@@ -77,23 +77,52 @@ VulkanTexture VulkanResources::loadCubeMap(const char *fileName, uint32_t mipLev
 
 VulkanTexture VulkanResources::loadKTX(const char *fileName) {
     gli::texture gliTex = gli::load_ktx(fileName);
+    if (gliTex.empty()) {
+        printf("Cannot load %s KTX texture file\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+
     glm::tvec3<uint32_t> extent(gliTex.extent(0));
 
+    // gli::format values are the same as VkFormat values
+    const auto format = (VkFormat)gliTex.format();
+    const auto mipLevels = (uint32_t)gliTex.levels();
+
     VulkanTexture ktx = {
             .width = extent.x,
             .height = extent.y,
-            .depth = 4
+            .depth = 1,
+            .format = format
     };
 
-    if (!CreateTextureImageFromData(vkDev, ktx.image.image, ktx.image.imageMemory,
-                                    (uint8_t *) gliTex.data(0, 0, 0), ktx.width, ktx.height, VK_FORMAT_R16G16_SFLOAT)) {
-        printf("ModelRenderer: failed to load BRDF LUT texture \n");
+    if (!CreateImage(vkDev.device, vkDev.physicalDevice, ktx.width, ktx.height, format, VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     ktx.image.image, ktx.image.imageMemory, 0, mipLevels)) {
+        printf("Cannot create image for %s KTX texture\n", fileName);
         exit(EXIT_FAILURE);
     }
 
-    CreateImageView(vkDev.device, ktx.image.image, VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT,
-                    &ktx.image.imageView);
-    CreateTextureSampler(vkDev.device, &ktx.sampler);
+    // all levels of a single-layer texture are stored contiguously
+    std::vector<VkDeviceSize> levelOffsets(mipLevels);
+    for (uint32_t level = 0 ; level != mipLevels ; level++)
+        levelOffsets[level] = (VkDeviceSize)(gliTex.data<uint8_t>(0, 0, level) - gliTex.data<uint8_t>());
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(vkDev.device, vkDev.physicalDevice, gliTex.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    UploadBufferData(vkDev, stagingBufferMemory, 0, gliTex.data(), gliTex.size());
+
+    TransitionImageLayout(vkDev, ktx.image.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, mipLevels);
+    CopyBufferToImageLevels(vkDev, stagingBuffer, ktx.image.image, levelOffsets, ktx.width, ktx.height);
+    TransitionImageLayout(vkDev, ktx.image.image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, mipLevels);
+
+    vkDestroyBuffer(vkDev.device, stagingBuffer, nullptr);
+    vkFreeMemory(vkDev.device, stagingBufferMemory, nullptr);
+
+    CreateImageView(vkDev.device, ktx.image.image, format, VK_IMAGE_ASPECT_COLOR_BIT,
+                    &ktx.image.imageView, VK_IMAGE_VIEW_TYPE_2D, 1, mipLevels);
+    CreateTextureSampler(vkDev.device, &ktx.sampler, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, (float)(mipLevels - 1));
 
     allTextures.push_back(ktx);
 
@@ -0,0 +1,156 @@
+#include "VulkanComputedSkinning.h"
+
+ComputedSkinning::ComputedSkinning(VulkanRenderDevice &vkDev, const char *shaderName, const MeshData &bindPose,
+                                   VkBuffer outputBuffer, uint32_t outputBufferSize,
+                                   uint32_t maxJobs, uint32_t maxJoints)
+    : ComputedItem(vkDev, sizeof(SkinningParams))
+    , outputBuffer(outputBuffer)
+    , outputBufferSize(outputBufferSize)
+    , maxJobs(std::max(maxJobs, 1u))
+    , maxJoints(std::max(maxJoints, 1u)) {
+
+    // the skinning stream may be empty for scenes without skinned meshes, keep the buffers valid anyway
+    const VertexBoneData emptySkin;
+
+    if (!CreateStorageBuffer(bindPoseBuffer, bindPose.mVertexData.size() * sizeof(float), bindPose.mVertexData.data()) ||
+        !CreateStorageBuffer(skinDataBuffer, std::max<size_t>(bindPose.mSkinData.size(), 1) * sizeof(VertexBoneData),
+                             bindPose.mSkinData.empty() ? &emptySkin : (const void*)bindPose.mSkinData.data()) ||
+        !CreateStorageBuffer(jointsBuffer, this->maxJoints * sizeof(glm::mat4), nullptr) ||
+        !CreateStorageBuffer(jobsBuffer, this->maxJobs * sizeof(SkinningJob), nullptr))
+    {
+        printf("Cannot create skinning buffers\n"); fflush(stdout);
+        exit(EXIT_FAILURE);
+    }
+
+    CreateComputedSetLayout();
+    CreatePipelineLayout(vkDev.device, dsLayout, &pipelineLayout);
+
+    CreateDescriptorSet();
+
+    ShaderModule s;
+    CreateShaderModule(vkDev.device, &s, shaderName);
+    if (CreateComputePipeline(vkDev.device, s.shaderModule, pipelineLayout, &pipeline) != VK_SUCCESS)
+        exit(EXIT_FAILURE);
+
+    vkDestroyShaderModule(vkDev.device, s.shaderModule, nullptr);
+}
+
+ComputedSkinning::~ComputedSkinning() {
+    for (auto* b: { &bindPoseBuffer, &skinDataBuffer, &jointsBuffer, &jobsBuffer })
+    {
+        vkDestroyBuffer(vkDev.device, b->buffer, nullptr);
+        vkFreeMemory(vkDev.device, b->memory, nullptr);
+    }
+}
+
+void ComputedSkinning::UpdateJobs(const std::vector<SkinningJob> &jobs, const std::vector<glm::mat4> &jointMatrices) {
+    assert(jobs.size() <= maxJobs);
+    assert(jointMatrices.size() <= maxJoints);
+
+    const auto jobCount = (uint32_t)std::min<size_t>(jobs.size(), maxJobs);
+
+    UploadBufferData(vkDev, jobsBuffer.memory, 0, jobs.data(), jobCount * sizeof(SkinningJob));
+    UploadBufferData(vkDev, jointsBuffer.memory, 0, jointMatrices.data(), std::min<size_t>(jointMatrices.size(), maxJoints) * sizeof(glm::mat4));
+
+    SkinningParams params = { .jobCount = jobCount };
+    UploadUniformBuffer(sizeof(params), &params);
+
+    uint32_t maxVertexCount = 0;
+    for (uint32_t i = 0 ; i != jobCount ; i++)
+    {
+        assert((jobs[i].outputVertexOffset + jobs[i].vertexCount) * kSkinnedVertexStride * sizeof(float) <= outputBufferSize);
+        maxVertexCount = std::max(maxVertexCount, jobs[i].vertexCount);
+    }
+
+    // X covers the vertices of the largest mesh, Y enumerates the jobs
+    FillComputeCommandBuffer(nullptr, 0, (maxVertexCount + kWorkgroupSize - 1) / kWorkgroupSize, std::max(jobCount, 1u), 1);
+}
+
+bool ComputedSkinning::CreateStorageBuffer(VulkanBuffer &buffer, VkDeviceSize size, const void *data) {
+    buffer.size = size;
+
+    if (!CreateBuffer(vkDev.device, vkDev.physicalDevice, size,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      buffer.buffer, buffer.memory))
+        return false;
+
+    if (data)
+        UploadBufferData(vkDev, buffer.memory, 0, data, size);
+
+    return true;
+}
+
+bool ComputedSkinning::CreateComputedSetLayout() {
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+            { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1 },
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 5 }
+    };
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = 1,
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data()
+    };
+    VK_CHECK(vkCreateDescriptorPool(vkDev.device, &descriptorPoolInfo, nullptr, &descriptorPool));
+
+    std::array<VkDescriptorSetLayoutBinding, 6> bindings = {
+            /* skinned vertices [external storage buffer] */
+            DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+            DescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+            /* bind pose vertices */
+            DescriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+            /* bone indices and weights */
+            DescriptorSetLayoutBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+            /* joint palette */
+            DescriptorSetLayoutBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+            /* skinning jobs */
+            DescriptorSetLayoutBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+    };
+
+    const VkDescriptorSetLayoutCreateInfo layoutInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings = bindings.data()
+    };
+
+    VK_CHECK(vkCreateDescriptorSetLayout(vkDev.device, &layoutInfo, nullptr, &dsLayout));
+
+    return true;
+}
+
+bool ComputedSkinning::CreateDescriptorSet() {
+    VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = descriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &dsLayout
+    };
+    VK_CHECK(vkAllocateDescriptorSets(vkDev.device, &allocInfo, &descriptorSet));
+
+    const VkDescriptorBufferInfo bufferInfo0 = { outputBuffer, 0, outputBufferSize };
+    const VkDescriptorBufferInfo bufferInfo1 = { uniformBuffer.buffer, 0, uniformBuffer.size };
+    const VkDescriptorBufferInfo bufferInfo2 = { bindPoseBuffer.buffer, 0, bindPoseBuffer.size };
+    const VkDescriptorBufferInfo bufferInfo3 = { skinDataBuffer.buffer, 0, skinDataBuffer.size };
+    const VkDescriptorBufferInfo bufferInfo4 = { jointsBuffer.buffer, 0, jointsBuffer.size };
+    const VkDescriptorBufferInfo bufferInfo5 = { jobsBuffer.buffer, 0, jobsBuffer.size };
+
+    const std::array<VkWriteDescriptorSet, 6> descriptorWrites = {
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo2, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo3, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo4, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            BufferWriteDescriptorSet(descriptorSet, &bufferInfo5, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+    };
+
+    vkUpdateDescriptorSets(vkDev.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "shared/scene/Skinning.h"
+#include "shared/vkRenderers/VulkanComputedItem.h"
+
+/* GPU counterpart of CPUSkinner: a compute shader which writes skinned vertices directly into an existing vertex storage buffer
+   (e.g. the one used by MultiMeshRenderer). Bind-pose vertices and skinning streams are uploaded once, only joints and jobs change per frame.
+   The output buffer must hold GetSkinnedVertexCount() vertices and the draws must use RedirectSkinnedDraws() */
+class ComputedSkinning : public ComputedItem {
+public:
+    ComputedSkinning(VulkanRenderDevice& vkDev, const char* shaderName,
+                     const MeshData& bindPose,
+                     VkBuffer outputBuffer, uint32_t outputBufferSize,
+                     uint32_t maxJobs, uint32_t maxJoints);
+
+    virtual ~ComputedSkinning();
+
+    /* Upload the output of BuildSkinningJobs() and record the dispatch. Call Submit() afterwards */
+    void UpdateJobs(const std::vector<SkinningJob>& jobs, const std::vector<glm::mat4>& jointMatrices);
+
+protected:
+    struct SkinningParams {
+        uint32_t jobCount;
+    };
+
+    static constexpr uint32_t kWorkgroupSize = 64;
+
+    VkBuffer outputBuffer;
+    uint32_t outputBufferSize;
+
+    uint32_t maxJobs;
+    uint32_t maxJoints;
+
+    VulkanBuffer bindPoseBuffer;
+    VulkanBuffer skinDataBuffer;
+    VulkanBuffer jointsBuffer;
+    VulkanBuffer jobsBuffer;
+
+    bool CreateStorageBuffer(VulkanBuffer& buffer, VkDeviceSize size, const void* data);
+
+    bool CreateComputedSetLayout();
+    bool CreateDescriptorSet();
+};
@@ -11,7 +11,8 @@ void MultiMeshRenderer::FillCommandBuffer(VkCommandBuffer commandBuffer, size_t
 }
 
 MultiMeshRenderer::MultiMeshRenderer(VulkanRenderDevice &vkDev, const char *meshFile, const char *drawDataFile,
-                                     const char *materialFile, const char *vtxShaderFile, const char *fragShaderFile)
+                                     const char *materialFile, const char *vtxShaderFile, const char *fragShaderFile,
+                                     uint32_t extraVertexDataSize)
                                      : vkDev(vkDev), RendererBase(vkDev, VulkanImage()){
 
     if (!CreateColorAndDepthRenderPass(vkDev, false, &mRenderPass, RenderPassCreateInfo())) {
@@ -50,7 +51,7 @@ MultiMeshRenderer::MultiMeshRenderer(VulkanRenderDevice &vkDev, const char *mesh
         exit(EXIT_FAILURE);
     }
 
-    mMaxVertexBufferSize = header.vertexDataSize;
+    mMaxVertexBufferSize = header.vertexDataSize + extraVertexDataSize;
     mIndexBufferSize = header.indexDataSize;
 
     VkPhysicalDeviceProperties devProps;
@@ -125,7 +126,7 @@ MultiMeshRenderer::MultiMeshRenderer(VulkanRenderDevice &vkDev, const char *mesh
 
 void MultiMeshRenderer::UpdateIndirectBuffers(VulkanRenderDevice &vkDev, size_t currentImage, bool *visibility) {
     VkDrawIndirectCommand* data = nullptr;
-    vkMapMemory(vkDev.device, mIndirectBuffersMemory[currentImage], 0, 2 * sizeof(VkDrawIndirectCommand), 0, (void **)&data);
+    vkMapMemory(vkDev.device, mIndirectBuffersMemory[currentImage], 0, mMaxShapes * sizeof(VkDrawIndirectCommand), 0, (void **)&data);
 
     for(uint32_t i = 0; i < mMaxShapes; i++) {
         const uint32_t j = mShapes[i].meshIndex;
@@ -140,6 +141,15 @@ void MultiMeshRenderer::UpdateIndirectBuffers(VulkanRenderDevice &vkDev, size_t
     vkUnmapMemory(vkDev.device, mIndirectBuffersMemory[currentImage]);
 }
 
+void MultiMeshRenderer::UpdateLODs(VulkanRenderDevice &vkDev, size_t currentImage, const LODSelector &selector,
+                                   const std::vector<mat4> &transforms, const glm::vec3 &cameraPos, float fovY, bool *visibility) {
+    selector.Update(mMeshData, transforms, mShapes, cameraPos, fovY, (float)mFramebufferHeight);
+
+    // every swapchain image has its own copy of the buffers, so they are rewritten even if nothing changed this frame
+    UpdateIndirectBuffers(vkDev, currentImage, visibility);
+    UpdateDrawDataBuffer(vkDev, currentImage, mMaxDrawDataSize, mShapes.data());
+}
+
 void MultiMeshRenderer::UpdateGeometryBuffers(VulkanRenderDevice &vkDev, uint32_t vertexCount, uint32_t indexCount,
                                               const void *vertices, const void *indices) {
     UploadBufferData(vkDev, mStorageBufferMemory, 0, vertices, vertexCount);
@@ -164,6 +174,13 @@ void MultiMeshRenderer::UpdateCountBuffer(VulkanRenderDevice &vkDev, size_t curr
     UploadBufferData(vkDev, mCountBuffersMemory[currentImage], 0, &itemCount, sizeof(uint32_t));
 }
 
+void MultiMeshRenderer::UpdateSkinnedDraws(VulkanRenderDevice &vkDev, const std::vector<SkinningJob> &jobs) {
+    RedirectSkinnedDraws(mMeshData, jobs, mShapes);
+
+    for (size_t i = 0 ; i != mDrawDataBuffers.size() ; i++)
+        UpdateDrawDataBuffer(vkDev, i, mMaxDrawDataSize, mShapes.data());
+}
+
 MultiMeshRenderer::~MultiMeshRenderer() {
     VkDevice device = vkDev.device;
 
@@ -7,22 +7,32 @@
 using glm::mat4;
 
 #include "shared/scene/VtxData.h"
+#include "shared/scene/LODSelector.h"
+#include "shared/scene/Skinning.h"
 
 class MultiMeshRenderer : public RendererBase {
 public:
     virtual void FillCommandBuffer(VkCommandBuffer commandBuffer, size_t currentImage) override;
 
+    /* extraVertexDataSize reserves room after the vertices of meshFile, e.g. for the per-instance output of ComputedSkinning
+       ((GetSkinnedVertexCount() - bind pose vertex count) * kSkinnedVertexStride floats) */
     MultiMeshRenderer(
             VulkanRenderDevice& vkDev,
             const char* meshFile,
             const char* drawDataFile,
             const char* materialFile,
             const char* vtxShaderFile,
-            const char* fragShaderFile
+            const char* fragShaderFile,
+            uint32_t extraVertexDataSize = 0
             );
 
     void UpdateIndirectBuffers(VulkanRenderDevice& vkDev, size_t currentImage, bool* visibility = nullptr);
 
+    /* Per-frame LOD selection: updates the LODs of all shapes and rewrites the indirect and draw data buffers of currentImage.
+       'transforms' are indexed by DrawData::transformIndex. There is no impostor pass, the selector should have mImpostors off */
+    void UpdateLODs(VulkanRenderDevice& vkDev, size_t currentImage, const LODSelector& selector, const std::vector<mat4>& transforms,
+                    const glm::vec3& cameraPos, float fovY, bool* visibility = nullptr);
+
     void UpdateGeometryBuffers(VulkanRenderDevice& vkDev, uint32_t vertexCount, uint32_t indexCount, const void* vertices, const void* indices);
     void UpdateMaterialBuffer(VulkanRenderDevice& vkDev, uint32_t materialSize, const void* materialData);
 
@@ -30,8 +40,16 @@ public:
     void UpdateDrawDataBuffer(VulkanRenderDevice& vkDev, size_t currentImage, uint32_t drawDataSize, const void* drawData);
     void UpdateCountBuffer(VulkanRenderDevice& vkDev, size_t currentImage, uint32_t itemCount);
 
+    /* Draws of skinned nodes read the output ranges of their jobs (see RedirectSkinnedDraws()). Rewrites the draw data of all swapchain images */
+    void UpdateSkinnedDraws(VulkanRenderDevice& vkDev, const std::vector<SkinningJob>& jobs);
+
     virtual ~MultiMeshRenderer();
 
+    /* Vertex part of the storage buffer [0..GetMaxVertexBufferSize()) can be written by compute shaders, e.g. ComputedSkinning */
+    [[nodiscard]] VkBuffer GetStorageBuffer() const { return mStorageBuffer; }
+    [[nodiscard]] uint32_t GetMaxVertexBufferSize() const { return mMaxVertexBufferSize; }
+    [[nodiscard]] const MeshData& GetMeshData() const { return mMeshData; }
+
     uint32_t mVertexBufferSize;
     uint32_t mIndexBufferSize;
 